@@ -0,0 +1,440 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: microbench.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Kernel microbenchmarks
+///
+/// @detail Each benchmark runs a kernel over a fixed set of inputs generated
+///         from a fixed seed, so runs and builds see the same work. A trial
+///         repeats the set until it has run for at least BENCH_TRIAL_MS;
+///         the median of BENCH_TRIALS trials is reported with the fastest
+///         trial and the median absolute deviation, as a check on how much
+///         to trust a difference between two builds.
+///
+///         Build and run with `make bench`. Run bin/release/microbench with
+///         a substring to only run the benchmarks whose names contain it.
+///         The refit checks at the end compare refitted hierarchies with
+///         fresh builds over the same moved geometry, and make the exit
+///         status non-zero if any ray hits differently. The pin check does
+///         the same if a helper thread started by a pinned thread is left on
+///         that thread's CPU.
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bvh.h"
+#include "camera.h"
+#include "dielectric.h"
+#include "hittable_list.h"
+#include "lambertian.h"
+#include "mesh.h"
+#include "metal.h"
+#include "numa.h"
+#include "random.h"
+#include "scenes.h"
+#include "sphere.h"
+#include "utilities.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define BENCH_TRIALS 15         ///< Trials per benchmark
+#define BENCH_TRIAL_MS 20       ///< Minimum length of a trial
+#define BENCH_RAYS 4096         ///< Size of each input set
+#define BENCH_SEED 1            ///< Seed for every input set
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+
+// Results are folded into this so the kernels can't be optimized away
+static volatile float sink;
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Uniform in [lo, hi) from the calling thread's generator
+static float Uniform(const float lo, const float hi) {
+    return lo + ((hi - lo) * RandomFloat());
+}
+
+static vec3 RandomUnitVector() {
+    return unit_vector(RandomInUnitSphere() + vec3(1e-6, 0, 0));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Time a kernel and print a line of results
+///
+/// @param  filter - Only run if the name contains this
+/// @param  name - Benchmark name
+/// @param  ops - Operations done by one call of the kernel
+/// @param  kernel - Function returning a float that depends on its work
+///////////////////////////////////////////////////////////////////////////////
+template <typename Kernel>
+static void Run(const std::string & filter, const char * name, const size_t ops, Kernel kernel) {
+    typedef std::chrono::steady_clock Clock;
+
+    if (std::string(name).find(filter) == std::string::npos) {
+        return;
+    }
+
+    // Warm up, and size the trials from the warm-up call
+    Clock::time_point start = Clock::now();
+    sink = sink + kernel();
+    const double once = std::max(std::chrono::duration<double>(Clock::now() - start).count(), 1e-9);
+    const size_t calls = std::max(size_t(1), size_t((BENCH_TRIAL_MS * 1e-3) / once));
+
+    std::vector<double> trials(BENCH_TRIALS);
+    for (size_t t = 0; t < trials.size(); ++t) {
+        float sum = 0.0;
+        start = Clock::now();
+        for (size_t c = 0; c < calls; ++c) {
+            sum += kernel();
+        }
+        trials[t] = (std::chrono::duration<double>(Clock::now() - start).count() * 1e9) / double(calls * ops);
+        sink = sink + sum;
+    }
+
+    std::sort(trials.begin(), trials.end());
+    const double median = trials[trials.size() / 2];
+
+    std::vector<double> deviations(trials.size());
+    for (size_t t = 0; t < trials.size(); ++t) {
+        deviations[t] = fabs(trials[t] - median);
+    }
+    std::sort(deviations.begin(), deviations.end());
+
+    printf("%-40s %10.2f %10.2f %9.1f%%\n", name, median, trials[0], (100.0 * deviations[deviations.size() / 2]) / median);
+    fflush(stdout);
+}
+
+// Rays from a sphere of radius 5 towards points in a cube around the unit
+// sphere at the origin; about half hit it
+static std::vector<Ray> SphereRays() {
+    std::vector<Ray> rays;
+    for (size_t i = 0; i < BENCH_RAYS; ++i) {
+        vec3 origin = 5.0F * RandomUnitVector();
+        vec3 target(Uniform(-1.5, 1.5), Uniform(-1.5, 1.5), Uniform(-1.5, 1.5));
+        rays.push_back(Ray(origin, target - origin));
+    }
+    return rays;
+}
+
+// Primary rays through random pixels of the default view
+static std::vector<Ray> CameraRays() {
+    Camera camera(vec3(13, 2, 3), vec3(0, 0, 0), vec3(0, 1, 0), 20.0, 2.0, 0.1, 10.0);
+    std::vector<Ray> rays;
+    for (size_t i = 0; i < BENCH_RAYS; ++i) {
+        rays.push_back(camera.get_ray(RandomFloat(), RandomFloat()));
+    }
+    return rays;
+}
+
+// Incoherent rays, like diffuse bounces: random origins just above the
+// ground among the spheres, random directions in the upper hemisphere
+static std::vector<Ray> BounceRays() {
+    std::vector<Ray> rays;
+    for (size_t i = 0; i < BENCH_RAYS; ++i) {
+        vec3 origin(Uniform(-11, 11), Uniform(0.01, 1.0), Uniform(-11, 11));
+        vec3 direction = RandomUnitVector();
+        rays.push_back(Ray(origin, vec3(direction.x(), fabs(direction.y()), direction.z())));
+    }
+    return rays;
+}
+
+// Hits of the camera rays, to scatter off
+static void SceneHits(Hittable * world, std::vector<Ray> & rays, std::vector<HitRecord> & records) {
+    std::vector<Ray> all = CameraRays();
+    for (size_t i = 0; i < all.size(); ++i) {
+        HitRecord record;
+        if (world->hit(all[i], 0.001, MAXFLOAT, record)) {
+            rays.push_back(all[i]);
+            records.push_back(record);
+        }
+    }
+}
+
+// Closest-hit distance summed over a ray set
+static float TraceAll(const Hittable & world, const std::vector<Ray> & rays) {
+    float sum = 0.0;
+    HitRecord record;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        if (world.hit(rays[i], 0.001, MAXFLOAT, record)) {
+            sum += record.t;
+        }
+    }
+    return sum;
+}
+
+// Rays whose closest hits differ between two hierarchies over the same objects
+static size_t Mismatches(const Hittable & a, const Hittable & b, const std::vector<Ray> & rays) {
+    size_t count = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        HitRecord ra;
+        HitRecord rb;
+        const bool ha = a.hit(rays[i], 0.001, MAXFLOAT, ra);
+        const bool hb = b.hit(rays[i], 0.001, MAXFLOAT, rb);
+        if ((ha != hb) || (ha && (ra.t != rb.t))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Uniform offsets in a cube of half-width amount, one per object or vertex
+static std::vector<vec3> RandomOffsets(const size_t n, const float amount) {
+    std::vector<vec3> offsets(n);
+    for (size_t i = 0; i < n; ++i) {
+        offsets[i] = vec3(Uniform(-amount, amount), Uniform(-amount, amount), Uniform(-amount, amount));
+    }
+    return offsets;
+}
+
+// Move every sphere of a RandomScene() but the ground by scale times its offset
+static void MoveSpheres(HittableList & scene, const std::vector<vec3> & offsets, const float scale) {
+    for (size_t i = 1; i < scene.size; ++i) {
+        static_cast<Sphere *>(scene.list[i])->centre += scale * offsets[i];
+    }
+}
+
+static void MoveVertices(TriangleMesh & mesh, const std::vector<vec3> & offsets, const float scale) {
+    for (size_t i = 0; i < mesh.vertex_storage.size(); ++i) {
+        mesh.vertex_storage[i] += scale * offsets[i];
+    }
+}
+
+// Print whether a refitted hierarchy hits like a fresh one; false if not
+static bool CheckRefit(const std::string & filter, const char * name, const bool rebuilt, const Hittable & refitted, const Hittable & fresh,
+    const std::vector<Ray> & rays) {
+    if (std::string(name).find(filter) == std::string::npos) {
+        return true;
+    }
+
+    const size_t differ = Mismatches(refitted, fresh, rays);
+    printf("%-40s %s, %s (%zu of %zu rays hit differently)\n", name, rebuilt ? "rebuilt" : "refitted", (differ == 0) ? "ok" : "MISMATCH",
+        differ, rays.size());
+    fflush(stdout);
+    return differ == 0;
+}
+
+// Print whether a helper thread started by a pinned thread may use every CPU;
+// false if not
+static bool CheckHelperThread(const std::string & filter) {
+    const char * name = "Pin check (helper thread)";
+    if (std::string(name).find(filter) == std::string::npos) {
+        return true;
+    }
+
+    if (!PinThread(0)) {
+        printf("%-40s skipped, threads cannot be pinned here\n", name);
+        return true;
+    }
+
+    bool unpinned = false;
+    StartHelperThread([&]() { unpinned = ThreadUnpinned(); }).join();
+    UnpinThread();
+    printf("%-40s %s\n", name, unpinned ? "ok" : "CONFINED");
+    fflush(stdout);
+    return unpinned;
+}
+
+static float ScatterAll(const Material & material, const std::vector<Ray> & rays, const std::vector<HitRecord> & records) {
+    float sum = 0.0;
+    vec3 attenuation;
+    Ray scattered;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        if (material.scatter(rays[i], records[i], attenuation, scattered)) {
+            sum += scattered.direction().x();
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char ** argv) {
+    const std::string filter = (argc > 1) ? argv[1] : "";
+
+    // Same scenes and inputs on every run
+    srand48(BENCH_SEED);
+    ThreadRandom().seed(BENCH_SEED);
+
+    HittableList * scene = RandomScene();
+    HittableList * mesh_scene = MeshScene();
+
+    BVHBuildOptions compressed;
+    compressed.compress_nodes = true;
+    BVHBuildOptions lbvh;
+    lbvh.method = BVHBuildMethod::LBVH;
+
+    BVH scene_bvh(scene->list, scene->size);
+    BVH scene_qbvh(scene->list, scene->size, compressed);
+    BVH scene_lbvh(scene->list, scene->size, lbvh);
+    BVH mesh_bvh(mesh_scene->list, mesh_scene->size);
+    BVH mesh_qbvh(mesh_scene->list, mesh_scene->size, compressed);
+
+    const Sphere sphere(vec3(0, 0, 0), 1.0, NULL);
+    const std::vector<Ray> sphere_rays = SphereRays();
+    const std::vector<Ray> camera_rays = CameraRays();
+    const std::vector<Ray> bounce_rays = BounceRays();
+
+    std::vector<Ray> hit_rays;
+    std::vector<HitRecord> hits;
+    SceneHits(&scene_bvh, hit_rays, hits);
+
+    std::vector<vec3> directions;
+    std::vector<vec3> normals;
+    std::vector<float> cosines;
+    for (size_t i = 0; i < BENCH_RAYS; ++i) {
+        directions.push_back(RandomUnitVector());
+        normals.push_back(RandomUnitVector());
+        cosines.push_back(RandomFloat());
+    }
+
+    const Lambertian lambertian(vec3(0.5, 0.5, 0.5));
+    const Metal metal(vec3(0.7, 0.6, 0.5), 0.3);
+    const Dielectric dielectric(1.5);
+
+    printf("%-40s %10s %10s %10s\n", "Benchmark", "ns/op", "min ns/op", "spread");
+
+    Run(filter, "Sphere::hit", sphere_rays.size(), [&]() {
+        return TraceAll(sphere, sphere_rays);
+    });
+    Run(filter, "HittableList::hit (random, camera)", camera_rays.size(), [&]() {
+        return TraceAll(*scene, camera_rays);
+    });
+    Run(filter, "BVH::hit (random, camera)", camera_rays.size(), [&]() {
+        return TraceAll(scene_bvh, camera_rays);
+    });
+    Run(filter, "BVH::hit (random, bounce)", bounce_rays.size(), [&]() {
+        return TraceAll(scene_bvh, bounce_rays);
+    });
+    Run(filter, "BVH::hit (random, LBVH, camera)", camera_rays.size(), [&]() {
+        return TraceAll(scene_lbvh, camera_rays);
+    });
+    Run(filter, "BVH::hit (random, compressed, camera)", camera_rays.size(), [&]() {
+        return TraceAll(scene_qbvh, camera_rays);
+    });
+    Run(filter, "BVH::hit (random, compressed, bounce)", bounce_rays.size(), [&]() {
+        return TraceAll(scene_qbvh, bounce_rays);
+    });
+    Run(filter, "BVH::hit (mesh, camera)", camera_rays.size(), [&]() {
+        return TraceAll(mesh_bvh, camera_rays);
+    });
+    Run(filter, "BVH::hit (mesh, compressed, camera)", camera_rays.size(), [&]() {
+        return TraceAll(mesh_qbvh, camera_rays);
+    });
+
+    // Geometry that moves between refits: each call moves it one way or
+    // back by its offsets. The ground is left out of the hierarchies, as its
+    // box would dwarf the others' and hide how much a refit loosens them
+    HittableList * moving = RandomScene();
+    const std::vector<vec3> sphere_offsets = RandomOffsets(moving->size, 0.05);
+    BVH moving_bvh(moving->list + 1, moving->size - 1);
+    BVH moving_qbvh(moving->list + 1, moving->size - 1, compressed);
+    TriangleMesh * deforming = UVSphereMesh(vec3(0, 0, 0), 1.0, 256, 128, NULL);
+    const std::vector<vec3> vertex_offsets = RandomOffsets(deforming->vertex_storage.size(), 0.002);
+    float direction = 1.0;
+
+    Run(filter, "BVH::rebuild (random, moved)", moving->size, [&]() {
+        MoveSpheres(*moving, sphere_offsets, direction);
+        direction = -direction;
+        moving_bvh.rebuild();
+        return 0.0F;
+    });
+    Run(filter, "BVH::refit (random, moved)", moving->size, [&]() {
+        MoveSpheres(*moving, sphere_offsets, direction);
+        direction = -direction;
+        return moving_bvh.refit() ? 1.0F : 0.0F;
+    });
+    Run(filter, "BVH::refit (random, compressed, moved)", moving->size, [&]() {
+        MoveSpheres(*moving, sphere_offsets, direction);
+        direction = -direction;
+        return moving_qbvh.refit() ? 1.0F : 0.0F;
+    });
+    Run(filter, "TriangleMesh::build (moved)", deforming->num_triangles(), [&]() {
+        MoveVertices(*deforming, vertex_offsets, direction);
+        direction = -direction;
+        deforming->build();
+        return 0.0F;
+    });
+    Run(filter, "TriangleMesh::refit (moved)", deforming->num_triangles(), [&]() {
+        MoveVertices(*deforming, vertex_offsets, direction);
+        direction = -direction;
+        return deforming->refit() ? 1.0F : 0.0F;
+    });
+    Run(filter, "Lambertian::scatter", hits.size(), [&]() {
+        return ScatterAll(lambertian, hit_rays, hits);
+    });
+    Run(filter, "Metal::scatter", hits.size(), [&]() {
+        return ScatterAll(metal, hit_rays, hits);
+    });
+    Run(filter, "Dielectric::scatter", hits.size(), [&]() {
+        return ScatterAll(dielectric, hit_rays, hits);
+    });
+    Run(filter, "RandomInUnitSphere", BENCH_RAYS, [&]() {
+        float sum = 0.0;
+        for (size_t i = 0; i < BENCH_RAYS; ++i) {
+            sum += RandomInUnitSphere().x();
+        }
+        return sum;
+    });
+    Run(filter, "Refract", directions.size(), [&]() {
+        float sum = 0.0;
+        vec3 refracted;
+        for (size_t i = 0; i < directions.size(); ++i) {
+            if (Refract(directions[i], normals[i], 1.0F / 1.5F, refracted)) {
+                sum += refracted.x();
+            }
+        }
+        return sum;
+    });
+    Run(filter, "Schlick", cosines.size(), [&]() {
+        float sum = 0.0;
+        for (size_t i = 0; i < cosines.size(); ++i) {
+            sum += Schlick(cosines[i], 1.5);
+        }
+        return sum;
+    });
+
+    // Small moves keep the tree; large ones should trip the rebuild threshold
+    std::vector<Ray> scene_rays = camera_rays;
+    scene_rays.insert(scene_rays.end(), bounce_rays.begin(), bounce_rays.end());
+    bool ok = true;
+    const float scales[2] = { 1.0, 40.0 };
+    const char * const sphere_names[2][2] = {
+        { "Refit check (random, small)", "Refit check (random, compressed, small)" },
+        { "Refit check (random, large)", "Refit check (random, compressed, large)" }
+    };
+    const char * const mesh_names[2] = { "Refit check (mesh, small)", "Refit check (mesh, large)" };
+    for (int32_t s = 0; s < 2; ++s) {
+        MoveSpheres(*moving, sphere_offsets, scales[s]);
+        const bool rebuilt = moving_bvh.refit();
+        const bool rebuilt_compressed = moving_qbvh.refit();
+        const BVH fresh(moving->list + 1, moving->size - 1);
+        ok = CheckRefit(filter, sphere_names[s][0], rebuilt, moving_bvh, fresh, scene_rays) && ok;
+        ok = CheckRefit(filter, sphere_names[s][1], rebuilt_compressed, moving_qbvh, fresh, scene_rays) && ok;
+
+        MoveVertices(*deforming, vertex_offsets, scales[s]);
+        const bool rebuilt_mesh = deforming->refit();
+        const TriangleMesh fresh_mesh(deforming->vertex_storage, deforming->index_storage, NULL);
+        ok = CheckRefit(filter, mesh_names[s], rebuilt_mesh, *deforming, fresh_mesh, sphere_rays) && ok;
+    }
+
+    ok = CheckHelperThread(filter) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: scenebench.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  End-to-end scene benchmarks
+///
+/// @detail Renders each benchmark scene at a fixed seed and sample count and
+///         writes the results as JSON: time, Mrays/s, samples/s, ray
+///         counts, peak RSS, per-phase times and a checksum of the image, so
+///         a speed-up that changes the picture is caught too.
+///
+///         Each scene runs in its own child process, so peak RSS is the
+///         scene's own and one scene's heap can't slow the next.
+///
+///         With --baseline, Mrays/s is compared against an earlier results
+///         file and the exit status is 1 if any scene slowed down by more
+///         than the tolerance.
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bvh.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "renderer.h"
+#include "scenes.h"
+#include "scheduler.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define BENCH_SEED 1            ///< Seed for scene generation
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct BenchOptions {
+    BenchOptions() : width(320), height(160), num_samples(16), num_threads(0), tolerance(5.0) {}
+
+    uint32_t width;                     ///< Image width
+    uint32_t height;                    ///< Image height
+    uint32_t num_samples;               ///< Samples per pixel
+    uint32_t num_threads;               ///< Render threads (0 = one per hardware thread)
+    std::vector<std::string> scenes;    ///< Scenes to run
+    std::string output;                 ///< Results file (empty = stdout)
+    std::string baseline;               ///< Earlier results to compare with
+    float tolerance;                    ///< Slowdown in percent that fails the comparison
+};
+
+struct BenchResult {
+    std::string name;                   ///< Scene name
+    std::string json;                   ///< Result object, empty if the scene failed
+    double mrays;                       ///< Mrays/s, for the comparison
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static void PrintUsage(const char * name) {
+    printf("Usage: %s [options]\n", name);
+    printf("\n");
+    printf("  -w, --width <pixels>      Image width (default 320)\n");
+    printf("  -h, --height <pixels>     Image height (default 160)\n");
+    printf("  -s, --samples <n>         Samples per pixel (default 16)\n");
+    printf("  -t, --threads <n>         Render threads (default: one per hardware thread)\n");
+    printf("  --scene <name>            Scene to run; repeat for several (default random,\n");
+    printf("                            field, glass and metal)\n");
+    printf("  -o, --output <file>       Write the results here (default stdout)\n");
+    printf("  --baseline <file>         Compare Mrays/s with an earlier results file\n");
+    printf("  --tolerance <percent>     Slowdown that fails the comparison (default 5)\n");
+}
+
+static bool ParseOptions(int argc, char ** argv, BenchOptions & options) {
+    static const struct option long_options[] = {
+        { "width",      required_argument,  NULL, 'w' },
+        { "height",     required_argument,  NULL, 'h' },
+        { "samples",    required_argument,  NULL, 's' },
+        { "threads",    required_argument,  NULL, 't' },
+        { "scene",      required_argument,  NULL, 'S' },
+        { "output",     required_argument,  NULL, 'o' },
+        { "baseline",   required_argument,  NULL, 'b' },
+        { "tolerance",  required_argument,  NULL, 'T' },
+        { "help",       no_argument,        NULL, '?' },
+        { NULL,         0,                  NULL, 0 }
+    };
+
+    int32_t c;
+    while ((c = getopt_long(argc, argv, "w:h:s:t:o:", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'w': options.width = strtoul(optarg, NULL, 10); break;
+        case 'h': options.height = strtoul(optarg, NULL, 10); break;
+        case 's': options.num_samples = strtoul(optarg, NULL, 10); break;
+        case 't': options.num_threads = strtoul(optarg, NULL, 10); break;
+        case 'o': options.output = optarg; break;
+        case 'b': options.baseline = optarg; break;
+        case 'T': options.tolerance = strtof(optarg, NULL); break;
+
+        case 'S':
+            if (!IsBuiltInScene(optarg)) {
+                fprintf(stderr, "Unknown scene '%s'\n", optarg);
+                return false;
+            }
+            options.scenes.push_back(optarg);
+            break;
+
+        default:
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if ((options.width == 0) || (options.height == 0) || (options.num_samples == 0)) {
+        fprintf(stderr, "Width, height and samples must be positive\n");
+        return false;
+    }
+
+    if (options.scenes.empty()) {
+        const char * defaults[] = { "random", "field", "glass", "metal" };
+        options.scenes.assign(defaults, defaults + 4);
+    }
+    return true;
+}
+
+// FNV-1a over the pixel sums
+static uint64_t Checksum(const Framebuffer & framebuffer) {
+    const uint8_t * bytes = (const uint8_t *) framebuffer.sums.data();
+    const size_t size = framebuffer.sums.size() * sizeof(vec3);
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Build and render a scene, and return its result object
+static std::string RunScene(const std::string & name, const BenchOptions & options) {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Scheduler::Configure(options.num_threads, false);
+
+    HittableList * scene;
+    BVH * world;
+    {
+        ScopedPhase phase(PHASE_SCENE);
+        srand48(BENCH_SEED);
+        scene = BuiltInScene(name);
+        world = new BVH(scene->list, scene->size);
+    }
+
+    // The default view
+    Camera camera(vec3(13, 2, 3), vec3(0, 0, 0), vec3(0, 1, 0), 20.0, float(options.width) / options.height, 0.1, 10.0);
+    Renderer renderer(camera, world);
+    Framebuffer framebuffer(options.width, options.height);
+    renderer.render(framebuffer, options.num_samples, [](const uint32_t) {});
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const StatsTotals totals = GatherStats();
+    const double render = totals.seconds[PHASE_RENDER];
+    const uint64_t rays = totals.counts[STAT_CAMERA_RAYS] + totals.counts[STAT_BOUNCE_RAYS];
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    char json[2048];
+    snprintf(json, sizeof(json),
+        "    {\n"
+        "      \"name\": \"%s\",\n"
+        "      \"primitives\": %zu,\n"
+        "      \"threads\": %u,\n"
+        "      \"seconds\": %.6f,\n"
+        "      \"mrays_per_second\": %.4f,\n"
+        "      \"msamples_per_second\": %.4f,\n"
+        "      \"peak_rss_kb\": %ld,\n"
+        "      \"phases\": { \"scene\": %.6f, \"render\": %.6f },\n"
+        "      \"rays\": { \"camera\": %llu, \"bounce\": %llu, \"primitive_tests\": %llu, \"node_visits\": %llu },\n"
+        "      \"checksum\": \"%016llx\"\n"
+        "    }",
+        name.c_str(), scene->size, Scheduler::Instance().size(), seconds, (rays / render) * 1e-6,
+        (totals.counts[STAT_CAMERA_RAYS] / render) * 1e-6, usage.ru_maxrss,
+        totals.seconds[PHASE_SCENE], render,
+        (unsigned long long) totals.counts[STAT_CAMERA_RAYS], (unsigned long long) totals.counts[STAT_BOUNCE_RAYS],
+        (unsigned long long) totals.counts[STAT_PRIMITIVE_TESTS], (unsigned long long) totals.counts[STAT_NODE_VISITS],
+        (unsigned long long) Checksum(framebuffer));
+    return json;
+}
+
+// Run a scene in a child process and collect its result object
+static bool RunChild(const std::string & name, const BenchOptions & options, std::string & json) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        std::string result = RunScene(name, options);
+        bool ok = write(pipe_fds[1], result.data(), result.size()) == ssize_t(result.size());
+        _exit(ok ? 0 : 1);
+    }
+
+    close(pipe_fds[1]);
+    json.clear();
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
+        json.append(buffer, n);
+    }
+    close(pipe_fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0) || json.empty()) {
+        fprintf(stderr, "Scene '%s' failed\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The number following "key": in a result object, or -1
+static double FindNumber(const std::string & json, const size_t from, const char * key) {
+    const std::string quoted = std::string("\"") + key + "\":";
+    size_t at = json.find(quoted, from);
+    return (at == std::string::npos) ? -1.0 : strtod(json.c_str() + at + quoted.size(), NULL);
+}
+
+// Compare with an earlier results file; false if any scene got too slow
+static bool Compare(const std::vector<BenchResult> & results, const BenchOptions & options) {
+    FILE * file = fopen(options.baseline.c_str(), "r");
+    if (file == NULL) {
+        perror(options.baseline.c_str());
+        return false;
+    }
+
+    std::string baseline;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        baseline.append(buffer, n);
+    }
+    fclose(file);
+
+    bool ok = true;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const size_t at = baseline.find("\"name\": \"" + results[i].name + "\"");
+        const double before = (at == std::string::npos) ? -1.0 : FindNumber(baseline, at, "mrays_per_second");
+        if (before <= 0.0) {
+            fprintf(stderr, "%-8s not in the baseline\n", results[i].name.c_str());
+            continue;
+        }
+
+        const double change = (100.0 * (results[i].mrays - before)) / before;
+        const bool slower = change < -options.tolerance;
+        fprintf(stderr, "%-8s %9.3f -> %9.3f Mrays/s  %+6.1f%%%s\n", results[i].name.c_str(), before, results[i].mrays, change, slower ? "  SLOWER" : "");
+        ok = ok && !slower;
+    }
+    return ok;
+}
+
+int main(int argc, char ** argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    bool ok = true;
+    std::vector<BenchResult> results;
+    for (size_t i = 0; i < options.scenes.size(); ++i) {
+        BenchResult result;
+        result.name = options.scenes[i];
+        if (!RunChild(result.name, options, result.json)) {
+            ok = false;
+            continue;
+        }
+        result.mrays = FindNumber(result.json, 0, "mrays_per_second");
+        fprintf(stderr, "%-8s %9.3f Mrays/s\n", result.name.c_str(), result.mrays);
+        results.push_back(result);
+    }
+
+    FILE * file = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+    if (file == NULL) {
+        perror(options.output.c_str());
+        return 1;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"compiler\": \"%s\",\n", __VERSION__);
+#ifdef VERSION_HASH
+    fprintf(file, "  \"version\": \"%s\",\n", VERSION_HASH);
+#endif
+    fprintf(file, "  \"width\": %u,\n", options.width);
+    fprintf(file, "  \"height\": %u,\n", options.height);
+    fprintf(file, "  \"samples\": %u,\n", options.num_samples);
+    fprintf(file, "  \"scenes\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        fprintf(file, "%s%s\n", results[i].json.c_str(), (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    if (file != stdout) {
+        fclose(file);
+    }
+
+    if (!options.baseline.empty()) {
+        ok = Compare(results, options) && ok;
+    }
+    return ok ? 0 : 1;
+}
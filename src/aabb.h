@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: aabb.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Axis-aligned bounding box
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef AABB_H
+#define AABB_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "vec3.h"
+#include "ray.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class AABB {
+public:
+    // Default box is empty (inverted) so that expanding it by anything works
+    AABB() : minimum(MAXFLOAT, MAXFLOAT, MAXFLOAT), maximum(-MAXFLOAT, -MAXFLOAT, -MAXFLOAT) {}
+    AABB(const vec3 & a, const vec3 & b) : minimum(a), maximum(b) {}
+
+    inline bool empty() const {
+        return (minimum.x() > maximum.x()) || (minimum.y() > maximum.y()) || (minimum.z() > maximum.z());
+    }
+
+    inline vec3 centroid() const { return 0.5F * (minimum + maximum); }
+    inline vec3 extent() const { return maximum - minimum; }
+
+    inline float surface_area() const {
+        if (empty()) {
+            return 0.0;
+        }
+
+        vec3 d = extent();
+        return 2.0F * ((d.x() * d.y()) + (d.y() * d.z()) + (d.z() * d.x()));
+    }
+
+    // Index of the axis with the largest extent (0 = X, 1 = Y, 2 = Z)
+    inline int32_t longest_axis() const {
+        vec3 d = extent();
+        if ((d.x() > d.y()) && (d.x() > d.z())) {
+            return 0;
+        }
+        return (d.y() > d.z()) ? 1 : 2;
+    }
+
+    inline void expand(const vec3 & p) {
+        for (int32_t a = 0; a < 3; ++a) {
+            minimum[a] = fminf(minimum[a], p[a]);
+            maximum[a] = fmaxf(maximum[a], p[a]);
+        }
+    }
+
+    inline void expand(const AABB & box) {
+        for (int32_t a = 0; a < 3; ++a) {
+            minimum[a] = fminf(minimum[a], box.minimum[a]);
+            maximum[a] = fmaxf(maximum[a], box.maximum[a]);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Slab test against a ray
+    ///
+    /// @param  ray - The ray
+    /// @param  inv_direction - Component-wise reciprocal of the ray direction
+    /// @param  t_min - Minimum ray parameter
+    /// @param  t_max - Maximum ray parameter
+    ///
+    /// @return True if the ray overlaps the box within [t_min, t_max]
+    ///////////////////////////////////////////////////////////////////////////
+    inline bool hit(const Ray & ray, const vec3 & inv_direction, float t_min, float t_max) const {
+        for (int32_t a = 0; a < 3; ++a) {
+            float t0 = (minimum[a] - ray.A[a]) * inv_direction[a];
+            float t1 = (maximum[a] - ray.A[a]) * inv_direction[a];
+
+            if (inv_direction[a] < 0.0F) {
+                float temp = t0;
+                t0 = t1;
+                t1 = temp;
+            }
+
+            // Widen the far distance by 2 * gamma(3) so rounding never rejects
+            // a ray grazing an edge or corner (Ize, "Robust BVH Ray Traversal")
+            t1 *= 1.00000072F;
+
+            // Written so that a NaN (0 * inf) leaves the interval untouched
+            t_min = (t0 > t_min) ? t0 : t_min;
+            t_max = (t1 < t_max) ? t1 : t_max;
+
+            if (t_max < t_min) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    vec3 minimum;   ///< Minimum corner
+    vec3 maximum;   ///< Maximum corner
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Box enclosing two boxes
+inline AABB SurroundingBox(const AABB & a, const AABB & b) {
+    AABB box = a;
+    box.expand(b);
+    return box;
+}
+
+#endif//AABB_H
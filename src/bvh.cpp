@@ -0,0 +1,908 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: bvh.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Bounding volume hierarchy
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <atomic>
+
+#include "bvh.h"
+#include "numa.h"
+#include "scheduler.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define SAH_BINS 16                 ///< Number of centroid bins per axis for the SAH builder
+#define TREELET_LEAVES 7            ///< Number of leaves in a re-optimized treelet
+#define RADIX_BITS 8                ///< Bits per radix sort pass
+#define RADIX_PARALLEL_MIN 65536    ///< Below this many keys the radix sort runs on one thread
+#define BUILD_PARALLEL_MIN 4096     ///< Subtrees of at least this many primitives build their halves in parallel
+#define REFIT_PARALLEL_MIN 4096     ///< Subtrees of at least this many nodes refit their halves in parallel
+#define REFIT_BOUNDS_GRAIN 1024     ///< Objects per task when gathering bounds for a refit
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const float TRAVERSAL_COST = 1.0;        ///< SAH cost of visiting an interior node
+static const float INTERSECTION_COST = 1.0;     ///< SAH cost of testing a primitive
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Pointer-based node used while building, before flattening
+struct BuildNode {
+    AABB bounds;            ///< Node bounds
+    int32_t children[2];    ///< Child indices, -1 for leaves
+    uint32_t first;         ///< First primitive (leaves)
+    uint32_t count;         ///< Number of primitives (leaves)
+    float cost;             ///< Unnormalized SAH cost of the subtree
+    uint32_t height;        ///< Interior levels below the node (0 for leaves)
+};
+
+struct BuildContext {
+    const std::vector<AABB> * bounds;   ///< Primitive bounds
+    std::vector<vec3> centroids;        ///< Primitive centroids
+    std::vector<uint32_t> * indices;    ///< Primitive ordering being built
+    std::vector<BuildNode> nodes;       ///< Build node arena, sized for the largest possible tree
+    std::atomic<uint32_t> num_nodes;    ///< Nodes allocated from the arena
+    BVHBuildOptions options;            ///< Build options
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static int32_t MakeLeaf(BuildContext & ctx, const uint32_t begin, const uint32_t end) {
+    BuildNode node;
+    node.children[0] = -1;
+    node.children[1] = -1;
+    node.first = begin;
+    node.count = end - begin;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        node.bounds.expand((*ctx.bounds)[(*ctx.indices)[i]]);
+    }
+    node.cost = INTERSECTION_COST * node.count * node.bounds.surface_area();
+    node.height = 0;
+
+    // Subtrees are built concurrently, so nodes land in the arena in no
+    // particular order; Flatten() only follows the child links
+    const uint32_t index = ctx.num_nodes++;
+    ctx.nodes[index] = node;
+    return index;
+}
+
+static int32_t MakeInterior(BuildContext & ctx, const int32_t left, const int32_t right) {
+    BuildNode node;
+    node.children[0] = left;
+    node.children[1] = right;
+    node.first = 0;
+    node.count = 0;
+    node.bounds = SurroundingBox(ctx.nodes[left].bounds, ctx.nodes[right].bounds);
+    node.cost = (TRAVERSAL_COST * node.bounds.surface_area()) + ctx.nodes[left].cost + ctx.nodes[right].cost;
+    node.height = 1 + std::max(ctx.nodes[left].height, ctx.nodes[right].height);
+
+    const uint32_t index = ctx.num_nodes++;
+    ctx.nodes[index] = node;
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SAH BUILDER
+///////////////////////////////////////////////////////////////////////////////
+static int32_t BuildSAH(BuildContext & ctx, const uint32_t begin, const uint32_t end, const uint32_t depth) {
+    std::vector<uint32_t> & indices = *ctx.indices;
+    const uint32_t n = end - begin;
+
+    if (n <= 1) {
+        return MakeLeaf(ctx, begin, end);
+    }
+
+    AABB bounds;
+    AABB centroid_bounds;
+    for (uint32_t i = begin; i < end; ++i) {
+        bounds.expand((*ctx.bounds)[indices[i]]);
+        centroid_bounds.expand(ctx.centroids[indices[i]]);
+    }
+
+    int32_t best_axis = -1;
+    int32_t best_bin = -1;
+    float best_cost = MAXFLOAT;
+
+    // Only bin if we are comfortably inside the depth limit; past it, fall
+    // back to median splits, which bound the remaining depth by log2(n)
+    if (depth < (BVH_MAX_DEPTH / 2)) {
+        for (int32_t axis = 0; axis < 3; ++axis) {
+            float lo = centroid_bounds.minimum[axis];
+            float extent = centroid_bounds.maximum[axis] - lo;
+            if (extent <= 0.0F) {
+                continue;
+            }
+
+            AABB bin_bounds[SAH_BINS];
+            uint32_t bin_counts[SAH_BINS] = { 0 };
+            float scale = SAH_BINS / extent;
+
+            for (uint32_t i = begin; i < end; ++i) {
+                int32_t b = std::min((int32_t)((ctx.centroids[indices[i]][axis] - lo) * scale), SAH_BINS - 1);
+                bin_counts[b]++;
+                bin_bounds[b].expand((*ctx.bounds)[indices[i]]);
+            }
+
+            // Sweep from the right to get the cost of every right-hand side
+            float right_area[SAH_BINS];
+            uint32_t right_count[SAH_BINS];
+            AABB accumulated;
+            uint32_t count = 0;
+            for (int32_t b = SAH_BINS - 1; b > 0; --b) {
+                accumulated.expand(bin_bounds[b]);
+                count += bin_counts[b];
+                right_area[b] = accumulated.surface_area();
+                right_count[b] = count;
+            }
+
+            // Sweep from the left, splitting before bin b
+            accumulated = AABB();
+            count = 0;
+            for (int32_t b = 1; b < SAH_BINS; ++b) {
+                accumulated.expand(bin_bounds[b - 1]);
+                count += bin_counts[b - 1];
+                if ((count == 0) || (right_count[b] == 0)) {
+                    continue;
+                }
+
+                float cost = (accumulated.surface_area() * count) + (right_area[b] * right_count[b]);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+    }
+
+    float leaf_cost = INTERSECTION_COST * n;
+    float split_cost = TRAVERSAL_COST + ((INTERSECTION_COST * best_cost) / bounds.surface_area());
+
+    if ((n <= ctx.options.max_leaf_size) && ((best_axis < 0) || (leaf_cost <= split_cost))) {
+        return MakeLeaf(ctx, begin, end);
+    }
+
+    uint32_t middle;
+    if (best_axis >= 0) {
+        float lo = centroid_bounds.minimum[best_axis];
+        float scale = SAH_BINS / (centroid_bounds.maximum[best_axis] - lo);
+        const std::vector<vec3> & centroids = ctx.centroids;
+
+        uint32_t * pivot = std::partition(&indices[begin], &indices[begin] + n, [&](const uint32_t i) {
+            int32_t b = std::min((int32_t)((centroids[i][best_axis] - lo) * scale), SAH_BINS - 1);
+            return b < best_bin;
+        });
+        middle = pivot - &indices[0];
+    } else {
+        // Coincident centroids or too deep: median split along the longest axis
+        int32_t axis = centroid_bounds.longest_axis();
+        const std::vector<vec3> & centroids = ctx.centroids;
+        middle = begin + (n / 2);
+
+        std::nth_element(&indices[begin], &indices[middle], &indices[begin] + n, [&](const uint32_t a, const uint32_t b) {
+            return centroids[a][axis] < centroids[b][axis];
+        });
+    }
+
+    // The halves are disjoint ranges of indices, so large ones are built as
+    // separate tasks
+    int32_t left;
+    int32_t right;
+    if (n >= BUILD_PARALLEL_MIN) {
+        TaskGroup group;
+        group.run([&]() { left = BuildSAH(ctx, begin, middle, depth + 1); });
+        right = BuildSAH(ctx, middle, end, depth + 1);
+        group.wait();
+    } else {
+        left = BuildSAH(ctx, begin, middle, depth + 1);
+        right = BuildSAH(ctx, middle, end, depth + 1);
+    }
+    return MakeInterior(ctx, left, right);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LBVH BUILDER
+///////////////////////////////////////////////////////////////////////////////
+
+// Spread the low 10 bits of v so there are two zero bits between each
+static inline uint64_t SpreadBits10(uint64_t v) {
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Spread the low 21 bits of v so there are two zero bits between each
+static inline uint64_t SpreadBits21(uint64_t v) {
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x001F00000000FFFFULL;
+    v = (v | (v << 16)) & 0x001F0000FF0000FFULL;
+    v = (v | (v << 8)) & 0x100F00F00F00F00FULL;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ULL;
+    v = (v | (v << 2)) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Stable LSD radix sort of (key, value) pairs on the low 'bits' bits of the key.
+// Each pass builds per-chunk digit histograms, turns them into per-chunk
+// scatter offsets, and scatters the chunks in parallel, so the sort is stable
+// and the output does not depend on the number of chunks.
+static void RadixSort(std::vector<uint64_t> & keys, std::vector<uint32_t> & values, const uint32_t bits) {
+    const size_t n = keys.size();
+    const uint32_t num_digits = 1 << RADIX_BITS;
+    Scheduler & scheduler = Scheduler::Instance();
+
+    uint32_t num_chunks = 1;
+    if (n >= RADIX_PARALLEL_MIN) {
+        num_chunks = scheduler.size();
+    }
+
+    std::vector<uint64_t> keys_out(n);
+    std::vector<uint32_t> values_out(n);
+    std::vector<size_t> offsets(num_chunks * num_digits);
+
+    const size_t chunk = (n + num_chunks - 1) / num_chunks;
+
+    for (uint32_t shift = 0; shift < bits; shift += RADIX_BITS) {
+        auto histogram = [&](const uint32_t t) {
+            size_t * counts = &offsets[t * num_digits];
+            std::fill(counts, counts + num_digits, 0);
+            for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i) {
+                counts[(keys[i] >> shift) & (num_digits - 1)]++;
+            }
+        };
+
+        auto scatter = [&](const uint32_t t) {
+            size_t * next = &offsets[t * num_digits];
+            for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i) {
+                size_t dst = next[(keys[i] >> shift) & (num_digits - 1)]++;
+                keys_out[dst] = keys[i];
+                values_out[dst] = values[i];
+            }
+        };
+
+        scheduler.parallel_for(num_chunks, histogram);
+
+        // Exclusive prefix sum, digit-major then chunk-minor
+        size_t sum = 0;
+        for (uint32_t d = 0; d < num_digits; ++d) {
+            for (uint32_t t = 0; t < num_chunks; ++t) {
+                size_t count = offsets[(t * num_digits) + d];
+                offsets[(t * num_digits) + d] = sum;
+                sum += count;
+            }
+        }
+
+        scheduler.parallel_for(num_chunks, scatter);
+
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
+}
+
+// Emit the hierarchy for the sorted range [begin, end) whose codes agree above 'bit'
+static int32_t EmitLBVH(BuildContext & ctx, const std::vector<uint64_t> & codes, const uint32_t begin, const uint32_t end, int32_t bit, const uint32_t depth) {
+    const uint32_t n = end - begin;
+
+    if (n <= ctx.options.max_leaf_size) {
+        return MakeLeaf(ctx, begin, end);
+    }
+
+    uint32_t middle = begin + (n / 2);
+
+    if (depth < (BVH_MAX_DEPTH / 2)) {
+        // Skip bits on which the whole range agrees; codes are sorted, so the
+        // range straddles a split at 'bit' exactly when its ends differ there
+        while ((bit >= 0) && (((codes[begin] ^ codes[end - 1]) >> bit) & 1) == 0) {
+            --bit;
+        }
+
+        if (bit >= 0) {
+            // Binary search for the first code with 'bit' set
+            uint32_t lo = begin;
+            uint32_t hi = end - 1;
+            while (lo + 1 < hi) {
+                uint32_t mid = lo + ((hi - lo) / 2);
+                if ((codes[mid] >> bit) & 1) {
+                    hi = mid;
+                } else {
+                    lo = mid;
+                }
+            }
+            middle = hi;
+            --bit;
+        }
+    }
+
+    int32_t left;
+    int32_t right;
+    if (n >= BUILD_PARALLEL_MIN) {
+        TaskGroup group;
+        group.run([&]() { left = EmitLBVH(ctx, codes, begin, middle, bit, depth + 1); });
+        right = EmitLBVH(ctx, codes, middle, end, bit, depth + 1);
+        group.wait();
+    } else {
+        left = EmitLBVH(ctx, codes, begin, middle, bit, depth + 1);
+        right = EmitLBVH(ctx, codes, middle, end, bit, depth + 1);
+    }
+    return MakeInterior(ctx, left, right);
+}
+
+static int32_t BuildLBVH(BuildContext & ctx) {
+    std::vector<uint32_t> & indices = *ctx.indices;
+    const size_t n = indices.size();
+    const uint32_t bits_per_axis = (ctx.options.morton_bits > 30) ? 21 : 10;
+    const float cells = (float)(1 << bits_per_axis);
+
+    AABB centroid_bounds;
+    for (size_t i = 0; i < n; ++i) {
+        centroid_bounds.expand(ctx.centroids[i]);
+    }
+
+    vec3 extent = centroid_bounds.extent();
+    std::vector<uint64_t> codes(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t q[3];
+        for (int32_t a = 0; a < 3; ++a) {
+            float f = (extent[a] > 0.0F) ? ((ctx.centroids[i][a] - centroid_bounds.minimum[a]) / extent[a]) : 0.0F;
+            q[a] = (uint64_t)std::min(std::max(f * cells, 0.0F), cells - 1.0F);
+        }
+
+        if (bits_per_axis == 21) {
+            codes[i] = (SpreadBits21(q[0]) << 2) | (SpreadBits21(q[1]) << 1) | SpreadBits21(q[2]);
+        } else {
+            codes[i] = (SpreadBits10(q[0]) << 2) | (SpreadBits10(q[1]) << 1) | SpreadBits10(q[2]);
+        }
+    }
+
+    RadixSort(codes, indices, 3 * bits_per_axis);
+
+    return EmitLBVH(ctx, codes, 0, n, (3 * bits_per_axis) - 1, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TREELET RE-OPTIMIZATION
+///////////////////////////////////////////////////////////////////////////////
+
+// Find the optimal topology for the treelet rooted at 'root' (Karras & Aila,
+// "Fast Parallel Construction of High-Quality Bounding Volume Hierarchies").
+// The treelet's leaves are subtrees; they are kept intact and only the
+// interior nodes above them are rearranged. A topology that would take the
+// tree deeper than BVH_MAX_DEPTH, with the root at 'depth', is not used.
+static void RestructureTreelet(BuildContext & ctx, const int32_t root, const uint32_t depth) {
+    std::vector<BuildNode> & nodes = ctx.nodes;
+
+    int32_t leaves[TREELET_LEAVES];
+    int32_t interiors[TREELET_LEAVES];
+    uint32_t num_leaves = 2;
+    uint32_t num_interiors = 0;
+
+    leaves[0] = nodes[root].children[0];
+    leaves[1] = nodes[root].children[1];
+
+    // Grow the treelet by repeatedly opening the leaf with the largest area
+    while (num_leaves < TREELET_LEAVES) {
+        int32_t best = -1;
+        float best_area = -1.0;
+        for (uint32_t i = 0; i < num_leaves; ++i) {
+            const BuildNode & node = nodes[leaves[i]];
+            if ((node.children[0] >= 0) && (node.bounds.surface_area() > best_area)) {
+                best = i;
+                best_area = node.bounds.surface_area();
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        int32_t opened = leaves[best];
+        interiors[num_interiors++] = opened;
+        leaves[best] = nodes[opened].children[0];
+        leaves[num_leaves++] = nodes[opened].children[1];
+    }
+
+    if (num_leaves < 3) {
+        return;
+    }
+
+    const uint32_t num_subsets = 1 << num_leaves;
+    float area[1 << TREELET_LEAVES];
+    float cost[1 << TREELET_LEAVES];
+    uint32_t split[1 << TREELET_LEAVES];
+    uint32_t height[1 << TREELET_LEAVES];
+
+    for (uint32_t s = 1; s < num_subsets; ++s) {
+        AABB box;
+        for (uint32_t i = 0; i < num_leaves; ++i) {
+            if (s & (1 << i)) {
+                box.expand(nodes[leaves[i]].bounds);
+            }
+        }
+        area[s] = box.surface_area();
+    }
+
+    // Subsets of s are numerically smaller than s, so increasing order is a
+    // valid dynamic programming order
+    for (uint32_t s = 1; s < num_subsets; ++s) {
+        if ((s & (s - 1)) == 0) {
+            cost[s] = nodes[leaves[__builtin_ctz(s)]].cost;
+            split[s] = 0;
+            height[s] = nodes[leaves[__builtin_ctz(s)]].height;
+            continue;
+        }
+
+        float best = MAXFLOAT;
+        uint32_t best_split = 0;
+        for (uint32_t p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+            float c = cost[p] + cost[s ^ p];
+            if (c < best) {
+                best = c;
+                best_split = p;
+            }
+        }
+
+        cost[s] = (TRAVERSAL_COST * area[s]) + best;
+        split[s] = best_split;
+        height[s] = 1 + std::max(height[best_split], height[s ^ best_split]);
+    }
+
+    // A lopsided treelet can be cheaper but deeper; the traversal stacks
+    // only hold BVH_MAX_DEPTH levels
+    const uint32_t full = num_subsets - 1;
+    if ((cost[full] >= nodes[root].cost * 0.9999F) || (depth + height[full] >= BVH_MAX_DEPTH)) {
+        return;
+    }
+
+    // Rebuild the interior nodes from the recorded splits, reusing the ones
+    // that were opened (a treelet with k leaves always has k - 2 of them)
+    struct Assignment { int32_t node; uint32_t subset; };
+    Assignment stack[TREELET_LEAVES];
+    Assignment order[TREELET_LEAVES];
+    uint32_t stack_size = 0;
+    uint32_t order_size = 0;
+    stack[stack_size++] = { root, full };
+
+    while (stack_size > 0) {
+        Assignment a = stack[--stack_size];
+        order[order_size++] = a;
+
+        uint32_t halves[2] = { split[a.subset], a.subset ^ split[a.subset] };
+        for (int32_t c = 0; c < 2; ++c) {
+            if ((halves[c] & (halves[c] - 1)) == 0) {
+                nodes[a.node].children[c] = leaves[__builtin_ctz(halves[c])];
+            } else {
+                int32_t child = interiors[--num_interiors];
+                nodes[a.node].children[c] = child;
+                stack[stack_size++] = { child, halves[c] };
+            }
+        }
+    }
+
+    // Children were assigned after their parents, so refresh in reverse
+    for (int32_t i = order_size - 1; i >= 0; --i) {
+        BuildNode & node = nodes[order[i].node];
+        node.bounds = SurroundingBox(nodes[node.children[0]].bounds, nodes[node.children[1]].bounds);
+        node.cost = cost[order[i].subset];
+        node.height = height[order[i].subset];
+    }
+}
+
+static void OptimizeTreelets(BuildContext & ctx, const int32_t index, const uint32_t depth) {
+    if (ctx.nodes[index].children[0] < 0) {
+        return;
+    }
+
+    // Bottom-up, so each treelet sees already-optimized subtrees. Their
+    // heights are up to date, and the nodes above keep their depths until
+    // their own turn
+    OptimizeTreelets(ctx, ctx.nodes[index].children[0], depth + 1);
+    OptimizeTreelets(ctx, ctx.nodes[index].children[1], depth + 1);
+
+    BuildNode & node = ctx.nodes[index];
+    node.height = 1 + std::max(ctx.nodes[node.children[0]].height, ctx.nodes[node.children[1]].height);
+    RestructureTreelet(ctx, index, depth);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FLATTENING
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t Flatten(const BuildContext & ctx, const int32_t index, std::vector<BVHNode> & nodes) {
+    const BuildNode & build_node = ctx.nodes[index];
+    uint32_t flat_index = nodes.size();
+
+    nodes.push_back(BVHNode());
+    nodes[flat_index].bounds = build_node.bounds;
+
+    if (build_node.children[0] < 0) {
+        nodes[flat_index].offset = build_node.first;
+        nodes[flat_index].count = build_node.count;
+        nodes[flat_index].axis = 0;
+        return flat_index;
+    }
+
+    // Order the children along the axis on which their centres are furthest apart
+    vec3 d = ctx.nodes[build_node.children[1]].bounds.centroid() - ctx.nodes[build_node.children[0]].bounds.centroid();
+    d = vec3(fabsf(d.x()), fabsf(d.y()), fabsf(d.z()));
+    uint16_t axis = ((d.x() > d.y()) && (d.x() > d.z())) ? 0 : ((d.y() > d.z()) ? 1 : 2);
+
+    const BuildNode & first = ctx.nodes[build_node.children[0]];
+    const BuildNode & second = ctx.nodes[build_node.children[1]];
+    bool swap = first.bounds.centroid()[axis] > second.bounds.centroid()[axis];
+
+    Flatten(ctx, build_node.children[swap ? 1 : 0], nodes);
+    uint32_t right = Flatten(ctx, build_node.children[swap ? 0 : 1], nodes);
+
+    nodes[flat_index].offset = right;
+    nodes[flat_index].count = 0;
+    nodes[flat_index].axis = axis;
+    return flat_index;
+}
+
+void BuildBVH(const std::vector<AABB> & bounds, const BVHBuildOptions & options, std::vector<BVHNode> & nodes, std::vector<uint32_t> & indices) {
+    TraceSpan span("BVH build", "scene", bounds.size());
+    const size_t n = bounds.size();
+
+    nodes.clear();
+    indices.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        indices[i] = i;
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    BuildContext ctx;
+    ctx.bounds = &bounds;
+    ctx.indices = &indices;
+    ctx.options = options;
+    ctx.options.max_leaf_size = std::min(std::max(options.max_leaf_size, 1U), 255U);
+    ctx.nodes.resize(2 * n);
+    ctx.num_nodes = 0;
+
+    ctx.centroids.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        ctx.centroids[i] = bounds[i].centroid();
+    }
+
+    int32_t root;
+    if (options.method == BVHBuildMethod::LBVH) {
+        root = BuildLBVH(ctx);
+        for (uint32_t pass = 0; pass < options.treelet_passes; ++pass) {
+            OptimizeTreelets(ctx, root, 0);
+        }
+    } else {
+        root = BuildSAH(ctx, 0, n, 0);
+    }
+    ctx.nodes.resize(ctx.num_nodes);
+
+    nodes.reserve(ctx.nodes.size());
+    Flatten(ctx, root, nodes);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// REFITTING
+///////////////////////////////////////////////////////////////////////////////
+static void RefitNode(std::vector<BVHNode> & nodes, const std::vector<AABB> & bounds, const uint32_t index) {
+    BVHNode & node = nodes[index];
+    if (node.count > 0) {
+        AABB box;
+        for (uint32_t k = node.offset; k < node.offset + node.count; ++k) {
+            box.expand(bounds[k]);
+        }
+        node.bounds = box;
+        return;
+    }
+
+    // The left subtree fills the nodes up to the right child
+    const uint32_t left = index + 1;
+    const uint32_t right = node.offset;
+    if (right - left >= REFIT_PARALLEL_MIN) {
+        TaskGroup group;
+        group.run([&]() { RefitNode(nodes, bounds, left); });
+        RefitNode(nodes, bounds, right);
+        group.wait();
+    } else {
+        RefitNode(nodes, bounds, left);
+        RefitNode(nodes, bounds, right);
+    }
+    node.bounds = SurroundingBox(nodes[left].bounds, nodes[right].bounds);
+}
+
+void RefitBVH(std::vector<BVHNode> & nodes, const std::vector<AABB> & bounds) {
+    TraceSpan span("BVH refit", "scene", nodes.size());
+    if (!nodes.empty()) {
+        RefitNode(nodes, bounds, 0);
+    }
+}
+
+void MotionBVHBounds(std::vector<BVHNode> & nodes, const std::vector<AABB> & start, const std::vector<AABB> & end, std::vector<AABB> & end_bounds) {
+    std::vector<BVHNode> at_end = nodes;
+    RefitBVH(at_end, end);
+    RefitBVH(nodes, start);
+
+    end_bounds.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        end_bounds[i] = at_end[i].bounds;
+    }
+}
+
+float BVHCost(const std::vector<BVHNode> & nodes, const std::vector<AABB> * end_bounds) {
+    if (nodes.empty()) {
+        return 0.0;
+    }
+
+    float cost = 0.0;
+    float root_area = 0.0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        AABB box = nodes[i].bounds;
+        if (end_bounds != NULL) {
+            const AABB & end = (*end_bounds)[i];
+            box = AABB(0.5F * (box.minimum + end.minimum), 0.5F * (box.maximum + end.maximum));
+        }
+
+        if (i == 0) {
+            root_area = box.surface_area();
+        }
+        if (nodes[i].count > 0) {
+            cost += INTERSECTION_COST * nodes[i].count * box.surface_area();
+        } else {
+            cost += TRAVERSAL_COST * box.surface_area();
+        }
+    }
+
+    return cost / root_area;
+}
+
+float QBVHCost(const std::vector<QBVHNode> & compressed) {
+    if (compressed.empty()) {
+        return 0.0;
+    }
+
+    float cost = 0.0;
+    float root_area = 0.0;
+    for (size_t i = 0; i < compressed.size(); ++i) {
+        const QBVHNode & node = compressed[i];
+        AABB bounds;
+        for (uint32_t c = 0; c < node.num_children; ++c) {
+            AABB box;
+            for (int32_t a = 0; a < 3; ++a) {
+                const float scale = QBVHScale(node.exponent[a]);
+                box.minimum[a] = node.origin[a] + (node.lo[a][c] * scale);
+                box.maximum[a] = node.origin[a] + (node.hi[a][c] * scale);
+            }
+            bounds.expand(box);
+
+            if (node.count[c] > 0) {
+                cost += INTERSECTION_COST * node.count[c] * box.surface_area();
+            }
+        }
+
+        if (i == 0) {
+            root_area = bounds.surface_area();
+        }
+        cost += TRAVERSAL_COST * bounds.surface_area();
+    }
+
+    return cost / root_area;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BVH HITTABLE
+///////////////////////////////////////////////////////////////////////////////
+BVH::BVH(Hittable ** list, const size_t n, const BVHBuildOptions & o) : primitives(list, list + n), options(o) {
+    rebuild();
+}
+
+void BVH::rebuild() {
+    const size_t n = primitives.size();
+    std::vector<AABB> bounds(n);
+    std::vector<uint32_t> indices;
+    bool moving = false;
+
+    // Moving objects are placed by their bounds over the whole frame
+    for (size_t i = 0; i < n; ++i) {
+        AABB start;
+        AABB end;
+        primitives[i]->bounding_box(bounds[i]);
+        moving = primitives[i]->motion_bounds(start, end) || moving;
+    }
+
+    BuildBVH(bounds, options, nodes, indices);
+
+    // Store the objects in leaf order so leaves address them directly
+    std::vector<Hittable *> ordered(n);
+    for (size_t i = 0; i < n; ++i) {
+        ordered[i] = primitives[indices[i]];
+    }
+    primitives.swap(ordered);
+
+    root_bounds = nodes.empty() ? AABB() : nodes[0].bounds;
+    end_bounds.clear();
+    if (moving) {
+        std::vector<AABB> start(n);
+        std::vector<AABB> end(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!primitives[i]->motion_bounds(start[i], end[i])) {
+                start[i] = bounds[indices[i]];
+                end[i] = start[i];
+            }
+        }
+        MotionBVHBounds(nodes, start, end, end_bounds);
+    }
+
+    compressed.clear();
+    if (options.compress_nodes && !moving) {
+        CompressBVH(nodes, compressed);
+        std::vector<BVHNode>().swap(nodes);
+    }
+    built_cost = cost();
+
+    if (!replicas.empty()) {
+        replicate();
+    }
+}
+
+bool BVH::refit() {
+    const size_t n = primitives.size();
+    if (n == 0) {
+        return false;
+    }
+
+    std::vector<AABB> bounds(n);
+    std::vector<AABB> start;
+    std::vector<AABB> end;
+    const bool was_moving = !end_bounds.empty();
+    if (was_moving) {
+        start.resize(n);
+        end.resize(n);
+    }
+
+    std::atomic<uint32_t> num_moving(0);
+    Scheduler::Instance().parallel_for(uint32_t(n), [&](const uint32_t i) {
+        AABB s;
+        AABB e;
+        primitives[i]->bounding_box(bounds[i]);
+        const bool moving = primitives[i]->motion_bounds(s, e);
+        if (moving) {
+            ++num_moving;
+        }
+        if (was_moving) {
+            start[i] = moving ? s : bounds[i];
+            end[i] = moving ? e : bounds[i];
+        }
+    }, REFIT_BOUNDS_GRAIN);
+
+    // The hierarchy needs end boxes added or dropped
+    if ((num_moving > 0) != was_moving) {
+        rebuild();
+        return true;
+    }
+
+    if (!compressed.empty()) {
+        root_bounds = RefitQBVH(compressed, bounds);
+    } else if (was_moving) {
+        MotionBVHBounds(nodes, start, end, end_bounds);
+        root_bounds = SurroundingBox(nodes[0].bounds, end_bounds[0]);
+    } else {
+        RefitBVH(nodes, bounds);
+        root_bounds = nodes[0].bounds;
+    }
+
+    if (cost() > built_cost * (1.0F + options.rebuild_threshold)) {
+        rebuild();
+        return true;
+    }
+
+    if (!replicas.empty()) {
+        replicate();
+    }
+    return false;
+}
+
+float BVH::cost() const {
+    if (!compressed.empty()) {
+        return QBVHCost(compressed);
+    }
+    return BVHCost(nodes, end_bounds.empty() ? NULL : &end_bounds);
+}
+
+void BVH::replicate() {
+    const uint32_t num_nodes = NumNumaNodes();
+    replicas.clear();
+    if (num_nodes < 2) {
+        return;
+    }
+
+    // Each copy is allocated and written by a thread on its node, so its
+    // pages are that node's
+    replicas.resize(num_nodes);
+    for (uint32_t node = 0; node < num_nodes; ++node) {
+        RunOnNumaNode(node, [&]() {
+            replicas[node].nodes = nodes;
+            replicas[node].compressed = compressed;
+            replicas[node].primitives = primitives;
+            replicas[node].end_bounds = end_bounds;
+        });
+    }
+}
+
+bool BVH::hit(const Ray & r, const float t_min, const float t_max, HitRecord & record) const {
+    if (primitives.empty()) {
+        return false;
+    }
+
+    const BVHNode * flat = nodes.data();
+    const QBVHNode * quantized = compressed.data();
+    const AABB * ends = end_bounds.data();
+    Hittable * const * objects = primitives.data();
+    if (!replicas.empty()) {
+        const BVHReplica & replica = replicas[ThreadNumaNode()];
+        flat = replica.nodes.data();
+        quantized = replica.compressed.data();
+        ends = replica.end_bounds.data();
+        objects = replica.primitives.data();
+    }
+
+    auto leaf = [&](const uint32_t first, const uint32_t count, const float leaf_t_min, float & closest_so_far) {
+        bool hit_anything = false;
+        for (uint32_t i = first; i < first + count; ++i) {
+            if (objects[i]->hit(r, leaf_t_min, closest_so_far, record)) {
+                hit_anything = true;
+                closest_so_far = record.t;
+            }
+        }
+        return hit_anything;
+    };
+
+    float closest_so_far = t_max;
+    if (!compressed.empty()) {
+        return TraverseQBVH(quantized, r, t_min, closest_so_far, leaf);
+    }
+    if (!end_bounds.empty()) {
+        return TraverseMotionBVH(flat, ends, r, t_min, closest_so_far, leaf);
+    }
+    return TraverseBVH(flat, r, t_min, closest_so_far, leaf);
+}
+
+bool BVH::bounding_box(AABB & box) const {
+    if (primitives.empty()) {
+        return false;
+    }
+
+    box = root_bounds;
+    return true;
+}
+
+bool BVH::motion_bounds(AABB & start, AABB & end) const {
+    if (end_bounds.empty()) {
+        return false;
+    }
+
+    start = nodes[0].bounds;
+    end = end_bounds[0];
+    return true;
+}
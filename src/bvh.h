@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: bvh.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Bounding volume hierarchy
+///
+/// @detail The builders work on plain arrays of primitive bounds and produce
+///         a flattened, depth-first node array plus a primitive ordering, so
+///         any primitive type can sit under the same hierarchy. Two builders
+///         are provided:
+///
+///         - SAH:  binned surface area heuristic, slow to build, best quality
+///         - LBVH: Morton-code sort (parallel radix sort) and linear-time
+///                 emission, fast to build, optionally improved afterwards by
+///                 treelet re-optimization
+///
+///         Either hierarchy can then be collapsed into the compressed 4-wide
+///         format of qbvh.h for traversal.
+///
+///         Over objects that move during the frame, each node also keeps its
+///         box at the end of the frame and traversal tests the box between
+///         the two at the ray's time, so a fast object only widens the boxes
+///         above it by as much as it moves in that ray's instant. Such
+///         hierarchies keep the binary nodes, which the compressed format
+///         has no room to pair.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BVH_H
+#define BVH_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "aabb.h"
+#include "hittable.h"
+#include "qbvh.h"
+#include "ray.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define BVH_MAX_DEPTH 64    ///< Maximum tree depth, and so the traversal stack size
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+enum class BVHBuildMethod {
+    SAH,    ///< Binned surface area heuristic
+    LBVH    ///< Linear BVH over Morton-sorted centroids
+};
+
+struct BVHBuildOptions {
+    BVHBuildOptions() : method(BVHBuildMethod::SAH), max_leaf_size(4), morton_bits(30), treelet_passes(0), compress_nodes(false), rebuild_threshold(0.3) {}
+
+    BVHBuildMethod method;      ///< Builder to use
+    uint32_t max_leaf_size;     ///< Maximum number of primitives per leaf
+    uint32_t morton_bits;       ///< LBVH Morton code length: 30 (10 bits per axis) or 63 (21 bits per axis)
+    uint32_t treelet_passes;    ///< LBVH treelet re-optimization passes (0 = off)
+    bool compress_nodes;        ///< Traverse 4-wide quantized nodes instead of the binary ones
+    float rebuild_threshold;    ///< BVH::refit() rebuilds once the SAH cost has grown by this fraction since the last build
+};
+
+struct BVHNode {
+    AABB bounds;        ///< Node bounds
+    uint32_t offset;    ///< Interior: index of the right child (the left child is the next node). Leaf: first primitive
+    uint16_t count;     ///< Number of primitives in a leaf, 0 for interior nodes
+    uint16_t axis;      ///< Axis along which the children are ordered
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Build a hierarchy over a set of primitive bounds
+///
+/// @param  bounds - Bounds of each primitive
+/// @param  options - Build options
+/// @param  nodes - Output flattened nodes, root first
+/// @param  indices - Output primitive ordering; leaves index into this array
+///////////////////////////////////////////////////////////////////////////////
+void BuildBVH(const std::vector<AABB> & bounds, const BVHBuildOptions & options, std::vector<BVHNode> & nodes, std::vector<uint32_t> & indices);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Refit a hierarchy to moved primitives, keeping its shape
+///
+/// @detail Bottom-up: each leaf takes the union of its primitives' boxes and
+///         each interior node the union of its children's, with large
+///         subtrees refit in parallel. Linear in the nodes, so much cheaper
+///         than a build, but the hierarchy only stays good while the
+///         primitives keep roughly their relative places.
+///
+/// @param  nodes - Flattened nodes, root first
+/// @param  bounds - Box of the primitive in each leaf slot
+///////////////////////////////////////////////////////////////////////////////
+void RefitBVH(std::vector<BVHNode> & nodes, const std::vector<AABB> & bounds);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Split a hierarchy's boxes into the start and end of the frame
+///
+/// @detail The hierarchy is built over each primitive's box for the whole
+///         frame; this refits every node to the primitives' boxes at time 0
+///         and records its box at time 1 beside it. Both are unions of the
+///         boxes below, so interpolating a node's pair bounds its subtree at
+///         any time for primitives that move linearly.
+///
+/// @param  nodes - Flattened nodes, root first; refit to their time 0 boxes
+/// @param  start - Box at time 0 of the primitive in each leaf slot
+/// @param  end - Box at time 1 of the primitive in each leaf slot
+/// @param  end_bounds - Output box of each node at time 1
+///////////////////////////////////////////////////////////////////////////////
+void MotionBVHBounds(std::vector<BVHNode> & nodes, const std::vector<AABB> & start, const std::vector<AABB> & end, std::vector<AABB> & end_bounds);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Surface area heuristic cost of a hierarchy, normalized to the root
+///
+/// @param  nodes - Flattened nodes, root first
+/// @param  end_bounds - Node boxes at time 1 (see MotionBVHBounds()), to cost
+///                      the boxes halfway through the frame; NULL if static
+///////////////////////////////////////////////////////////////////////////////
+float BVHCost(const std::vector<BVHNode> & nodes, const std::vector<AABB> * end_bounds = NULL);
+
+// Surface area heuristic cost of a compressed hierarchy's quantized boxes,
+// normalized to the root
+float QBVHCost(const std::vector<QBVHNode> & compressed);
+
+// TraverseBVH() with the box of node i given by node_bounds(i)
+template <typename BoundsFunction, typename LeafFunction>
+inline bool TraverseBVHBounds(const BVHNode * nodes, BoundsFunction & node_bounds, const Ray & ray, const float t_min, float & t_max, LeafFunction & leaf);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Closest-hit traversal of a flattened hierarchy
+///
+/// @param  nodes - Flattened nodes, root first
+/// @param  ray - The ray
+/// @param  t_min - Minimum ray parameter
+/// @param  t_max - Maximum ray parameter; shrunk to the closest hit
+/// @param  leaf - Called as leaf(first, count, t_min, t_max) for each leaf the
+///                ray reaches; returns true (and shrinks t_max) on a hit
+///
+/// @return True if any leaf reported a hit
+///////////////////////////////////////////////////////////////////////////////
+template <typename LeafFunction>
+inline bool TraverseBVH(const BVHNode * nodes, const Ray & ray, const float t_min, float & t_max, LeafFunction & leaf) {
+    auto node_bounds = [nodes](const uint32_t index) -> const AABB & { return nodes[index].bounds; };
+    return TraverseBVHBounds(nodes, node_bounds, ray, t_min, t_max, leaf);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Closest-hit traversal of a hierarchy over moving objects
+///
+/// @detail Same contract as TraverseBVH(), testing each node against its
+///         box interpolated to the ray's time.
+///
+/// @param  nodes - Flattened nodes, root first, with their boxes at time 0
+/// @param  end_bounds - Box of each node at time 1 (see MotionBVHBounds())
+///////////////////////////////////////////////////////////////////////////////
+template <typename LeafFunction>
+inline bool TraverseMotionBVH(const BVHNode * nodes, const AABB * end_bounds, const Ray & ray, const float t_min, float & t_max, LeafFunction & leaf) {
+    const float time = ray.time();
+    auto node_bounds = [nodes, end_bounds, time](const uint32_t index) {
+        const AABB & start = nodes[index].bounds;
+        const AABB & end = end_bounds[index];
+        return AABB(start.minimum + (time * (end.minimum - start.minimum)), start.maximum + (time * (end.maximum - start.maximum)));
+    };
+    return TraverseBVHBounds(nodes, node_bounds, ray, t_min, t_max, leaf);
+}
+
+template <typename BoundsFunction, typename LeafFunction>
+inline bool TraverseBVHBounds(const BVHNode * nodes, BoundsFunction & node_bounds, const Ray & ray, const float t_min, float & t_max, LeafFunction & leaf) {
+    const vec3 inv_direction(1.0F / ray.B.x(), 1.0F / ray.B.y(), 1.0F / ray.B.z());
+    const bool negative[3] = { inv_direction.x() < 0.0F, inv_direction.y() < 0.0F, inv_direction.z() < 0.0F };
+
+    uint32_t stack[BVH_MAX_DEPTH];
+    uint32_t stack_size = 0;
+    uint32_t index = 0;
+    uint32_t visits = 0;
+    bool hit_anything = false;
+
+    while (true) {
+        const BVHNode & node = nodes[index];
+        ++visits;
+
+        if (node_bounds(index).hit(ray, inv_direction, t_min, t_max)) {
+            if (node.count > 0) {
+                if (leaf(node.offset, node.count, t_min, t_max)) {
+                    hit_anything = true;
+                }
+            } else {
+                // Visit the near child first so the far one is more likely to be culled
+                if (negative[node.axis]) {
+                    stack[stack_size++] = index + 1;
+                    index = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    index = index + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            break;
+        }
+        index = stack[--stack_size];
+    }
+
+    CountStat(STAT_NODE_VISITS, visits);
+    return hit_anything;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+// A copy of a hierarchy's arrays in one NUMA node's memory
+struct BVHReplica {
+    std::vector<BVHNode> nodes;             ///< Flattened nodes
+    std::vector<QBVHNode> compressed;       ///< Compressed nodes
+    std::vector<Hittable *> primitives;     ///< Objects in leaf order
+    std::vector<AABB> end_bounds;           ///< Node boxes at time 1
+};
+
+class BVH : public Hittable {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  BVH constructor
+    ///
+    /// @param  list - List of hittable objects, all of which must be bounded
+    /// @param  n - Number of objects
+    /// @param  options - Build options
+    ///////////////////////////////////////////////////////////////////////////
+    BVH(Hittable ** list, const size_t n, const BVHBuildOptions & options = BVHBuildOptions());
+
+    virtual bool hit(const Ray & r, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
+    virtual bool motion_bounds(AABB & start, AABB & end) const;
+
+    // Rebuild over the same objects after some of them moved (e.g. instances)
+    void rebuild();
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Update the hierarchy after some of its objects moved
+    ///
+    /// @detail Refits the boxes to the objects' new bounds, keeping the tree,
+    ///         unless that leaves its SAH cost more than
+    ///         options.rebuild_threshold above the cost after the last build,
+    ///         or an object started or stopped moving over the frame; then it
+    ///         rebuilds. The objects must be the same ones, none added or
+    ///         removed.
+    ///
+    /// @return True if the hierarchy was rebuilt
+    ///////////////////////////////////////////////////////////////////////////
+    bool refit();
+
+    // Copy the nodes and primitive pointers to each NUMA node, for threads
+    // pinned there to traverse; does nothing on a single node
+    void replicate();
+
+    std::vector<BVHNode> nodes;             ///< Flattened nodes, root first (empty if compressed)
+    std::vector<QBVHNode> compressed;       ///< Compressed nodes, root first (empty if not compressed)
+    std::vector<AABB> end_bounds;           ///< Node boxes at time 1, beside the nodes' at time 0 (empty if nothing moves)
+    AABB root_bounds;                       ///< Bounds of everything
+    float built_cost;                       ///< SAH cost right after the last rebuild()
+    std::vector<Hittable *> primitives;     ///< Objects in leaf order
+    BVHBuildOptions options;                ///< Options the hierarchy was built with
+    std::vector<BVHReplica> replicas;       ///< Per-node copies, indexed by ThreadNumaNode() (empty if not replicated)
+
+private:
+    // SAH cost of the hierarchy in whichever form it is kept
+    float cost() const;
+};
+
+#endif//BVH_H
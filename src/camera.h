@@ -35,8 +35,12 @@ public:
     /// @param  aspect_ratio - Ratio of width to height
     /// @param  aperture - The aperture setting
     /// @param  focal_distance - The focal distance in pixels
+    /// @param  shutter_open - Time within the frame (0 to 1) the shutter opens
+    /// @param  shutter_close - Time the shutter closes; rays are cast at
+    ///                         times spread evenly between the two
     ///////////////////////////////////////////////////////////////////////////
-    Camera(const vec3 & look_from, const vec3 & look_at, const vec3 & vup, const float vertical_fov, const float aspect_ratio, const float aperture, const float focal_distance) {
+    Camera(const vec3 & look_from, const vec3 & look_at, const vec3 & vup, const float vertical_fov, const float aspect_ratio, const float aperture, const float focal_distance,
+           const float shutter_open = 0.0F, const float shutter_close = 0.0F) : time0(shutter_open), time1(shutter_close) {
         // Convert FOV to radians
         float theta = vertical_fov * M_PI / 180.0;
 
@@ -60,10 +64,16 @@ public:
         vertical = 2.0 * half_height * focal_distance * v;
     }
 
-    Ray get_ray(const float s, const float t) {
+    Ray get_ray(const float s, const float t) const {
         vec3 disk = lens_radius * RandomInUnitDisk();
         vec3 offset = (u * disk.x()) + (v * disk.y());
-        return Ray(origin + offset, lower_left_corner + (s * horizontal) + (t * vertical) - origin - offset);
+
+        // An instantaneous shutter draws nothing, so stills keep their random sequence
+        float time = time0;
+        if (time1 > time0) {
+            time += RandomFloat() * (time1 - time0);
+        }
+        return Ray(origin + offset, lower_left_corner + (s * horizontal) + (t * vertical) - origin - offset, time);
     }
 
     vec3 origin;                ///< Origin
@@ -74,6 +84,8 @@ public:
     vec3 u;                     ///< X axis vector
     vec3 v;                     ///< Y axis vector
     vec3 w;                     ///< Z axis vector
+    float time0;                ///< Shutter open time
+    float time1;                ///< Shutter close time
 };
 
 #endif//CAMERA_H
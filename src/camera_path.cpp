@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: camera_path.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Keyframed camera paths for animations
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camera_path.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const char * const PARAMETER_NAMES[NUM_CAMERA_PARAMETERS] = {
+    "look-from", "look-at", "fov", "aperture", "focal-distance"
+};
+
+static const uint32_t PARAMETER_SIZES[NUM_CAMERA_PARAMETERS] = { 3, 3, 1, 1, 1 };
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Parse n comma-separated finite floats filling the whole of text
+static bool ParseValues(const char * text, const uint32_t n, float * values) {
+    const char * p = text;
+    for (uint32_t i = 0; i < n; ++i) {
+        char * end = NULL;
+        values[i] = strtof(p, &end);
+        if ((end == p) || (*end != ((i + 1 < n) ? ',' : '\0')) || !isfinite(values[i])) {
+            return false;
+        }
+        p = end + 1;
+    }
+    return true;
+}
+
+// The limits the command line puts on the scalar parameters; NULL if the
+// value is within them
+static const char * CheckValue(const int32_t parameter, const float value) {
+    if ((parameter == CAMERA_FOV) && !((value > 0.0F) && (value < 180.0F))) {
+        return "fov must be between 0 and 180 degrees";
+    } else if ((parameter == CAMERA_APERTURE) && !(value >= 0.0F)) {
+        return "aperture must not be negative";
+    } else if ((parameter == CAMERA_FOCAL_DISTANCE) && !(value > 0.0F)) {
+        return "focal-distance must be positive";
+    }
+    return NULL;
+}
+
+bool CameraPath::load(const char * path) {
+    FILE * file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[4096];
+    bool ok = true;
+    for (uint32_t number = 1; ok && (fgets(line, sizeof(line), file) != NULL); ++number) {
+        char * comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char * save = NULL;
+        char * token = strtok_r(line, " \t\r\n", &save);
+        if (token == NULL) {
+            continue;
+        }
+
+        char * end = NULL;
+        const unsigned long frame = strtoul(token, &end, 10);
+        if ((end == token) || (*end != '\0') || (frame > 0xFFFFFFFFUL)) {
+            fprintf(stderr, "%s:%u: expected a frame number, not '%s'\n", path, number, token);
+            ok = false;
+            break;
+        }
+
+        while (ok && ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL)) {
+            char * equals = strchr(token, '=');
+            int32_t parameter = 0;
+            if (equals != NULL) {
+                *equals = '\0';
+                while ((parameter < NUM_CAMERA_PARAMETERS) && (strcmp(token, PARAMETER_NAMES[parameter]) != 0)) {
+                    ++parameter;
+                }
+            }
+
+            CameraKey key = { (uint32_t)frame, { 0, 0, 0 } };
+            const char * problem = NULL;
+            if ((equals == NULL) || (parameter == NUM_CAMERA_PARAMETERS)) {
+                fprintf(stderr, "%s:%u: expected <parameter>=<value>, with parameter look-from, look-at, fov, aperture or focal-distance\n", path, number);
+                ok = false;
+            } else if (!ParseValues(equals + 1, PARAMETER_SIZES[parameter], key.value)) {
+                fprintf(stderr, "%s:%u: invalid value for %s: '%s'\n", path, number, token, equals + 1);
+                ok = false;
+            } else if ((problem = CheckValue(parameter, key.value[0])) != NULL) {
+                fprintf(stderr, "%s:%u: %s\n", path, number, problem);
+                ok = false;
+            } else if (!keys[parameter].empty() && (keys[parameter].back().frame >= key.frame)) {
+                fprintf(stderr, "%s:%u: frames must be in increasing order, each keying %s once\n", path, number, token);
+                ok = false;
+            } else {
+                keys[parameter].push_back(key);
+            }
+        }
+    }
+    fclose(file);
+
+    if (ok && (length() == 0)) {
+        fprintf(stderr, "%s: no keyframes\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+bool CameraPath::apply(const uint32_t frame, Options & options) const {
+    float * targets[NUM_CAMERA_PARAMETERS] = {
+        &options.look_from[0], &options.look_at[0], &options.vertical_fov, &options.aperture, &options.focal_distance
+    };
+
+    for (int32_t parameter = 0; parameter < NUM_CAMERA_PARAMETERS; ++parameter) {
+        const std::vector<CameraKey> & k = keys[parameter];
+        const uint32_t n = PARAMETER_SIZES[parameter];
+        if (k.empty()) {
+            continue;
+        }
+
+        // Held before the first key and after the last
+        if (frame <= k.front().frame) {
+            std::copy(k.front().value, k.front().value + n, targets[parameter]);
+            continue;
+        }
+        if (frame >= k.back().frame) {
+            std::copy(k.back().value, k.back().value + n, targets[parameter]);
+            continue;
+        }
+
+        // The keys either side, and their neighbours for the tangents
+        // (repeated at the ends)
+        size_t i = 0;
+        while (k[i + 1].frame <= frame) {
+            ++i;
+        }
+        const CameraKey & k0 = k[(i > 0) ? (i - 1) : i];
+        const CameraKey & k1 = k[i];
+        const CameraKey & k2 = k[i + 1];
+        const CameraKey & k3 = k[std::min(i + 2, k.size() - 1)];
+
+        // Cubic Hermite with Catmull-Rom tangents, scaled for uneven spacing
+        const float span = float(k2.frame - k1.frame);
+        const float t = float(frame - k1.frame) / span;
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        const float h00 = (2.0F * t3) - (3.0F * t2) + 1.0F;
+        const float h10 = t3 - (2.0F * t2) + t;
+        const float h01 = (-2.0F * t3) + (3.0F * t2);
+        const float h11 = t3 - t2;
+
+        for (uint32_t c = 0; c < n; ++c) {
+            const float m1 = (k2.value[c] - k0.value[c]) * span / float(k2.frame - k0.frame);
+            const float m2 = (k3.value[c] - k1.value[c]) * span / float(k3.frame - k1.frame);
+            targets[parameter][c] = (h00 * k1.value[c]) + (h10 * m1) + (h01 * k2.value[c]) + (h11 * m2);
+        }
+
+        // Positions may swing past their keys, but a scalar between two
+        // keys within its limits stays within them
+        if (n == 1) {
+            targets[parameter][0] = std::min(std::max(targets[parameter][0], std::min(k1.value[0], k2.value[0])), std::max(k1.value[0], k2.value[0]));
+        }
+    }
+
+    return (options.look_from - options.look_at).squared_length() > 0.0F;
+}
+
+uint32_t CameraPath::length() const {
+    uint32_t end = 0;
+    for (int32_t parameter = 0; parameter < NUM_CAMERA_PARAMETERS; ++parameter) {
+        if (!keys[parameter].empty()) {
+            end = std::max(end, keys[parameter].back().frame + 1);
+        }
+    }
+    return end;
+}
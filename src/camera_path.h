@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: camera_path.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Keyframed camera paths for animations
+///
+/// @detail A path file keys camera parameters at frame numbers, one frame
+///         per line, with '#' starting a comment:
+///
+///             # frame  parameters
+///             0        look-from=13,2,3 look-at=0,0,0 fov=20
+///             48       look-from=0,3,-13 aperture=0
+///             96       look-from=-13,2,3 fov=30
+///
+///         The parameters are those of the camera options: look-from,
+///         look-at, fov, aperture and focal-distance. Each is interpolated on
+///         its own between the frames that key it, along a Catmull-Rom
+///         spline, so the camera moves smoothly through its keys; before its
+///         first key and after its last it holds still, and a parameter that
+///         is never keyed keeps its command-line value. Keys obey the same
+///         limits as the options, and fov, aperture and focal-distance stay
+///         between the values of the keys either side, so the spline can't
+///         overshoot out of range.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <vector>
+#include <stdint.h>
+
+#include "options.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum CameraParameter {
+    CAMERA_LOOK_FROM,           ///< Camera position
+    CAMERA_LOOK_AT,             ///< Point looked at
+    CAMERA_FOV,                 ///< Vertical field of view in degrees
+    CAMERA_APERTURE,            ///< Lens diameter
+    CAMERA_FOCAL_DISTANCE,      ///< Distance to the plane in focus
+    NUM_CAMERA_PARAMETERS
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// One parameter's value at one frame; scalars use value[0]
+struct CameraKey {
+    uint32_t frame;     ///< Frame number
+    float value[3];     ///< Value
+};
+
+class CameraPath {
+public:
+    // Read a path file; false (after printing why) if it can't be used
+    bool load(const char * path);
+
+    // Set the camera options of options to their values at a frame. False if
+    // they put look-from on look-at there
+    bool apply(const uint32_t frame, Options & options) const;
+
+    // One past the last frame anything is keyed at
+    uint32_t length() const;
+
+    std::vector<CameraKey> keys[NUM_CAMERA_PARAMETERS];     ///< Keys of each parameter, in frame order
+};
+
+#endif//CAMERA_PATH_H
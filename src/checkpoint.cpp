@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: checkpoint.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Render checkpoints
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "numa.h"
+#include "stats.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const char CHECKPOINT_MAGIC[8] = { 'R', 'A', 'Y', 'C', 'K', 'P', 'T', '\0' };
+static const uint32_t CHECKPOINT_VERSION = 3;
+static const uint32_t SIGNAL_POLL_MS = 100;     ///< How often the background thread looks for signals
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Fixed-size file header; pixel sums (3 floats), squared luminance sums
+// (float) and counts (uint32) follow, top row first, in the machine's byte
+// order
+struct CheckpointHeader {
+    char magic[8];          ///< CHECKPOINT_MAGIC
+    uint32_t version;       ///< CHECKPOINT_VERSION
+    uint32_t width;         ///< Image width
+    uint32_t height;        ///< Image height
+    uint32_t first_sample;  ///< Index of the first sample in the sums (0 unless a --sample-range part)
+    uint64_t seed;          ///< Render seed
+    uint32_t left;          ///< Frame column of the image's left edge (0 unless a --crop)
+    uint32_t top;           ///< Frame row of the image's top edge
+    uint32_t frame_width;   ///< Frame width
+    uint32_t frame_height;  ///< Frame height
+};
+
+// One of the files being merged
+struct MergePart {
+    std::string path;           ///< File
+    Framebuffer framebuffer;    ///< Its pixels
+    uint64_t seed;              ///< Render seed
+    uint32_t first;             ///< First sample
+    uint32_t end;               ///< One past the last sample of the most-sampled pixel
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+bool SaveCheckpoint(const char * path, const Framebuffer & framebuffer, const uint64_t seed, const uint32_t first_sample) {
+    ScopedPhase phase(PHASE_CHECKPOINT);
+    const std::string temporary = std::string(path) + ".tmp";
+    const size_t n = size_t(framebuffer.width) * framebuffer.height;
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.width = framebuffer.width;
+    header.height = framebuffer.height;
+    header.seed = seed;
+    header.first_sample = first_sample;
+    header.left = framebuffer.left;
+    header.top = framebuffer.top;
+    header.frame_width = framebuffer.frame_width;
+    header.frame_height = framebuffer.frame_height;
+
+    FILE * file = fopen(temporary.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s\n", temporary.c_str(), strerror(errno));
+        return false;
+    }
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(framebuffer.sums.data(), sizeof(vec3), n, file) == n) &&
+        (fwrite(framebuffer.squares.data(), sizeof(float), n, file) == n) &&
+        (fwrite(framebuffer.samples.data(), sizeof(uint32_t), n, file) == n) &&
+        (fflush(file) == 0) && (fsync(fileno(file)) == 0);
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || (rename(temporary.c_str(), path) != 0)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool LoadCheckpoint(const char * path, Framebuffer & framebuffer, uint64_t & seed, uint32_t & first_sample) {
+    FILE * file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    CheckpointHeader header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) || (header.version != CHECKPOINT_VERSION)) {
+        fprintf(stderr, "%s: not a checkpoint file\n", path);
+        fclose(file);
+        return false;
+    }
+
+    if ((framebuffer.width == 0) && (framebuffer.height == 0)) {
+        framebuffer = Framebuffer(header.width, header.height, header.left, header.top, header.frame_width, header.frame_height);
+    } else if ((header.width != framebuffer.width) || (header.height != framebuffer.height)) {
+        fprintf(stderr, "%s: checkpoint is %ux%u, not %ux%u\n", path, header.width, header.height, framebuffer.width, framebuffer.height);
+        fclose(file);
+        return false;
+    } else if ((header.left != framebuffer.left) || (header.top != framebuffer.top) ||
+        (header.frame_width != framebuffer.frame_width) || (header.frame_height != framebuffer.frame_height)) {
+        fprintf(stderr, "%s: checkpoint is of the %ux%u window at %u,%u of a %ux%u frame, not at %u,%u of a %ux%u frame\n", path,
+            header.width, header.height, header.left, header.top, header.frame_width, header.frame_height,
+            framebuffer.left, framebuffer.top, framebuffer.frame_width, framebuffer.frame_height);
+        fclose(file);
+        return false;
+    }
+
+    const size_t n = size_t(framebuffer.width) * framebuffer.height;
+    bool ok = (fread(framebuffer.sums.data(), sizeof(vec3), n, file) == n) &&
+        (fread(framebuffer.squares.data(), sizeof(float), n, file) == n) &&
+        (fread(framebuffer.samples.data(), sizeof(uint32_t), n, file) == n);
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "%s: truncated checkpoint\n", path);
+        framebuffer.clear();
+        return false;
+    }
+
+    seed = header.seed;
+    first_sample = header.first_sample;
+    return true;
+}
+
+// Sum parts of one window over their sample ranges into framebuffer
+static bool SumParts(std::vector<MergePart> & parts, Framebuffer & framebuffer, bool & contiguous) {
+    // Summed in sample order, so the result doesn't depend on the order the
+    // parts were listed in
+    std::sort(parts.begin(), parts.end(), [](const MergePart & a, const MergePart & b) { return a.first < b.first; });
+
+    for (size_t i = 1; i < parts.size(); ++i) {
+        if (parts[i].first < parts[i - 1].end) {
+            fprintf(stderr, "%s and %s both have samples %u-%u\n", parts[i - 1].path.c_str(), parts[i].path.c_str(),
+                parts[i].first, std::min(parts[i].end, parts[i - 1].end) - 1);
+            return false;
+        }
+
+        if (parts[i].first > parts[i - 1].end) {
+            fprintf(stderr, "Warning: no part has samples %u-%u\n", parts[i - 1].end, parts[i].first - 1);
+            contiguous = false;
+        }
+    }
+
+    framebuffer = parts[0].framebuffer;
+    for (size_t i = 1; i < parts.size(); ++i) {
+        const Framebuffer & part = parts[i].framebuffer;
+        for (size_t k = 0; k < framebuffer.samples.size(); ++k) {
+            framebuffer.sums[k] += part.sums[k];
+            framebuffer.squares[k] += part.squares[k];
+            framebuffer.samples[k] += part.samples[k];
+        }
+    }
+    return true;
+}
+
+bool MergeCheckpoints(const std::vector<std::string> & paths, Framebuffer & framebuffer, uint64_t & seed, uint32_t & first_sample, bool & contiguous) {
+    std::vector<MergePart> parts;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        MergePart part = { paths[i], Framebuffer(0, 0), 0, 0, 0 };
+        if (!LoadCheckpoint(paths[i].c_str(), part.framebuffer, part.seed, part.first)) {
+            return false;
+        }
+
+        if (!parts.empty() && ((part.seed != parts[0].seed) || (part.framebuffer.frame_width != parts[0].framebuffer.frame_width) ||
+            (part.framebuffer.frame_height != parts[0].framebuffer.frame_height))) {
+            fprintf(stderr, "%s: not a part of the same frame as %s\n", paths[i].c_str(), paths[0].c_str());
+            return false;
+        }
+
+        part.end = part.first + *std::max_element(part.framebuffer.samples.begin(), part.framebuffer.samples.end());
+        parts.push_back(part);
+    }
+
+    if (parts.empty()) {
+        fprintf(stderr, "Nothing to merge\n");
+        return false;
+    }
+
+    // Group the parts by window, largest window first (in the order listed
+    // among windows of the same size)
+    std::stable_sort(parts.begin(), parts.end(), [](const MergePart & a, const MergePart & b) {
+        return (size_t(a.framebuffer.width) * a.framebuffer.height) > (size_t(b.framebuffer.width) * b.framebuffer.height);
+    });
+    std::vector<std::vector<MergePart>> windows;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        size_t w = 0;
+        while ((w < windows.size()) && !windows[w][0].framebuffer.same_window(parts[i].framebuffer)) {
+            ++w;
+        }
+        if (w == windows.size()) {
+            windows.push_back(std::vector<MergePart>());
+        }
+        windows[w].push_back(parts[i]);
+    }
+
+    contiguous = true;
+    if (!SumParts(windows[0], framebuffer, contiguous)) {
+        return false;
+    }
+    first_sample = windows[0][0].first;
+    seed = windows[0][0].seed;
+
+    // Smaller windows are crops re-rendered over the largest; their pixels
+    // replace the ones underneath, where they have any samples
+    for (size_t w = 1; w < windows.size(); ++w) {
+        Framebuffer crop(0, 0);
+        if (!SumParts(windows[w], crop, contiguous)) {
+            return false;
+        }
+
+        const std::string & path = windows[w][0].path;
+        if ((crop.left < framebuffer.left) || (crop.top < framebuffer.top) ||
+            (crop.left + crop.width > framebuffer.left + framebuffer.width) || (crop.top + crop.height > framebuffer.top + framebuffer.height)) {
+            fprintf(stderr, "%s: crop is not inside %s\n", path.c_str(), windows[0][0].path.c_str());
+            return false;
+        }
+
+        // Otherwise the pasted pixels couldn't be carried on by --resume
+        if (windows[w][0].first != first_sample) {
+            fprintf(stderr, "%s: crop starts at sample %u, not %u\n", path.c_str(), windows[w][0].first, first_sample);
+            return false;
+        }
+
+        for (uint32_t y = 0; y < crop.height; ++y) {
+            for (uint32_t x = 0; x < crop.width; ++x) {
+                const size_t k = (size_t(y) * crop.width) + x;
+                if (crop.samples[k] > 0) {
+                    framebuffer.set(crop.left - framebuffer.left + x, crop.top - framebuffer.top + y, crop.sums[k], crop.squares[k], crop.samples[k]);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CHECKPOINTER
+///////////////////////////////////////////////////////////////////////////////
+static volatile sig_atomic_t interrupted = 0;
+
+static void OnInterrupt(int) {
+    interrupted = 1;
+}
+
+Checkpointer::Checkpointer(const std::string & p, const uint32_t i, Renderer & r, const Framebuffer & f) :
+    path(p), interval(i), renderer(r), framebuffer(f), copy(0, 0), stopping(false) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = OnInterrupt;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    thread = StartHelperThread([this]() { run(); });
+}
+
+Checkpointer::~Checkpointer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool Checkpointer::Interrupted() {
+    return interrupted != 0;
+}
+
+bool Checkpointer::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+    return save();
+}
+
+bool Checkpointer::save() {
+    renderer.snapshot(framebuffer, copy);
+    return SaveCheckpoint(path.c_str(), copy, renderer.seed, renderer.first_sample);
+}
+
+void Checkpointer::run() {
+    SetTraceThreadName("checkpoint");
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point next = Clock::now() + std::chrono::seconds(interval);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::milliseconds(SIGNAL_POLL_MS));
+
+        if (interrupted) {
+            fprintf(stderr, "Interrupted, stopping after the rows in progress\n");
+            renderer.cancel();
+            return;
+        }
+
+        if (!stopping && (interval > 0) && (Clock::now() >= next)) {
+            lock.unlock();
+            save();
+            lock.lock();
+            next = Clock::now() + std::chrono::seconds(interval);
+        }
+    }
+}
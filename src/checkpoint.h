@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: checkpoint.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Render checkpoints
+///
+/// @detail A checkpoint holds the framebuffer's per-pixel sums and sample
+///         counts plus the render seed. The random state needs nothing more:
+///         the renderer derives each pixel's sequence from the seed, the
+///         pixel and its sample count, so a resumed render carries on with
+///         exactly the samples it would have taken.
+///
+///         Files are written to a temporary name and renamed into place, so
+///         a job killed mid-write leaves the previous checkpoint intact.
+///
+///         The same format holds the parts of a frame split by sample range:
+///         each records the index of its first sample, and parts covering
+///         disjoint ranges sum to the frame rendered with all of them. It
+///         also records the window of the frame a --crop render covers, so a
+///         re-rendered region can be pasted back over the whole frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framebuffer.h"
+#include "renderer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Each returns false after printing the reason to stderr
+bool SaveCheckpoint(const char * path, const Framebuffer & framebuffer, const uint64_t seed, const uint32_t first_sample);
+
+// A 0x0 framebuffer takes the file's size and window; any other must match them
+bool LoadCheckpoint(const char * path, Framebuffer & framebuffer, uint64_t & seed, uint32_t & first_sample);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Sum the parts of a frame rendered over different sample ranges
+///
+/// @detail Parts of the same window are summed. The parts of smaller
+///         windows (crops) are summed the same way and then pasted over the
+///         largest window, replacing the pixels they have samples for.
+///
+/// @param  paths - Part files, in any order
+/// @param  framebuffer - Set to the largest window, with the crops pasted in
+/// @param  seed - Set to the parts' seed
+/// @param  first_sample - Set to the first sample of the earliest part
+/// @param  contiguous - Cleared if some samples between the parts are missing
+///                      (a warning is printed); the sum is still usable
+///
+/// @return False if the parts are of different frames or overlap, or a crop
+///         is outside the largest window or starts at a different sample
+///////////////////////////////////////////////////////////////////////////////
+bool MergeCheckpoints(const std::vector<std::string> & paths, Framebuffer & framebuffer, uint64_t & seed, uint32_t & first_sample, bool & contiguous);
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Saves checkpoints of a frame in progress every few seconds, and on SIGINT
+// or SIGTERM cancels the render so a final checkpoint can be written. A
+// second signal kills the process as usual
+class Checkpointer {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Checkpointer constructor; starts the background thread
+    ///
+    /// @param  p - Checkpoint path
+    /// @param  i - Seconds between checkpoints
+    /// @param  r - Renderer drawing the frame
+    /// @param  f - Framebuffer being rendered into
+    ///////////////////////////////////////////////////////////////////////////
+    Checkpointer(const std::string & p, const uint32_t i, Renderer & r, const Framebuffer & f);
+    ~Checkpointer();
+
+    // Stop the background thread and write a final checkpoint
+    bool finish();
+
+    // True if a signal cancelled the render
+    static bool Interrupted();
+
+private:
+    bool save();
+    void run();
+
+    std::string path;                       ///< Checkpoint path
+    uint32_t interval;                      ///< Seconds between checkpoints
+    Renderer & renderer;                    ///< Renderer drawing the frame
+    const Framebuffer & framebuffer;        ///< Framebuffer being rendered into
+    Framebuffer copy;                       ///< Snapshot being written
+    std::thread thread;                     ///< Background thread
+    std::mutex mutex;                       ///< Guards stopping
+    std::condition_variable wake;           ///< Signalled to stop
+    bool stopping;                          ///< Background thread should exit
+};
+
+#endif//CHECKPOINT_H
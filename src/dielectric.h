@@ -58,10 +58,10 @@ public:
         }
 
         // Roll a random number to reflect or refract
-        if (drand48() < reflection_probability) {
-            scattered = Ray(record.p, reflected);
+        if (RandomFloat() < reflection_probability) {
+            scattered = Ray(record.p, reflected, ray.time());
         } else {
-            scattered = Ray(record.p, refracted);
+            scattered = Ray(record.p, refracted, ray.time());
         }
 
         return true;
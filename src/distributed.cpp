@@ -0,0 +1,505 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: distributed.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Rendering across processes
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "distributed.h"
+#include "numa.h"
+#include "socket_io.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const uint32_t PROTOCOL_MAGIC = 0x44594152;     ///< "RAYD" in little-endian order
+static const uint32_t PROTOCOL_VERSION = 1;
+static const uint32_t MAX_MESSAGE_BYTES = 1U << 30;     ///< Longer lengths are treated as corrupt
+static const uint32_t CONNECT_RETRY_MS = 100;           ///< Time between a worker's connection attempts
+static const uint32_t CONNECT_TIMEOUT_MS = 10000;       ///< A worker gives up after this long
+static const int COORDINATOR_POLL_MS = 500;             ///< How often the coordinator checks its local workers
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum MessageType {
+    MESSAGE_HELLO = 1,          ///< Worker: magic, version
+    MESSAGE_JOB,                ///< Coordinator: seed, argument count, then each argument's length and bytes
+    MESSAGE_TASK,               ///< Coordinator: task, first row, end row
+    MESSAGE_RESULT,             ///< Worker: task, first row, end row, then the rows' sums, squares and counts
+    MESSAGE_DONE                ///< Coordinator: the frame is finished
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct MessageHeader {
+    uint32_t type;              ///< MessageType
+    uint32_t length;            ///< Payload bytes that follow
+};
+
+// Reads values off the front of a payload
+class PayloadReader {
+public:
+    explicit PayloadReader(const std::vector<uint8_t> & p) : payload(p), offset(0) {}
+
+    bool read(void * data, const size_t size) {
+        if (size > payload.size() - offset) {
+            return false;
+        }
+        memcpy(data, payload.data() + offset, size);
+        offset += size;
+        return true;
+    }
+
+    template <typename T>
+    bool read(T & value) {
+        return read(&value, sizeof(T));
+    }
+
+    size_t left() const {
+        return payload.size() - offset;
+    }
+
+private:
+    const std::vector<uint8_t> & payload;   ///< Payload read
+    size_t offset;                          ///< Bytes read so far
+};
+
+// A band of rows, [begin, end)
+struct Band {
+    uint32_t begin;             ///< First row
+    uint32_t end;               ///< One past the last row
+};
+
+// A connected worker, as the coordinator sees it
+struct Peer {
+    int fd;                     ///< Socket, -1 once dropped
+    uint32_t id;                ///< Connection number, for messages
+    bool ready;                 ///< Said hello and was sent the job
+    int32_t task;               ///< Band being rendered, -1 if idle
+    std::vector<uint8_t> input; ///< Bytes received but not yet handled
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static void Append(std::vector<uint8_t> & payload, const void * data, const size_t size) {
+    const uint8_t * bytes = static_cast<const uint8_t *>(data);
+    payload.insert(payload.end(), bytes, bytes + size);
+}
+
+template <typename T>
+static void Append(std::vector<uint8_t> & payload, const T & value) {
+    Append(payload, &value, sizeof(T));
+}
+
+static bool SendMessage(const int fd, const MessageType type, const std::vector<uint8_t> & payload) {
+    MessageHeader header;
+    header.type = type;
+    header.length = uint32_t(payload.size());
+    return SendAll(fd, &header, sizeof(header)) && SendAll(fd, payload.data(), payload.size());
+}
+
+// Blocking; false on a closed connection or a corrupt header
+static bool ReceiveMessage(const int fd, uint32_t & type, std::vector<uint8_t> & payload) {
+    MessageHeader header;
+    if (!ReceiveAll(fd, &header, sizeof(header)) || (header.length > MAX_MESSAGE_BYTES)) {
+        return false;
+    }
+
+    type = header.type;
+    payload.resize(header.length);
+    return ReceiveAll(fd, payload.data(), payload.size());
+}
+
+// Fork and exec workers on this host. An address listening on every
+// interface is connected to through the loopback
+static std::vector<pid_t> SpawnWorkers(const Options & options, const std::string & address, const char * program) {
+    std::vector<pid_t> children;
+    if (options.workers == 0) {
+        return children;
+    }
+
+    bool local = false;
+    std::string host;
+    std::string port;
+    ParseAddress(address, local, host, port);
+
+    std::string target = address;
+    if (!local && (host.empty() || (host == "0.0.0.0") || (host == "::"))) {
+        target = "localhost:" + port;
+    }
+
+    // Split the coordinator's threads between the workers
+    const uint32_t total = (options.num_threads > 0) ? options.num_threads : std::max(std::thread::hardware_concurrency(), 1U);
+    const std::string threads = std::to_string(std::max(total / options.workers, 1U));
+
+    // A child inherits the affinity of the thread that forks it, which
+    // --pin-threads has put on one CPU; the topology is read before forking,
+    // so the child only makes system calls before exec
+    NumNumaNodes();
+
+    for (uint32_t i = 0; i < options.workers; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            UnpinThread();
+            execl("/proc/self/exe", program, "--work", target.c_str(), "-t", threads.c_str(), (char *) NULL);
+            fprintf(stderr, "Cannot start worker: %s\n", strerror(errno));
+            _exit(127);
+        }
+
+        if (pid < 0) {
+            fprintf(stderr, "Cannot start worker: %s\n", strerror(errno));
+            break;
+        }
+        children.push_back(pid);
+    }
+    return children;
+}
+
+// Close a worker's connection and put its band back at the front of the queue
+static void DropPeer(Peer & peer, std::deque<uint32_t> & pending, const std::vector<Band> & bands, const char * reason) {
+    if (peer.task >= 0) {
+        fprintf(stderr, "Worker %u %s; reassigning rows %u-%u\n", peer.id, reason, bands[peer.task].begin, bands[peer.task].end - 1);
+        pending.push_front(peer.task);
+        peer.task = -1;
+    } else if (peer.ready) {
+        fprintf(stderr, "Worker %u %s\n", peer.id, reason);
+    }
+
+    close(peer.fd);
+    peer.fd = -1;
+}
+
+bool Coordinate(const Options & options, int argc, char ** argv, Framebuffer & framebuffer, const uint64_t seed, const std::function<void(uint32_t)> & row_done) {
+    ScopedPhase phase(PHASE_RENDER);
+    const std::string address = options.coordinate.empty() ? "unix:/tmp/ray-" + std::to_string(getpid()) + ".sock" : options.coordinate;
+    const uint32_t width = framebuffer.width;
+
+    std::string error;
+    const int listener = OpenSocket(address, true, error);
+    if (listener < 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", address.c_str(), error.c_str());
+        return false;
+    }
+
+    // Bands are handed out top first, so rows reach the output roughly in order
+    std::vector<Band> bands;
+    std::deque<uint32_t> pending;
+    for (uint32_t y = 0; y < framebuffer.height; y += options.task_rows) {
+        Band band = { y, std::min(y + options.task_rows, framebuffer.height) };
+        pending.push_back(uint32_t(bands.size()));
+        bands.push_back(band);
+    }
+    size_t remaining = bands.size();
+
+    // Workers build everything from the coordinator's own command line
+    std::vector<uint8_t> job;
+    Append(job, seed);
+    Append(job, uint32_t(argc - 1));
+    for (int i = 1; i < argc; ++i) {
+        const uint32_t length = uint32_t(strlen(argv[i]));
+        Append(job, length);
+        Append(job, argv[i], length);
+    }
+
+    std::vector<pid_t> children = SpawnWorkers(options, address, argv[0]);
+    if (options.workers == 0) {
+        fprintf(stderr, "Waiting for workers on %s\n", address.c_str());
+    }
+
+    std::vector<Peer> peers;
+    uint32_t connections = 0;
+    bool ok = true;
+
+    while (remaining > 0) {
+        peers.erase(std::remove_if(peers.begin(), peers.end(), [](const Peer & p) { return p.fd < 0; }), peers.end());
+
+        for (size_t i = 0; i < peers.size(); ++i) {
+            Peer & peer = peers[i];
+            if (peer.ready && (peer.task < 0) && !pending.empty()) {
+                peer.task = int32_t(pending.front());
+                pending.pop_front();
+
+                std::vector<uint8_t> task;
+                Append(task, uint32_t(peer.task));
+                Append(task, bands[peer.task].begin);
+                Append(task, bands[peer.task].end);
+                if (!SendMessage(peer.fd, MESSAGE_TASK, task)) {
+                    DropPeer(peer, pending, bands, "disconnected");
+                }
+            }
+        }
+
+        std::vector<struct pollfd> fds(peers.size() + 1);
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < peers.size(); ++i) {
+            fds[i + 1].fd = peers[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        if ((poll(fds.data(), fds.size(), COORDINATOR_POLL_MS) < 0) && (errno != EINTR)) {
+            fprintf(stderr, "poll: %s\n", strerror(errno));
+            ok = false;
+            break;
+        }
+
+        for (size_t i = 0; i < peers.size(); ++i) {
+            Peer & peer = peers[i];
+            if ((peer.fd < 0) || (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                continue;
+            }
+
+            uint8_t buffer[65536];
+            const ssize_t n = recv(peer.fd, buffer, sizeof(buffer), 0);
+            if ((n < 0) && (errno == EINTR)) {
+                continue;
+            }
+            if (n <= 0) {
+                DropPeer(peer, pending, bands, "disconnected");
+                continue;
+            }
+            peer.input.insert(peer.input.end(), buffer, buffer + n);
+
+            // Handle every complete message received so far
+            MessageHeader header;
+            while ((peer.fd >= 0) && (peer.input.size() >= sizeof(header))) {
+                memcpy(&header, peer.input.data(), sizeof(header));
+                if (header.length > MAX_MESSAGE_BYTES) {
+                    DropPeer(peer, pending, bands, "sent a corrupt message");
+                    break;
+                }
+                if (peer.input.size() < sizeof(header) + header.length) {
+                    break;
+                }
+
+                std::vector<uint8_t> payload(peer.input.begin() + sizeof(header), peer.input.begin() + sizeof(header) + header.length);
+                peer.input.erase(peer.input.begin(), peer.input.begin() + sizeof(header) + header.length);
+                PayloadReader reader(payload);
+
+                if ((header.type == MESSAGE_HELLO) && !peer.ready) {
+                    uint32_t magic = 0;
+                    uint32_t version = 0;
+                    if (!reader.read(magic) || !reader.read(version) || (magic != PROTOCOL_MAGIC) || (version != PROTOCOL_VERSION)) {
+                        fprintf(stderr, "Worker %u speaks a different protocol\n", peer.id);
+                        DropPeer(peer, pending, bands, "rejected");
+                    } else if (!SendMessage(peer.fd, MESSAGE_JOB, job)) {
+                        DropPeer(peer, pending, bands, "disconnected");
+                    } else {
+                        peer.ready = true;
+                    }
+                } else if ((header.type == MESSAGE_RESULT) && (peer.task >= 0)) {
+                    const Band & band = bands[peer.task];
+                    uint32_t task = 0;
+                    Band result = { 0, 0 };
+                    const size_t offset = size_t(band.begin) * width;
+                    const size_t n = size_t(band.end - band.begin) * width;
+
+                    if (!reader.read(task) || !reader.read(result.begin) || !reader.read(result.end) ||
+                        (task != uint32_t(peer.task)) || (result.begin != band.begin) || (result.end != band.end) ||
+                        (reader.left() != n * (sizeof(vec3) + sizeof(float) + sizeof(uint32_t)))) {
+                        DropPeer(peer, pending, bands, "sent a bad result");
+                        break;
+                    }
+
+                    reader.read(&framebuffer.sums[offset], n * sizeof(vec3));
+                    reader.read(&framebuffer.squares[offset], n * sizeof(float));
+                    reader.read(&framebuffer.samples[offset], n * sizeof(uint32_t));
+                    for (uint32_t y = band.begin; y < band.end; ++y) {
+                        row_done(y);
+                    }
+
+                    peer.task = -1;
+                    --remaining;
+                } else {
+                    DropPeer(peer, pending, bands, "sent an unexpected message");
+                }
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                Peer peer;
+                peer.fd = fd;
+                peer.id = ++connections;
+                peer.ready = false;
+                peer.task = -1;
+                peers.push_back(peer);
+            }
+        }
+
+        // Local workers that have exited will never connect
+        size_t running = 0;
+        for (size_t i = 0; i < children.size(); ++i) {
+            if ((children[i] > 0) && (waitpid(children[i], NULL, WNOHANG) == children[i])) {
+                children[i] = -1;
+            }
+            running += (children[i] > 0) ? 1 : 0;
+        }
+
+        const bool connected = std::any_of(peers.begin(), peers.end(), [](const Peer & p) { return p.fd >= 0; });
+        if ((options.workers > 0) && (running == 0) && !connected && (remaining > 0)) {
+            fprintf(stderr, "Every worker has exited with %zu of %zu bands left\n", remaining, bands.size());
+            ok = false;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < peers.size(); ++i) {
+        if (peers[i].fd >= 0) {
+            if (ok) {
+                SendMessage(peers[i].fd, MESSAGE_DONE, std::vector<uint8_t>());
+            }
+            close(peers[i].fd);
+        }
+    }
+
+    close(listener);
+    if (address.compare(0, 5, "unix:") == 0) {
+        unlink(address.c_str() + 5);
+    }
+
+    // Workers exit on DONE, or on losing the connection
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (children[i] > 0) {
+            waitpid(children[i], NULL, 0);
+        }
+    }
+    return ok;
+}
+
+bool Work(const Options & options, const RendererFactory & factory) {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point give_up = Clock::now() + std::chrono::milliseconds(CONNECT_TIMEOUT_MS);
+
+    // The coordinator may not be listening yet
+    std::string error;
+    int fd;
+    while ((fd = OpenSocket(options.work, false, error)) < 0) {
+        if (Clock::now() >= give_up) {
+            fprintf(stderr, "Cannot connect to %s: %s\n", options.work.c_str(), error.c_str());
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MS));
+    }
+
+    std::vector<uint8_t> hello;
+    Append(hello, PROTOCOL_MAGIC);
+    Append(hello, PROTOCOL_VERSION);
+
+    Renderer * renderer = NULL;
+    Framebuffer * framebuffer = NULL;
+    uint32_t num_samples = 0;
+    std::vector<uint8_t> message;
+    uint32_t type = 0;
+    const char * failure = "Lost the coordinator";
+    bool ok = false;
+
+    const bool introduced = SendMessage(fd, MESSAGE_HELLO, hello);
+    while (introduced && ReceiveMessage(fd, type, message)) {
+        PayloadReader reader(message);
+
+        if ((type == MESSAGE_JOB) && (renderer == NULL)) {
+            uint64_t seed = 0;
+            uint32_t count = 0;
+            bool valid = reader.read(seed) && reader.read(count);
+
+            std::vector<std::string> args(1, "ray");
+            for (uint32_t i = 0; valid && (i < count); ++i) {
+                uint32_t length = 0;
+                valid = reader.read(length) && (length <= reader.left());
+                if (valid) {
+                    args.push_back(std::string(length, '\0'));
+                    reader.read(&args.back()[0], length);
+                }
+            }
+
+            std::vector<char *> job_argv;
+            for (size_t i = 0; i < args.size(); ++i) {
+                job_argv.push_back(&args[i][0]);
+            }
+            job_argv.push_back(NULL);
+
+            Options job;
+            if (!valid || !ParseOptions(int(args.size()), job_argv.data(), job)) {
+                failure = "Cannot use the coordinator's job";
+                break;
+            }
+
+            renderer = factory(job);
+            if (renderer == NULL) {
+                failure = "Cannot build the coordinator's scene";
+                break;
+            }
+            renderer->seed = seed;
+            framebuffer = new Framebuffer(job.crop_width, job.crop_height, job.crop_left, job.crop_top, job.width, job.height);
+            num_samples = job.num_samples;
+        } else if ((type == MESSAGE_TASK) && (renderer != NULL)) {
+            uint32_t task = 0;
+            Band band = { 0, 0 };
+            if (!reader.read(task) || !reader.read(band.begin) || !reader.read(band.end) ||
+                (band.begin >= band.end) || (band.end > framebuffer->height)) {
+                failure = "Bad task from the coordinator";
+                break;
+            }
+
+            renderer->render(*framebuffer, band.begin, band.end, num_samples, [](const uint32_t) {});
+
+            const size_t offset = size_t(band.begin) * framebuffer->width;
+            const size_t n = size_t(band.end - band.begin) * framebuffer->width;
+            std::vector<uint8_t> result;
+            result.reserve((3 * sizeof(uint32_t)) + (n * (sizeof(vec3) + sizeof(float) + sizeof(uint32_t))));
+            Append(result, task);
+            Append(result, band.begin);
+            Append(result, band.end);
+            Append(result, &framebuffer->sums[offset], n * sizeof(vec3));
+            Append(result, &framebuffer->squares[offset], n * sizeof(float));
+            Append(result, &framebuffer->samples[offset], n * sizeof(uint32_t));
+            if (!SendMessage(fd, MESSAGE_RESULT, result)) {
+                break;
+            }
+        } else if (type == MESSAGE_DONE) {
+            ok = true;
+            break;
+        } else {
+            failure = "Unexpected message from the coordinator";
+            break;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s\n", failure);
+    }
+
+    close(fd);
+    delete framebuffer;
+    delete renderer;
+    return ok;
+}
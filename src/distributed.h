@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: distributed.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Rendering across processes
+///
+/// @detail A coordinator listens on a Unix socket ("unix:/path") or TCP
+///         ("host:port") and splits the frame into bands of rows. Workers
+///         connect, are sent the coordinator's command line, build the same
+///         scene and render one band at a time into their own framebuffer,
+///         sending back the band's sums, squared sums and counts.
+///
+///         Samples are seeded by pixel and index (see Renderer), so a band
+///         comes out the same bits whichever worker renders it, and the
+///         merged frame matches a local render. A worker that disconnects
+///         mid-band has the band put back at the front of the queue for the
+///         next idle worker.
+///
+///         Messages are a type and a length followed by the payload, in the
+///         machine's byte order; the handshake rejects a peer of a different
+///         byte order or protocol version.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <functional>
+#include <stdint.h>
+
+#include "framebuffer.h"
+#include "options.h"
+#include "renderer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Builds the renderer for a job's options, or returns NULL after printing why not
+typedef std::function<Renderer *(const Options &)> RendererFactory;
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Render a frame on worker processes, in place of Renderer::render()
+///
+/// @detail Starts options.workers local workers, then serves any that
+///         connect until every band is done.
+///
+/// @param  options - Options; coordinate and workers say where to listen
+/// @param  argc - Argument count, passed on to the workers
+/// @param  argv - Argument vector, passed on to the workers
+/// @param  framebuffer - Framebuffer the bands are copied into
+/// @param  seed - Seed for the per-pixel random sequences
+/// @param  row_done - Called with each row once it is complete
+///
+/// @return False if the frame could not be finished
+///////////////////////////////////////////////////////////////////////////////
+bool Coordinate(const Options & options, int argc, char ** argv, Framebuffer & framebuffer, const uint64_t seed, const std::function<void(uint32_t)> & row_done);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Connect to the coordinator at options.work and render bands for
+///         it until it says the frame is done
+///
+/// @param  options - The worker's own options; only the threads are used
+/// @param  factory - Builds the renderer for the job
+///
+/// @return False if the job could not be set up or the coordinator was lost
+///////////////////////////////////////////////////////////////////////////////
+bool Work(const Options & options, const RendererFactory & factory);
+
+#endif//DISTRIBUTED_H
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: framebuffer.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Linear floating point framebuffer
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+
+#include "framebuffer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+Framebuffer::Framebuffer(const uint32_t w, const uint32_t h) : width(w), height(h), left(0), top(0), frame_width(w), frame_height(h) {
+    clear();
+}
+
+Framebuffer::Framebuffer(const uint32_t w, const uint32_t h, const uint32_t l, const uint32_t t, const uint32_t fw, const uint32_t fh) :
+    width(w), height(h), left(l), top(t), frame_width(fw), frame_height(fh) {
+    clear();
+}
+
+void Framebuffer::clear() {
+    sums.assign(size_t(width) * height, vec3(0, 0, 0));
+    squares.assign(size_t(width) * height, 0.0);
+    samples.assign(size_t(width) * height, 0);
+}
+
+void Framebuffer::resolve(const uint32_t begin, const uint32_t end, float * rgb) const {
+    for (uint32_t y = begin; y < end; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            vec3 c = pixel(x, y);
+            float * out = &rgb[3 * ((size_t(y - begin) * width) + x)];
+            out[0] = c.r();
+            out[1] = c.g();
+            out[2] = c.b();
+        }
+    }
+}
+
+float Framebuffer::noise() const {
+    double total = 0.0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const uint32_t n = samples[i];
+        if (n < 2) {
+            continue;
+        }
+
+        double mean = Luminance(sums[i]) / n;
+        double variance = std::max(((squares[i] / n) - (mean * mean)) * n / (n - 1), 0.0);
+        total += sqrt(variance / n) / std::max(mean, 0.01);
+        ++count;
+    }
+
+    return (count > 0) ? (total / count) : INFINITY;
+}
+
+uint32_t Framebuffer::min_samples() const {
+    return samples.empty() ? 0 : *std::min_element(samples.begin(), samples.end());
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: framebuffer.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Linear floating point framebuffer
+///
+/// @detail Pixels hold the running sum of their samples in linear radiance,
+///         plus the number of samples taken, so nothing is clipped or
+///         quantized until an image is written. The sum of squared sample
+///         luminances is kept as well, to estimate the remaining noise.
+///         Rows are stored top to bottom.
+///
+///         A framebuffer may hold just a window of the frame (a crop): its
+///         pixel (0, 0) is then pixel (left, top) of a frame_width x
+///         frame_height image, and is rendered exactly as that pixel of the
+///         whole frame would be.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "vec3.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Rec. 709 luminance
+inline float Luminance(const vec3 & c) {
+    return (0.2126F * c.r()) + (0.7152F * c.g()) + (0.0722F * c.b());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class Framebuffer {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Framebuffer constructor; all pixels start with no samples
+    ///
+    /// @param  w - Width in pixels
+    /// @param  h - Height in pixels
+    ///////////////////////////////////////////////////////////////////////////
+    Framebuffer(const uint32_t w, const uint32_t h);
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Framebuffer constructor for a window of a larger frame
+    ///
+    /// @param  w - Window width in pixels
+    /// @param  h - Window height in pixels
+    /// @param  l - Frame column of the window's left edge
+    /// @param  t - Frame row of the window's top edge
+    /// @param  fw - Frame width in pixels
+    /// @param  fh - Frame height in pixels
+    ///////////////////////////////////////////////////////////////////////////
+    Framebuffer(const uint32_t w, const uint32_t h, const uint32_t l, const uint32_t t, const uint32_t fw, const uint32_t fh);
+
+    // Both framebuffers cover the same window of frames of the same size
+    inline bool same_window(const Framebuffer & other) const {
+        return (width == other.width) && (height == other.height) && (left == other.left) && (top == other.top) &&
+            (frame_width == other.frame_width) && (frame_height == other.frame_height);
+    }
+
+    // Replace a pixel's accumulation (x from the left, y from the top): the
+    // sum of n samples' radiance and the sum of their squared luminance
+    inline void set(const uint32_t x, const uint32_t y, const vec3 & sum, const float sum_squares, const uint32_t n) {
+        const size_t index = (y * width) + x;
+        sums[index] = sum;
+        squares[index] = sum_squares;
+        samples[index] = n;
+    }
+
+    // Mean radiance of a pixel, black if it has no samples
+    inline vec3 pixel(const uint32_t x, const uint32_t y) const {
+        const size_t index = (y * width) + x;
+        if (samples[index] == 0) {
+            return vec3(0, 0, 0);
+        }
+        return sums[index] / float(samples[index]);
+    }
+
+    // Mean radiance of rows [begin, end) as interleaved RGB floats
+    void resolve(const uint32_t begin, const uint32_t end, float * rgb) const;
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Estimate how noisy the image still is
+    ///
+    /// @return The standard error of each pixel's mean luminance relative to
+    ///         that luminance (floored at 0.01, so near-black pixels don't
+    ///         dominate), averaged over the pixels with two or more samples
+    ///////////////////////////////////////////////////////////////////////////
+    float noise() const;
+
+    // Smallest number of samples of any pixel
+    uint32_t min_samples() const;
+
+    void clear();
+
+    uint32_t width;                 ///< Width in pixels
+    uint32_t height;                ///< Height in pixels
+    uint32_t left;                  ///< Frame column of the first column
+    uint32_t top;                   ///< Frame row of the first row
+    uint32_t frame_width;           ///< Width of the whole frame
+    uint32_t frame_height;          ///< Height of the whole frame
+    std::vector<vec3> sums;         ///< Sum of the samples of each pixel
+    std::vector<float> squares;     ///< Sum of the squared luminance of the samples of each pixel
+    std::vector<uint32_t> samples;  ///< Number of samples of each pixel
+};
+
+#endif//FRAMEBUFFER_H
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: heatmap.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Per-pixel render cost maps
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+
+#include "heatmap.h"
+#include "framebuffer.h"
+#include "image_io.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define HEATMAP_PERCENTILE 0.99     ///< Fraction of pixels below full scale
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+static const char * const cost_names[NUM_PIXEL_COSTS] = { "nodes", "tests", "segments", "time" };
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+CostMap::CostMap(const uint32_t w, const uint32_t h) : width(w), height(h), samples(size_t(w) * h, 0) {
+    for (int32_t i = 0; i < NUM_PIXEL_COSTS; ++i) {
+        costs[i].assign(size_t(w) * h, 0.0);
+    }
+}
+
+// Black, blue, red, yellow, white for x in [0, 1]
+static vec3 Ramp(float x) {
+    static const vec3 stops[5] = { vec3(0, 0, 0), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 1, 0), vec3(1, 1, 1) };
+
+    x = std::min(std::max(x, 0.0F), 1.0F) * 4.0F;
+    const int32_t i = std::min(int32_t(x), 3);
+    const float f = x - i;
+    return ((1.0F - f) * stops[i]) + (f * stops[i + 1]);
+}
+
+bool WriteHeatmaps(const std::string & prefix, const CostMap & map) {
+    const size_t n = size_t(map.width) * map.height;
+    bool ok = true;
+
+    // Written through the image writers as one-sample framebuffers
+    Framebuffer values(map.width, map.height);
+    Framebuffer colours(map.width, map.height);
+    std::fill(values.samples.begin(), values.samples.end(), 1);
+    std::fill(colours.samples.begin(), colours.samples.end(), 1);
+
+    TonemapOptions linear;
+    linear.gamma = 1.0;
+
+    for (int32_t c = 0; c < NUM_PIXEL_COSTS; ++c) {
+        std::vector<float> sorted(n);
+        for (size_t i = 0; i < n; ++i) {
+            const float value = (map.samples[i] > 0) ? float(map.costs[c][i] / map.samples[i]) : 0.0F;
+            values.sums[i] = vec3(value, value, value);
+            sorted[i] = value;
+        }
+
+        const size_t at = std::min(size_t(HEATMAP_PERCENTILE * n), n - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + at, sorted.end());
+        const float scale = (sorted[at] > 0.0F) ? 1.0F / sorted[at] : 0.0F;
+
+        for (size_t i = 0; i < n; ++i) {
+            colours.sums[i] = Ramp(values.sums[i].r() * scale);
+        }
+
+        const std::string path = prefix + "-" + cost_names[c];
+        ok = WriteImage((path + ".png").c_str(), colours, linear) && ok;
+        ok = WriteImage((path + ".pfm").c_str(), values, linear) && ok;
+    }
+    return ok;
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: heatmap.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Per-pixel render cost maps
+///
+/// @detail The renderer can record what each pixel cost: BVH node visits,
+///         primitive tests, path segments and wall-clock time, read from the
+///         rendering thread's own statistics counters around the pixel.
+///         WriteHeatmaps() turns them into per-sample averages, as false
+///         colour PNGs for a quick look and as PFMs of the raw values.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum PixelCost {
+    COST_NODE_VISITS,           ///< BVH nodes visited
+    COST_PRIMITIVE_TESTS,       ///< Intersection tests
+    COST_PATH_SEGMENTS,         ///< Camera ray plus bounces
+    COST_NANOSECONDS,           ///< Wall-clock time
+    NUM_PIXEL_COSTS
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class CostMap {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  CostMap constructor; every pixel starts at zero
+    ///
+    /// @param  w - Width in pixels
+    /// @param  h - Height in pixels
+    ///////////////////////////////////////////////////////////////////////////
+    CostMap(const uint32_t w, const uint32_t h);
+
+    // Add the costs of n samples of pixel index (y * width + x)
+    inline void add(const size_t index, const double c[NUM_PIXEL_COSTS], const uint32_t n) {
+        for (int32_t i = 0; i < NUM_PIXEL_COSTS; ++i) {
+            costs[i][index] += c[i];
+        }
+        samples[index] += n;
+    }
+
+    uint32_t width;                                 ///< Width in pixels
+    uint32_t height;                                ///< Height in pixels
+    std::vector<double> costs[NUM_PIXEL_COSTS];     ///< Summed costs of each pixel
+    std::vector<uint32_t> samples;                  ///< Samples the costs cover
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Write the per-sample cost of every pixel
+///
+/// @detail Writes <prefix>-nodes, -tests, -segments and -time, each as a PNG
+///         coloured from black through blue, red and yellow to white, scaled
+///         so the 99th percentile pixel is white, and as a PFM of the values
+///         (time in nanoseconds).
+///
+/// @param  prefix - Path prefix
+/// @param  map - Costs
+///
+/// @return False if any image could not be written
+///////////////////////////////////////////////////////////////////////////////
+bool WriteHeatmaps(const std::string & prefix, const CostMap & map);
+
+#endif//HEATMAP_H
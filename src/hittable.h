@@ -19,6 +19,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "vec3.h"
 #include "ray.h"
+#include "aabb.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // CLASSES
@@ -34,7 +35,18 @@ struct HitRecord {
 
 class Hittable {
 public:
+    virtual ~Hittable() {}
+
     virtual bool hit(const Ray & r, const float t_min, const float t_max, HitRecord & record) const = 0;
+
+    // Returns false if the object has no finite bounds. An object that moves
+    // is bounded over the whole frame
+    virtual bool bounding_box(AABB & box) const = 0;
+
+    // Bounds at times 0 and 1 of an object that moves linearly over the frame,
+    // so that boxes interpolated between the two bound it at any time in
+    // between. Returns false if the object doesn't move
+    virtual bool motion_bounds(AABB &, AABB &) const { return false; }
 };
 
 #endif//HITTABLE_H
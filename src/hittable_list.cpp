@@ -35,3 +35,17 @@ bool HittableList::hit(const Ray & r, const float t_min, const float t_max, HitR
 
     return hit_anything;
 }
+
+bool HittableList::bounding_box(AABB & box) const {
+    AABB temp_box;
+    box = AABB();
+
+    for (size_t i = 0; i < size; ++i) {
+        if (!list[i]->bounding_box(temp_box)) {
+            return false;
+        }
+        box.expand(temp_box);
+    }
+
+    return (size > 0);
+}
@@ -28,6 +28,7 @@ public:
     HittableList() {}
     HittableList(Hittable ** l, const size_t n) { list = l; size = n; }
     virtual bool hit(const Ray & r, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
 
     Hittable ** list;   ///< List of hittable objects (@TODO use vector)
     size_t size;        ///< Size of list
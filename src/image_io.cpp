@@ -0,0 +1,639 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: image_io.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Image writers
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <string>
+#include <zlib.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include "image_io.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define EXR_TILE_SIZE 64            ///< EXR tile width and height
+#define PNG_CHUNK_SIZE (1 << 16)    ///< Deflated bytes per PNG IDAT chunk
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Little-endian serialization, independent of the host byte order
+static void PutU8(std::vector<uint8_t> & out, const uint8_t v) {
+    out.push_back(v);
+}
+
+static void PutU32(std::vector<uint8_t> & out, const uint32_t v) {
+    for (int32_t i = 0; i < 4; ++i) {
+        out.push_back((v >> (8 * i)) & 0xFF);
+    }
+}
+
+static void PutU64(std::vector<uint8_t> & out, const uint64_t v) {
+    for (int32_t i = 0; i < 8; ++i) {
+        out.push_back((v >> (8 * i)) & 0xFF);
+    }
+}
+
+static void PutF32(std::vector<uint8_t> & out, const float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    PutU32(out, bits);
+}
+
+static void PutString(std::vector<uint8_t> & out, const char * s) {
+    out.insert(out.end(), s, s + strlen(s) + 1);
+}
+
+// Images are written under a temporary name and renamed into place when
+// complete, so readers never see a half-written file
+static std::string TemporaryPath(const char * path) {
+    return std::string(path) + ".tmp";
+}
+
+static FILE * OpenFile(const char * path) {
+    FILE * file = fopen(TemporaryPath(path).c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    }
+    return file;
+}
+
+static bool Write(FILE * file, const char * path, const void * data, const size_t size) {
+    if (fwrite(data, 1, size, file) != size) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Publish a temporary file under its real name
+static bool Publish(const char * path) {
+    if (rename(TemporaryPath(path).c_str(), path) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        unlink(TemporaryPath(path).c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool Close(FILE * file, const char * path) {
+    if (fclose(file) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        unlink(TemporaryPath(path).c_str());
+        return false;
+    }
+    return Publish(path);
+}
+
+// Give up on a file, e.g. because a write failed
+static void Abandon(FILE * file, const char * path) {
+    fclose(file);
+    unlink(TemporaryPath(path).c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PNG
+///////////////////////////////////////////////////////////////////////////////
+class PNGStream : public ImageStream {
+public:
+    PNGStream(const char * p, const TonemapOptions & t) : path(p), tonemap(t), file(NULL), open(false) {}
+
+    ~PNGStream() {
+        if (open) {
+            deflateEnd(&zlib);
+        }
+        if (file != NULL) {
+            Abandon(file, path.c_str());
+        }
+    }
+
+    bool begin(const uint32_t width, const uint32_t height) {
+        file = OpenFile(path.c_str());
+        if (file == NULL) {
+            return false;
+        }
+
+        memset(&zlib, 0, sizeof(zlib));
+        if (deflateInit(&zlib, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            fprintf(stderr, "%s: deflateInit failed\n", path.c_str());
+            return false;
+        }
+        open = true;
+
+        const size_t stride = size_t(width) * 3;
+        row.assign(stride, 0);
+        previous.assign(stride, 0);
+        for (int32_t f = 0; f < 5; ++f) {
+            filtered[f].assign(stride + 1, f);
+        }
+        deflated.resize(PNG_CHUNK_SIZE);
+        zlib.next_out = deflated.data();
+        zlib.avail_out = deflated.size();
+
+        static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        uint8_t header[13];
+        PutBigEndian(header + 0, width);
+        PutBigEndian(header + 4, height);
+        header[8] = 8;      // Bit depth
+        header[9] = 2;      // Colour type: RGB
+        header[10] = 0;     // Deflate
+        header[11] = 0;     // Adaptive filtering
+        header[12] = 0;     // No interlacing
+
+        return Write(file, path.c_str(), SIGNATURE, sizeof(SIGNATURE)) && chunk("IHDR", header, sizeof(header));
+    }
+
+    virtual bool write_rows(const Framebuffer & framebuffer, const uint32_t begin, const uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y) {
+            Tonemap(framebuffer, tonemap, y, y + 1, row.data());
+
+            const std::vector<uint8_t> & best = filter();
+            zlib.next_in = (Bytef *) best.data();
+            zlib.avail_in = best.size();
+            if (!pump(Z_NO_FLUSH)) {
+                return false;
+            }
+
+            row.swap(previous);
+        }
+        return true;
+    }
+
+    virtual bool finish() {
+        bool ok = pump(Z_FINISH) && chunk("IEND", NULL, 0);
+        deflateEnd(&zlib);
+        open = false;
+
+        if (ok) {
+            ok = Close(file, path.c_str());
+        } else {
+            Abandon(file, path.c_str());
+        }
+        file = NULL;
+        return ok;
+    }
+
+private:
+    static void PutBigEndian(uint8_t * out, const uint32_t v) {
+        out[0] = v >> 24;
+        out[1] = v >> 16;
+        out[2] = v >> 8;
+        out[3] = v;
+    }
+
+    bool chunk(const char * type, const uint8_t * data, const uint32_t size) {
+        uint8_t length[4];
+        uint8_t crc[4];
+        uint32_t c = crc32(0, (const Bytef *) type, 4);
+        if (size > 0) {
+            c = crc32(c, data, size);
+        }
+        PutBigEndian(length, size);
+        PutBigEndian(crc, c);
+
+        return Write(file, path.c_str(), length, 4) && Write(file, path.c_str(), type, 4) &&
+            ((size == 0) || Write(file, path.c_str(), data, size)) && Write(file, path.c_str(), crc, 4);
+    }
+
+    // Deflate pending input, emitting an IDAT chunk whenever the buffer fills
+    bool pump(const int flush) {
+        while (true) {
+            int status = deflate(&zlib, flush);
+            if ((status != Z_OK) && (status != Z_STREAM_END) && (status != Z_BUF_ERROR)) {
+                fprintf(stderr, "%s: deflate failed\n", path.c_str());
+                return false;
+            }
+
+            bool full = (zlib.avail_out == 0);
+            if (full || ((status == Z_STREAM_END) && (zlib.avail_out < deflated.size()))) {
+                if (!chunk("IDAT", deflated.data(), deflated.size() - zlib.avail_out)) {
+                    return false;
+                }
+                zlib.next_out = deflated.data();
+                zlib.avail_out = deflated.size();
+            }
+
+            if (flush == Z_FINISH) {
+                if (status == Z_STREAM_END) {
+                    return true;
+                }
+            } else if (!full && (zlib.avail_in == 0)) {
+                return true;
+            }
+        }
+    }
+
+    // Try every PNG filter on the row and keep the one with the smallest sum
+    // of absolute (signed) residuals, the usual heuristic from libpng
+    const std::vector<uint8_t> & filter() {
+        const size_t n = row.size();
+        uint32_t best = 0;
+        uint64_t best_sum = UINT64_MAX;
+
+        for (int32_t f = 0; f < 5; ++f) {
+            uint8_t * out = &filtered[f][1];
+            uint64_t sum = 0;
+
+            for (size_t i = 0; i < n; ++i) {
+                int32_t a = (i >= 3) ? row[i - 3] : 0;
+                int32_t b = previous[i];
+                int32_t c = (i >= 3) ? previous[i - 3] : 0;
+                int32_t predictor = 0;
+
+                switch (f) {
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (a + b) / 2; break;
+                case 4: {
+                    int32_t p = a + b - c;
+                    int32_t pa = abs(p - a);
+                    int32_t pb = abs(p - b);
+                    int32_t pc = abs(p - c);
+                    predictor = ((pa <= pb) && (pa <= pc)) ? a : ((pb <= pc) ? b : c);
+                    break;
+                }
+                default: break;
+                }
+
+                out[i] = uint8_t(row[i] - predictor);
+                sum += abs(int8_t(out[i]));
+            }
+
+            if (sum < best_sum) {
+                best = f;
+                best_sum = sum;
+            }
+        }
+
+        return filtered[best];
+    }
+
+    std::string path;                   ///< Output path
+    TonemapOptions tonemap;             ///< Tone mapping
+    FILE * file;                        ///< Output file
+    z_stream zlib;                      ///< Deflate state
+    bool open;                          ///< Deflate state needs releasing
+    std::vector<uint8_t> row;           ///< Current tone-mapped row
+    std::vector<uint8_t> previous;      ///< Previous tone-mapped row (zero above the first)
+    std::vector<uint8_t> filtered[5];   ///< Row under each filter, filter type byte first
+    std::vector<uint8_t> deflated;      ///< Deflate output waiting for its IDAT chunk
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// EXR
+///////////////////////////////////////////////////////////////////////////////
+
+// EXR header attribute: name, type name, byte size, then the value
+static void PutAttribute(std::vector<uint8_t> & out, const char * name, const char * type, const uint32_t size) {
+    PutString(out, name);
+    PutString(out, type);
+    PutU32(out, size);
+}
+
+static void PutBox2i(std::vector<uint8_t> & out, const char * name, const uint32_t width, const uint32_t height) {
+    PutAttribute(out, name, "box2i", 16);
+    PutU32(out, 0);
+    PutU32(out, 0);
+    PutU32(out, width - 1);
+    PutU32(out, height - 1);
+}
+
+class EXRStream : public ImageStream {
+public:
+    EXRStream(const char * p) : path(p), file(NULL) {}
+
+    ~EXRStream() {
+        if (file != NULL) {
+            Abandon(file, path.c_str());
+        }
+    }
+
+    bool begin(const uint32_t w, const uint32_t h) {
+        static const char * CHANNELS[3] = { "B", "G", "R" };    // EXR wants channels sorted by name
+        static const uint32_t PIXEL_TYPE_FLOAT = 2;
+
+        width = w;
+        height = h;
+        tiles_x = (width + EXR_TILE_SIZE - 1) / EXR_TILE_SIZE;
+        tiles_y = (height + EXR_TILE_SIZE - 1) / EXR_TILE_SIZE;
+        rows_done = 0;
+        next_tile_row = 0;
+        offsets.clear();
+
+        file = OpenFile(path.c_str());
+        if (file == NULL) {
+            return false;
+        }
+
+        std::vector<uint8_t> out;
+
+        // Magic number, then version 2 with the single-part tiled flag
+        PutU32(out, 20000630);
+        PutU32(out, 2 | 0x200);
+
+        PutAttribute(out, "channels", "chlist", (3 * (2 + 16)) + 1);
+        for (int32_t c = 0; c < 3; ++c) {
+            PutString(out, CHANNELS[c]);
+            PutU32(out, PIXEL_TYPE_FLOAT);
+            PutU32(out, 0);     // pLinear and reserved bytes
+            PutU32(out, 1);     // x sampling
+            PutU32(out, 1);     // y sampling
+        }
+        PutU8(out, 0);
+
+        PutAttribute(out, "compression", "compression", 1);
+        PutU8(out, 0);          // NO_COMPRESSION
+
+        PutBox2i(out, "dataWindow", width, height);
+        PutBox2i(out, "displayWindow", width, height);
+
+        PutAttribute(out, "lineOrder", "lineOrder", 1);
+        PutU8(out, 0);          // INCREASING_Y
+
+        PutAttribute(out, "pixelAspectRatio", "float", 4);
+        PutF32(out, 1.0);
+
+        PutAttribute(out, "screenWindowCenter", "v2f", 8);
+        PutF32(out, 0.0);
+        PutF32(out, 0.0);
+
+        PutAttribute(out, "screenWindowWidth", "float", 4);
+        PutF32(out, 1.0);
+
+        PutAttribute(out, "tiles", "tiledesc", 9);
+        PutU32(out, EXR_TILE_SIZE);
+        PutU32(out, EXR_TILE_SIZE);
+        PutU8(out, 0);          // ONE_LEVEL, ROUND_DOWN
+
+        PutU8(out, 0);          // End of header
+
+        // Offset table, filled in by finish()
+        table = out.size();
+        out.resize(table + (size_t(tiles_x) * tiles_y * sizeof(uint64_t)));
+        position = out.size();
+
+        return Write(file, path.c_str(), out.data(), out.size());
+    }
+
+    // Tiles are written a row of tiles at a time, once all of its rows are in
+    virtual bool write_rows(const Framebuffer & framebuffer, const uint32_t begin, const uint32_t end) {
+        (void) begin;
+        rows_done = end;
+
+        while ((next_tile_row < tiles_y) && (rows_done >= std::min(height, (next_tile_row + 1) * EXR_TILE_SIZE))) {
+            if (!write_tile_row(framebuffer, next_tile_row)) {
+                return false;
+            }
+            ++next_tile_row;
+        }
+        return true;
+    }
+
+    virtual bool finish() {
+        std::vector<uint8_t> out;
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            PutU64(out, offsets[i]);
+        }
+
+        bool ok = (fseek(file, table, SEEK_SET) == 0) && Write(file, path.c_str(), out.data(), out.size());
+        if (ok) {
+            ok = Close(file, path.c_str());
+        } else {
+            Abandon(file, path.c_str());
+        }
+        file = NULL;
+        return ok;
+    }
+
+private:
+    bool write_tile_row(const Framebuffer & framebuffer, const uint32_t ty) {
+        static const int32_t CHANNEL_OFFSET[3] = { 2, 1, 0 };   // B, G, R within an RGB pixel
+
+        const uint32_t y0 = ty * EXR_TILE_SIZE;
+        const uint32_t h = std::min<uint32_t>(EXR_TILE_SIZE, height - y0);
+
+        rgb.resize(size_t(width) * h * 3);
+        framebuffer.resolve(y0, y0 + h, rgb.data());
+
+        std::vector<uint8_t> out;
+        for (uint32_t tx = 0; tx < tiles_x; ++tx) {
+            const uint32_t x0 = tx * EXR_TILE_SIZE;
+            const uint32_t w = std::min<uint32_t>(EXR_TILE_SIZE, width - x0);
+
+            offsets.push_back(position + out.size());
+
+            PutU32(out, tx);
+            PutU32(out, ty);
+            PutU32(out, 0);     // Level
+            PutU32(out, 0);
+            PutU32(out, w * h * 3 * sizeof(float));
+
+            // Each scanline of the tile holds every channel in turn
+            for (uint32_t y = 0; y < h; ++y) {
+                for (int32_t c = 0; c < 3; ++c) {
+                    for (uint32_t x = x0; x < x0 + w; ++x) {
+                        PutF32(out, rgb[(3 * ((size_t(y) * width) + x)) + CHANNEL_OFFSET[c]]);
+                    }
+                }
+            }
+        }
+
+        position += out.size();
+        return Write(file, path.c_str(), out.data(), out.size());
+    }
+
+    std::string path;               ///< Output path
+    FILE * file;                    ///< Output file
+    uint32_t width;                 ///< Image width
+    uint32_t height;                ///< Image height
+    uint32_t tiles_x;               ///< Tiles across
+    uint32_t tiles_y;               ///< Tiles down
+    uint32_t rows_done;             ///< Rows received so far
+    uint32_t next_tile_row;         ///< Next row of tiles to write
+    size_t table;                   ///< File position of the offset table
+    uint64_t position;              ///< File position of the next tile
+    std::vector<uint64_t> offsets;  ///< File position of each tile, in table order
+    std::vector<float> rgb;         ///< Resolved rows of the current row of tiles
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PFM
+///////////////////////////////////////////////////////////////////////////////
+class PFMStream : public ImageStream {
+public:
+    PFMStream(const char * p) : path(p), file(NULL) {}
+
+    ~PFMStream() {
+        if (file != NULL) {
+            Abandon(file, path.c_str());
+        }
+    }
+
+    bool begin(const uint32_t w, const uint32_t h) {
+        width = w;
+        height = h;
+
+        file = OpenFile(path.c_str());
+        if (file == NULL) {
+            return false;
+        }
+
+        // A negative scale marks the data as little-endian
+        char header[64];
+        int n = snprintf(header, sizeof(header), "PF\n%u %u\n-1.0\n", width, height);
+        data = n;
+        return Write(file, path.c_str(), header, n);
+    }
+
+    // PFM rows run bottom to top, so each row is written at its own offset
+    virtual bool write_rows(const Framebuffer & framebuffer, const uint32_t begin, const uint32_t end) {
+        const size_t row_size = size_t(width) * 3 * sizeof(float);
+
+        rgb.resize(size_t(width) * 3);
+        for (uint32_t y = begin; y < end; ++y) {
+            framebuffer.resolve(y, y + 1, rgb.data());
+
+            std::vector<uint8_t> out;
+            out.reserve(row_size);
+            for (size_t i = 0; i < rgb.size(); ++i) {
+                PutF32(out, rgb[i]);
+            }
+
+            if ((fseek(file, data + ((height - 1 - y) * row_size), SEEK_SET) != 0) || !Write(file, path.c_str(), out.data(), out.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    virtual bool finish() {
+        bool ok = Close(file, path.c_str());
+        file = NULL;
+        return ok;
+    }
+
+private:
+    std::string path;           ///< Output path
+    FILE * file;                ///< Output file
+    uint32_t width;             ///< Image width
+    uint32_t height;            ///< Image height
+    size_t data;                ///< File position of the pixel data
+    std::vector<float> rgb;     ///< Current row
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// HDR
+///////////////////////////////////////////////////////////////////////////////
+
+// Radiance files are run-length encoded by stb in one go, so rows are only
+// resolved as they arrive and the file is written at the end
+class HDRStream : public ImageStream {
+public:
+    HDRStream(const char * p) : path(p) {}
+
+    bool begin(const uint32_t w, const uint32_t h) {
+        width = w;
+        height = h;
+        rgb.resize(size_t(width) * height * 3);
+        return true;
+    }
+
+    virtual bool write_rows(const Framebuffer & framebuffer, const uint32_t begin, const uint32_t end) {
+        framebuffer.resolve(begin, end, &rgb[size_t(begin) * width * 3]);
+        return true;
+    }
+
+    virtual bool finish() {
+        if (!stbi_write_hdr(TemporaryPath(path.c_str()).c_str(), width, height, 3, rgb.data())) {
+            fprintf(stderr, "%s: write failed\n", path.c_str());
+            unlink(TemporaryPath(path.c_str()).c_str());
+            return false;
+        }
+        return Publish(path.c_str());
+    }
+
+private:
+    std::string path;           ///< Output path
+    uint32_t width;             ///< Image width
+    uint32_t height;            ///< Image height
+    std::vector<float> rgb;     ///< Resolved image
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DISPATCH
+///////////////////////////////////////////////////////////////////////////////
+static bool HasExtension(const char * path, const char * extension) {
+    size_t n = strlen(path);
+    size_t e = strlen(extension);
+    return (n > e) && (strcasecmp(path + n - e, extension) == 0);
+}
+
+bool IsImageFile(const char * path) {
+    return HasExtension(path, ".png") || HasExtension(path, ".hdr") || HasExtension(path, ".pfm") || HasExtension(path, ".exr");
+}
+
+// Construct and begin a stream, deleting it again if it cannot start
+template <typename Stream>
+static ImageStream * Begin(Stream * stream, const uint32_t width, const uint32_t height) {
+    if (!stream->begin(width, height)) {
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
+
+ImageStream * OpenImageStream(const char * path, const uint32_t width, const uint32_t height, const TonemapOptions & tonemap) {
+    if ((width == 0) || (height == 0)) {
+        fprintf(stderr, "%s: cannot write an empty image\n", path);
+        return NULL;
+    }
+
+    if (HasExtension(path, ".png")) {
+        return Begin(new PNGStream(path, tonemap), width, height);
+    } else if (HasExtension(path, ".exr")) {
+        return Begin(new EXRStream(path), width, height);
+    } else if (HasExtension(path, ".pfm")) {
+        return Begin(new PFMStream(path), width, height);
+    } else if (HasExtension(path, ".hdr")) {
+        return Begin(new HDRStream(path), width, height);
+    }
+
+    fprintf(stderr, "%s: unknown image format\n", path);
+    return NULL;
+}
+
+bool WriteImage(const char * path, const Framebuffer & framebuffer, const TonemapOptions & tonemap) {
+    ImageStream * stream = OpenImageStream(path, framebuffer.width, framebuffer.height, tonemap);
+    if (stream == NULL) {
+        return false;
+    }
+
+    bool ok = stream->write_rows(framebuffer, 0, framebuffer.height) && stream->finish();
+    delete stream;
+    return ok;
+}
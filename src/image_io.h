@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: image_io.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Image writers
+///
+/// @detail Images are written as streams: rows are handed over top to bottom
+///         as they are finished, so encoding can run while the rest of the
+///         frame is still rendering. PNG is tone mapped to 8 bits; the float
+///         formats store the framebuffer's linear radiance untouched:
+///
+///         - .png: 8-bit RGB, rows filtered and deflated (zlib) as they arrive
+///         - .exr: OpenEXR, 32-bit float RGB, uncompressed 64x64 tiles, each
+///                 row of tiles written once its rows are in
+///         - .pfm: Portable float map, 32-bit float RGB, rows written in place
+///         - .hdr: Radiance RGBE (via stb_image_write), written at the end
+///
+///         Each file is written as <path>.tmp and renamed over <path> once
+///         complete, so an image being republished (e.g. after every
+///         progressive pass) is never seen half-written.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "framebuffer.h"
+#include "tonemap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class ImageStream {
+public:
+    virtual ~ImageStream() {}
+
+    // Encode rows [begin, end) of the framebuffer; rows must arrive in order.
+    // Returns false after printing the reason to stderr
+    virtual bool write_rows(const Framebuffer & framebuffer, const uint32_t begin, const uint32_t end) = 0;
+
+    // Complete and close the file once every row has been written
+    virtual bool finish() = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Open an image for streaming, format by extension
+///
+/// @param  path - Output path
+/// @param  width - Image width
+/// @param  height - Image height
+/// @param  tonemap - Tone mapping for 8-bit formats
+///
+/// @return The stream, or NULL after printing the reason to stderr
+///////////////////////////////////////////////////////////////////////////////
+ImageStream * OpenImageStream(const char * path, const uint32_t width, const uint32_t height, const TonemapOptions & tonemap);
+
+// Write a whole framebuffer in one go
+bool WriteImage(const char * path, const Framebuffer & framebuffer, const TonemapOptions & tonemap);
+
+// True if the path has an extension OpenImageStream() understands
+bool IsImageFile(const char * path);
+
+#endif//IMAGE_IO_H
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: instance.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Transformed reference to a shared hittable object
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "instance.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+bool Instance::hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const {
+    // The object-space direction is not renormalized, so t carries over unchanged
+    if (!object->hit(transform.inverse_ray(ray), t_min, t_max, record)) {
+        return false;
+    }
+
+    record.p = ray.point_at_parameter(record.t);
+    record.normal = unit_vector(transform.normal(record.normal));
+
+    if (material != NULL) {
+        record.material = material;
+    }
+
+    return true;
+}
+
+bool Instance::bounding_box(AABB & box) const {
+    box = world_bounds;
+    return !world_bounds.empty();
+}
+
+bool Instance::motion_bounds(AABB & start, AABB & end) const {
+    // An affine map of interpolated corners is the interpolation of the
+    // mapped corners, so the mapped end boxes still bound the motion
+    AABB object_start;
+    AABB object_end;
+    if (!object->motion_bounds(object_start, object_end)) {
+        return false;
+    }
+
+    start = transform.box(object_start);
+    end = transform.box(object_end);
+    return true;
+}
+
+void Instance::set_transform(const Transform & t) {
+    AABB object_bounds;
+
+    transform = t;
+    if (object->bounding_box(object_bounds)) {
+        world_bounds = transform.box(object_bounds);
+    } else {
+        world_bounds = AABB();
+    }
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: instance.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Transformed reference to a shared hittable object
+///
+/// @detail Instances are the bottom of the two-level acceleration structure:
+///         a top-level BVH is built over instances, and each instance points
+///         at a shared bottom-level object (a primitive, or a BVH of them)
+///         that is never copied. Moving an instance only changes its
+///         transform and the top-level BVH; the shared object is untouched.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "hittable.h"
+#include "transform.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class Instance : public Hittable {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Instance constructor
+    ///
+    /// @param  o - Shared object, in its own (object) space
+    /// @param  t - Object-to-world transform
+    /// @param  m - Material overriding the object's own, or NULL to keep it
+    ///////////////////////////////////////////////////////////////////////////
+    Instance(Hittable * o, const Transform & t, Material * m = NULL) : object(o), material(m) {
+        set_transform(t);
+    }
+
+    virtual bool hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
+    virtual bool motion_bounds(AABB & start, AABB & end) const;
+
+    // Move the instance; the owning top-level BVH must be rebuilt or refit afterwards
+    void set_transform(const Transform & t);
+
+    Hittable * object;      ///< Shared object
+    Transform transform;    ///< Object-to-world transform
+    Material * material;    ///< Material override (NULL = use the object's)
+    AABB world_bounds;      ///< Cached world-space bounds
+};
+
+#endif//INSTANCE_H
@@ -29,7 +29,7 @@ public:
 
     virtual bool scatter(const Ray & ray, const HitRecord & record, vec3 & attenuation, Ray & scattered) const {
         vec3 target = record.p + record.normal + RandomInUnitSphere();
-        scattered = Ray(record.p, target - record.p);
+        scattered = Ray(record.p, target - record.p, ray.time());
         attenuation = albedo;
         return true;
     }
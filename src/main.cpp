@@ -14,146 +14,441 @@
 ///////////////////////////////////////////////////////////////////////////////
 // INCLUDES
 ///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <float.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include <unistd.h>
 
 #include "camera.h"
+#include "camera_path.h"
 #include "vec3.h"
 #include "ray.h"
 #include "sphere.h"
 #include "hittable_list.h"
+#include "bvh.h"
 #include "lambertian.h"
 #include "metal.h"
 #include "dielectric.h"
 #include "utilities.h"
+#include "options.h"
+#include "scenes.h"
+#include "mesh_io.h"
+#include "checkpoint.h"
+#include "framebuffer.h"
+#include "output.h"
+#include "renderer.h"
+#include "numa.h"
+#include "scheduler.h"
+#include "heatmap.h"
+#include "material_edit.h"
+#include "trace.h"
+#include "stats.h"
+#include "distributed.h"
+#include "server.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // METHODS
 ///////////////////////////////////////////////////////////////////////////////
-Hittable * RandomScene();
-
-int main() {
-    const uint32_t width = 1200;                ///< Scene width
-    const uint32_t height = 800;                ///< Scene height
-    const uint32_t num_samples = 80;            ///< Number of samples over which to average edge colour
-    const float gamma = 2.0;                    ///< Gamma value
-    const float inv_gamma = 1.0 / gamma;        ///< Inverse gamma value
-    const uint8_t PNG_RGB_CHANNELS = 3;         ///< Number of channels for PNG: 3 for RGB, 4 for RGBA
-
-    // Camera settings
-    const vec3 look_from(13, 2, 3);                                 ///< Look-from vector (origin)
-    const vec3 look_at(0, 0, 0);                                    ///< Look-at vector
-    const vec3 vup(0, 1, 0);                                        ///< View up
-    const float aspect_ratio = (float)width / height;               ///< Aspect ratio
-    const float vertical_fov = 20.0;                                ///< Vertical field of view in degrees (default = 90.0)
-    const float aperture = 0.1;                                     ///< Aperture
-    const float focal_distance = 10.0;                              ///< Focal distance
-
-    uint8_t * image_data = NULL;
-
-    // Allocate memory for the image
-    image_data = (uint8_t *) malloc(width * height * PNG_RGB_CHANNELS);
-
-    // Camera object
-    Camera camera(look_from, look_at, vup, vertical_fov, aspect_ratio, aperture, focal_distance);
-
-    // Materials
-    Lambertian diffuse_1(vec3(0.1, 0.2, 0.5));
-    Lambertian diffuse_2(vec3(0.8, 0.8, 0.0));
-    Metal metal_1(vec3(0.8, 0.6, 0.2), 0.3);
-    Metal metal_2(vec3(0.8, 0.8, 0.8), 1.0);
-    Dielectric dielectric_1(1.5);
-
-    // Hittable objects 
-    Hittable * list[5];
-    list[0] = new Sphere(vec3(0, -100.5, -1), 100, &diffuse_2);
-    list[1] = new Sphere(vec3(0, 0, -1), 0.5, &diffuse_1);
-    list[2] = new Sphere(vec3(1, 0, -1), 0.5, &metal_1);
-    list[3] = new Sphere(vec3(-1, 0, -1), 0.5, &dielectric_1);
-    list[4] = new Sphere(vec3(-1, 0, -1), -0.45, &dielectric_1);
-    Hittable * world = new HittableList(list, 5);
-
-    world = RandomScene();
-
-    // Draw screen starting in the lower left corner
-    for (int32_t j = height - 1; j >= 0; --j) {
-        for (int32_t i = 0; i < width; ++i) {
-            vec3 colour(0, 0, 0);
-
-            // Sample the edge values to perform anti-aliasing
-            for (int32_t s = 0; s < num_samples; ++s) {
-                float u = float(i + drand48()) / float(width);
-                float v = float(j + drand48()) / float(height);
-
-                Ray ray = camera.get_ray(u, v);
-                colour += Colour(ray, world, 0);
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Render passes of doubling sample counts, publishing the image after
+///         each, until the target sample count, the noise threshold or the
+///         renderer's deadline is reached
+///
+/// @param  renderer - Renderer, with its deadline set
+/// @param  framebuffer - Framebuffer, possibly resumed from a checkpoint
+/// @param  output - Output pipeline to publish through
+/// @param  options - Options
+/// @param  ok - Cleared if an image could not be written
+///
+/// @return False if the render was interrupted (not by the deadline)
+///////////////////////////////////////////////////////////////////////////////
+static bool RenderProgressive(Renderer & renderer, Framebuffer & framebuffer, OutputPipeline & output, const Options & options, bool & ok) {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+
+    // Passes are published from copies, so the next pass can render while
+    // the last one is encoded
+    Framebuffer published[2] = { Framebuffer(framebuffer.width, framebuffer.height), Framebuffer(framebuffer.width, framebuffer.height) };
+    uint32_t samples = framebuffer.min_samples();
+
+    for (uint32_t pass = 0; samples < options.num_samples; ++pass) {
+        const uint32_t target = std::min(options.num_samples, std::max(2 * samples, 1U));
+        bool complete = renderer.render(framebuffer, target, [](const uint32_t) {});
+
+        Framebuffer & copy = published[pass % 2];
+        if (output.begin_frame(&copy, options.outputs, options.tonemap)) {
+            renderer.snapshot(framebuffer, copy);
+            for (uint32_t y = 0; y < copy.height; ++y) {
+                output.row_done(y);
             }
+        } else {
+            ok = false;
+        }
+
+        const float noise = framebuffer.noise();
+        fprintf(stderr, "Pass %u: %u spp%s, noise %.4f, %.1f s\n", pass + 1, target, complete ? "" : " (partial)", noise,
+            std::chrono::duration<float>(Clock::now() - start).count());
+
+        if (!complete) {
+            ok = output.finish() && ok;
+            return Clock::now() >= renderer.deadline;
+        }
+
+        samples = target;
+        if (noise <= options.noise_threshold) {
+            break;
+        }
+    }
+
+    // The copies go out of scope with this function
+    ok = output.finish() && ok;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Build the camera and scene the options describe, with their
+///         material edits, and a renderer over them; the camera and scene are
+///         never freed
+///
+/// @param  options - Options
+///
+/// @return The renderer, or NULL if the scene could not be loaded or edited
+///////////////////////////////////////////////////////////////////////////////
+static Renderer * MakeRenderer(const Options & options) {
+    Hittable * world = BuildWorld(options);
+    if (world == NULL) {
+        return NULL;
+    }
+
+    Camera * camera = BuildCamera(options);
+    std::string error;
+    if (!ApplyMaterialEdits(options.material_edits, *world, *camera, options.width, options.height, NULL, error)) {
+        fprintf(stderr, "--material: %s\n", error.c_str());
+        return NULL;
+    }
+
+    Renderer * renderer = new Renderer(*camera, world);
+    renderer->first_sample = options.first_sample;
+    return renderer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Render the frames of an animation, building the scene and its BVH
+///         once and moving only the camera
+///
+/// @detail Each frame renders into one of two framebuffers, so it can start
+///         while the frame before is still being encoded. Frame f is
+///         rendered with seed f, so frame 0 is the same image as a still
+///         render of the same options.
+///
+/// @param  options - Options
+///
+/// @return False if the scene or camera path could not be loaded or an image
+///         could not be written
+///////////////////////////////////////////////////////////////////////////////
+static bool RenderAnimation(const Options & options) {
+    typedef std::chrono::steady_clock Clock;
+
+    CameraPath path;
+    if (!options.camera_path.empty() && !path.load(options.camera_path.c_str())) {
+        return false;
+    }
+
+    uint32_t num_frames = options.num_frames;
+    if (num_frames == 0) {
+        num_frames = std::max(path.length(), options.first_frame + 1) - options.first_frame;
+    }
+
+    Hittable * world = BuildWorld(options);
+    if (world == NULL) {
+        return false;
+    }
+
+    // Materials are picked through the camera before the path moves it
+    {
+        const Camera * camera = BuildCamera(options);
+        std::string error;
+        const bool edited = ApplyMaterialEdits(options.material_edits, *world, *camera, options.width, options.height, NULL, error);
+        delete camera;
+        if (!edited) {
+            fprintf(stderr, "--material: %s\n", error.c_str());
+            return false;
+        }
+    }
+
+    StatsReporter * reporter = NULL;
+    if (options.stats_interval > 0.0F) {
+        reporter = new StatsReporter(options.stats_interval);
+    }
 
-            colour /= float(num_samples);
-            colour = vec3(pow(colour.r(), inv_gamma), pow(colour.g(), inv_gamma), pow(colour.b(), inv_gamma));
+    Framebuffer buffers[2] = {
+        Framebuffer(options.crop_width, options.crop_height, options.crop_left, options.crop_top, options.width, options.height),
+        Framebuffer(options.crop_width, options.crop_height, options.crop_left, options.crop_top, options.width, options.height)
+    };
+    OutputPipeline output;
+    bool ok = true;
 
-            int32_t ir = int32_t(255.99 * colour.r());
-            int32_t ig = int32_t(255.99 * colour.g());
-            int32_t ib = int32_t(255.99 * colour.b());
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        const Clock::time_point start = Clock::now();
+        const uint32_t frame = options.first_frame + i;
 
-            uint32_t y = (height - 1 - j) * PNG_RGB_CHANNELS;
-            uint32_t x = i * PNG_RGB_CHANNELS;
+        Options shot = options;
+        if (!path.apply(frame, shot)) {
+            fprintf(stderr, "%s: frame %u puts look-from on look-at\n", options.camera_path.c_str(), frame);
+            ok = false;
+            break;
+        }
+        if (options.turntable) {
+            const float angle = 2.0F * float(M_PI) * i / num_frames;
+            const vec3 offset = shot.look_from - shot.look_at;
+            const float c = cosf(angle);
+            const float s = sinf(angle);
+            shot.look_from = shot.look_at + vec3((c * offset.x()) + (s * offset.z()), offset.y(), (c * offset.z()) - (s * offset.x()));
+        }
 
-            uint32_t r_index = (y * width) + x + 0;
-            uint32_t g_index = (y * width) + x + 1;
-            uint32_t b_index = (y * width) + x + 2;
+        std::vector<std::string> paths(options.outputs.size());
+        for (size_t k = 0; k < paths.size(); ++k) {
+            paths[k] = NumberedPath(options.outputs[k], frame);
+        }
 
-            image_data[r_index] = (uint8_t)ir;
-            image_data[g_index] = (uint8_t)ig;
-            image_data[b_index] = (uint8_t)ib;
+        // Waits for the frame before last to be encoded out of this buffer
+        Framebuffer & framebuffer = buffers[i % 2];
+        if (!output.begin_frame(&framebuffer, paths, options.tonemap)) {
+            ok = false;
+            break;
         }
+        framebuffer.clear();
+
+        const Camera * camera = BuildCamera(shot);
+        Renderer renderer(*camera, world);
+        renderer.seed = frame;
+        renderer.first_sample = options.first_sample;
+        renderer.render(framebuffer, options.num_samples, [&](const uint32_t y) { output.row_done(y); });
+        delete camera;
+
+        fprintf(stderr, "Frame %u: %.2f s\n", frame, std::chrono::duration<float>(Clock::now() - start).count());
     }
 
-    // Write PNG
-    stbi_write_png("scene.png", width, height, PNG_RGB_CHANNELS, image_data, width * PNG_RGB_CHANNELS);
+    ok = output.finish() && ok;
+    delete reporter;
+    return ok;
+}
+
+// Sum partial files into the outputs, and into another partial file if asked
+static bool MergePartials(const Options & options) {
+    Framebuffer framebuffer(0, 0);
+    uint64_t seed = 0;
+    uint32_t first_sample = 0;
+    bool contiguous = true;
+    if (!MergeCheckpoints(options.merge, framebuffer, seed, first_sample, contiguous)) {
+        return false;
+    }
 
-    // Free the image data
-    free(image_data);
+    bool ok = true;
+    if (!options.partial.empty()) {
+        if (!contiguous) {
+            fprintf(stderr, "%s: not written, the parts leave gaps in the samples\n", options.partial.c_str());
+            ok = false;
+        } else {
+            ok = SaveCheckpoint(options.partial.c_str(), framebuffer, seed, first_sample);
+        }
+    }
+
+    OutputPipeline output;
+    if (!output.begin_frame(&framebuffer, options.outputs, options.tonemap)) {
+        return false;
+    }
+    for (uint32_t y = 0; y < framebuffer.height; ++y) {
+        output.row_done(y);
+    }
+    return output.finish() && ok;
 }
 
-Hittable * RandomScene() {
-    int32_t n = 500;
-    Hittable ** list = new Hittable * [n + 1];
-    list[0] =  new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
-    int32_t i = 1;
-    for (int32_t a = -11; a < 11; a++) {
-        for (int32_t b = -11; b < 11; b++) {
-            float material = drand48();
-            vec3 centre(a + 0.9 * drand48(), 0.2, b + 0.9 * drand48()); 
-            if ((centre - vec3(4, 0.2, 0)).length() > 0.9) {
-                // Diffuse 
-                if (material < 0.8) {
-                    list[i++] = new Sphere(centre, 0.2, new Lambertian(vec3(drand48() * drand48(), drand48() * drand48(), drand48() * drand48())));
-                }
+int main(int argc, char ** argv) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-                // Metal
-                else if (material < 0.95) {
-                    list[i++] = new Sphere(centre, 0.2,
-                            new Metal(vec3(0.5 * (1 + drand48()), 0.5 * (1 + drand48()), 0.5 * (1 + drand48())),  0.5 * drand48()));
-                }
-                
-                // Glass
-                else {
-                    list[i++] = new Sphere(centre, 0.2, new Dielectric(1.5));
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+    Scheduler::Configure(options.num_threads, options.pin_threads);
+
+    // The main thread runs tiles as pool slot 0; the threads it starts for
+    // encoding, checkpoints and stats unpin themselves (StartHelperThread)
+    if (options.pin_threads) {
+        PinThread(0);
+    }
+
+    if (!options.trace.empty()) {
+        StartTrace();
+        SetTraceThreadName("main");
+    }
+
+    // Profiling is best effort; a node that won't allow it still renders
+    if (options.perf_counters) {
+        StartPerfCounters();
+    }
+
+    if (!options.merge.empty()) {
+        return MergePartials(options) ? 0 : 1;
+    }
+
+    if (!options.submit.empty()) {
+        return Submit(options, argc, argv) ? 0 : 1;
+    }
+
+    if (!options.serve.empty()) {
+        return Serve(options) ? 0 : 1;
+    }
+
+    // A worker builds everything from its coordinator's options
+    if (!options.work.empty()) {
+        bool ok = Work(options, MakeRenderer);
+        if (options.stats) {
+            PrintStats(GatherStats());
+        }
+        if (!options.trace.empty()) {
+            ok = WriteTrace(options.trace.c_str()) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+
+    if (options.animation) {
+        bool ok = RenderAnimation(options);
+        if (options.stats) {
+            PrintStats(GatherStats());
+        }
+        if (!options.trace.empty()) {
+            ok = WriteTrace(options.trace.c_str()) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+
+    const uint32_t width = options.crop_width;          ///< Width of the region rendered
+    const uint32_t height = options.crop_height;        ///< Height of the region rendered
+    const uint32_t num_samples = options.num_samples;   ///< Number of samples over which to average edge colour
+
+    // Linear radiance, tone mapped only when 8-bit images are written
+    Framebuffer framebuffer(width, height, options.crop_left, options.crop_top, options.width, options.height);
+
+    // Only the workers render a coordinated frame, so the coordinator skips
+    // the scene; its renderer just carries the seed and first sample
+    const bool coordinating = !options.coordinate.empty() || (options.workers > 0);
+    Renderer * built = NULL;
+    if (coordinating) {
+        built = new Renderer(*BuildCamera(options), NULL);
+        built->first_sample = options.first_sample;
+    } else {
+        built = MakeRenderer(options);
+    }
+    if (built == NULL) {
+        return 1;
+    }
+    Renderer & renderer = *built;
+
+    CostMap * costs = NULL;
+    if (!options.heatmap.empty()) {
+        costs = new CostMap(width, height);
+        renderer.costs = costs;
+    }
+
+    // Pick up where a previous run stopped
+    if (options.resume && (access(options.checkpoint.c_str(), F_OK) == 0)) {
+        uint32_t first_sample = 0;
+        if (!LoadCheckpoint(options.checkpoint.c_str(), framebuffer, renderer.seed, first_sample)) {
+            return 1;
+        }
+
+        if (first_sample != renderer.first_sample) {
+            fprintf(stderr, "%s: checkpoint starts at sample %u, not %u\n", options.checkpoint.c_str(), first_sample, renderer.first_sample);
+            return 1;
+        }
+    }
+
+    StatsReporter * reporter = NULL;
+    if (options.stats_interval > 0.0F) {
+        reporter = new StatsReporter(options.stats_interval);
+    }
+
+    OutputPipeline output;
+    Checkpointer * checkpointer = NULL;
+    bool ok = true;
+    bool complete = true;
+
+    if (options.progressive) {
+        if (options.time_limit > 0.0F) {
+            renderer.deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(options.time_limit));
+        }
+
+        if (!options.checkpoint.empty()) {
+            checkpointer = new Checkpointer(options.checkpoint, options.checkpoint_interval, renderer, framebuffer);
+        }
+
+        complete = RenderProgressive(renderer, framebuffer, output, options, ok);
+    } else {
+        // Rows are encoded in the background as they finish
+        if (!output.begin_frame(&framebuffer, options.outputs, options.tonemap)) {
+            return 1;
+        }
+
+        if (!options.checkpoint.empty()) {
+            checkpointer = new Checkpointer(options.checkpoint, options.checkpoint_interval, renderer, framebuffer);
+        }
+
+        std::vector<uint8_t> finished(height, 0);
+        auto row_done = [&](const uint32_t y) {
+            finished[y] = 1;
+            output.row_done(y);
+        };
+
+        if (coordinating) {
+            complete = Coordinate(options, argc, argv, framebuffer, renderer.seed, row_done);
+        } else {
+            complete = renderer.render(framebuffer, num_samples, row_done);
+        }
+
+        // An interrupted frame is still written out, with the rows it did
+        // not reach left as they were
+        if (!complete) {
+            for (uint32_t y = 0; y < height; ++y) {
+                if (!finished[y]) {
+                    output.row_done(y);
                 }
             }
         }
     }
 
-    list[i++] = new Sphere(vec3(0, 1, 0), 1.0, new Dielectric(1.5));
-    list[i++] = new Sphere(vec3(-4, 1, 0), 1.0, new Lambertian(vec3(0.4, 0.2, 0.1)));
-    list[i++] = new Sphere(vec3(4, 1, 0), 1.0, new Metal(vec3(0.7, 0.6, 0.5), 0.0));
+    if (checkpointer != NULL) {
+        ok = checkpointer->finish() && ok;
+        delete checkpointer;
+    }
+
+    if (!options.partial.empty()) {
+        ok = SaveCheckpoint(options.partial.c_str(), framebuffer, renderer.seed, renderer.first_sample) && ok;
+    }
 
-    return new HittableList(list, i);
+    if (!complete) {
+        if (!options.checkpoint.empty()) {
+            fprintf(stderr, "Render interrupted; continue it with --resume\n");
+        }
+        ok = false;
+    }
+
+    ok = output.finish() && ok;
+    delete reporter;
+
+    if (costs != NULL) {
+        ok = WriteHeatmaps(options.heatmap, *costs) && ok;
+        delete costs;
+    }
+
+    if (options.stats) {
+        PrintStats(GatherStats());
+    }
+
+    if (!options.trace.empty()) {
+        ok = WriteTrace(options.trace.c_str()) && ok;
+    }
+    return ok ? 0 : 1;
 }
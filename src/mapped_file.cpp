@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mapped_file.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Read-only memory-mapped file
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::open(const char * path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+        ::close(fd);
+        return false;
+    }
+
+    void * p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    // Importers stream through the file once, front to back
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    data = (const uint8_t *)p;
+    size = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != NULL) {
+        munmap((void *)data, size);
+        data = NULL;
+        size = 0;
+    }
+}
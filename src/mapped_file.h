@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mapped_file.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Read-only memory-mapped file
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <stddef.h>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class MappedFile {
+public:
+    MappedFile() : data(NULL), size(0) {}
+    ~MappedFile() { close(); }
+
+    // Map a whole file; returns false (with errno set) on failure
+    bool open(const char * path);
+    void close();
+
+    const uint8_t * data;   ///< Mapped bytes, NULL if not open
+    size_t size;            ///< Size in bytes
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+};
+
+#endif//MAPPED_FILE_H
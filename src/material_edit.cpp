@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: material_edit.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Material changes on a built scene, for look development
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <float.h>
+#include <stdio.h>
+
+#include "material_edit.h"
+#include "camera.h"
+#include "hittable.h"
+#include "lambertian.h"
+#include "metal.h"
+#include "dielectric.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const char * const PARAMETER_NAMES[NUM_MATERIAL_PARAMETERS] = { "albedo", "fuzz", "ior" };
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+const char * MaterialParameterName(const MaterialParameter parameter) {
+    return PARAMETER_NAMES[parameter];
+}
+
+// A material's value of a parameter, scalars in value[0]; false if it has
+// no such parameter
+static bool GetParameter(const Material * material, const MaterialParameter parameter, vec3 & value) {
+    if (const Lambertian * lambertian = dynamic_cast<const Lambertian *>(material)) {
+        if (parameter == MATERIAL_ALBEDO) {
+            value = lambertian->albedo;
+            return true;
+        }
+    } else if (const Metal * metal = dynamic_cast<const Metal *>(material)) {
+        if (parameter == MATERIAL_ALBEDO) {
+            value = metal->albedo;
+            return true;
+        } else if (parameter == MATERIAL_FUZZ) {
+            value = vec3(metal->fuzz, 0, 0);
+            return true;
+        }
+    } else if (const Dielectric * dielectric = dynamic_cast<const Dielectric *>(material)) {
+        if (parameter == MATERIAL_IOR) {
+            value = vec3(dielectric->refraction_index, 0, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only called with parameters GetParameter() found
+static void SetParameter(Material * material, const MaterialParameter parameter, const vec3 & value) {
+    if (Lambertian * lambertian = dynamic_cast<Lambertian *>(material)) {
+        lambertian->albedo = value;
+    } else if (Metal * metal = dynamic_cast<Metal *>(material)) {
+        if (parameter == MATERIAL_ALBEDO) {
+            metal->albedo = value;
+        } else {
+            metal->fuzz = value[0];
+        }
+    } else if (Dielectric * dielectric = dynamic_cast<Dielectric *>(material)) {
+        dielectric->refraction_index = value[0];
+    }
+}
+
+static const char * MaterialName(const Material * material) {
+    if (dynamic_cast<const Lambertian *>(material) != NULL) {
+        return "lambertian";
+    } else if (dynamic_cast<const Metal *>(material) != NULL) {
+        return "metal";
+    } else if (dynamic_cast<const Dielectric *>(material) != NULL) {
+        return "dielectric";
+    }
+    return "unknown";
+}
+
+bool ApplyMaterialEdits(const std::vector<MaterialEdit> & edits, const Hittable & world, const Camera & camera, const uint32_t width,
+    const uint32_t height, std::vector<MaterialUndo> * undo, std::string & error) {
+    // Pick everything first, so a bad edit leaves the scene as it was
+    std::vector<Material *> materials(edits.size(), NULL);
+    for (size_t i = 0; i < edits.size(); ++i) {
+        const MaterialEdit & edit = edits[i];
+        const float s = (float(edit.x) + 0.5F) / float(width);
+        const float t = (float(height - 1 - edit.y) + 0.5F) / float(height);
+        const Ray ray(camera.origin, camera.lower_left_corner + (s * camera.horizontal) + (t * camera.vertical) - camera.origin, camera.time0);
+
+        char text[256];
+        HitRecord record;
+        if (!world.hit(ray, 0.001, FLT_MAX, record) || (record.material == NULL)) {
+            snprintf(text, sizeof(text), "no material at pixel %u,%u", edit.x, edit.y);
+            error = text;
+            return false;
+        }
+
+        vec3 value;
+        if (!GetParameter(record.material, edit.parameter, value)) {
+            snprintf(text, sizeof(text), "the %s material at pixel %u,%u has no %s", MaterialName(record.material), edit.x, edit.y,
+                MaterialParameterName(edit.parameter));
+            error = text;
+            return false;
+        }
+        materials[i] = record.material;
+    }
+
+    for (size_t i = 0; i < edits.size(); ++i) {
+        if (undo != NULL) {
+            MaterialUndo previous = { materials[i], edits[i].parameter, vec3() };
+            GetParameter(materials[i], edits[i].parameter, previous.value);
+            undo->push_back(previous);
+        }
+        SetParameter(materials[i], edits[i].parameter, edits[i].value);
+    }
+    return true;
+}
+
+void UndoMaterialEdits(std::vector<MaterialUndo> & undo) {
+    // Newest first, so a material edited twice ends up as it started
+    for (size_t i = undo.size(); i-- > 0; ) {
+        SetParameter(undo[i].material, undo[i].parameter, undo[i].value);
+    }
+    undo.clear();
+}
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: material_edit.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Material changes on a built scene, for look development
+///
+/// @detail Materials are anonymous, so an edit names the one to change by a
+///         pixel of the image: the material of the first surface a ray
+///         through the pixel's centre (from the centre of the lens, at the
+///         shutter's opening) hits. The edit changes that material in place,
+///         so the scene and its BVH are untouched, and every object sharing
+///         the material changes with it. Applied edits can be undone, which
+///         lets a render server keep one built scene for many jobs.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATERIAL_EDIT_H
+#define MATERIAL_EDIT_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "vec3.h"
+
+class Camera;
+class Hittable;
+class Material;
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum MaterialParameter {
+    MATERIAL_ALBEDO,            ///< Lambertian or Metal albedo
+    MATERIAL_FUZZ,              ///< Metal fuzziness, 0 to 1
+    MATERIAL_IOR,               ///< Dielectric refractive index
+    NUM_MATERIAL_PARAMETERS
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// A new value for one parameter of the material seen through a pixel;
+// scalars use value[0]
+struct MaterialEdit {
+    uint32_t x;                     ///< Frame column of the pixel
+    uint32_t y;                     ///< Frame row of the pixel, from the top
+    MaterialParameter parameter;    ///< Parameter to change
+    vec3 value;                     ///< New value
+};
+
+// What an applied edit replaced, to put it back
+struct MaterialUndo {
+    Material * material;            ///< Material changed
+    MaterialParameter parameter;    ///< Parameter changed
+    vec3 value;                     ///< Value before the edit
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Name of a parameter as --material takes it
+const char * MaterialParameterName(const MaterialParameter parameter);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Apply edits, in order, to the materials of a built scene
+///
+/// @detail Every edit picks its material before any is changed. Nothing is
+///         changed if an edit fails: if its pixel sees no surface, or the
+///         material there has no such parameter.
+///
+/// @param  edits - Edits to apply
+/// @param  world - Scene the camera looks at
+/// @param  camera - Camera the edits' pixels are of
+/// @param  width - Frame width the camera was built for
+/// @param  height - Frame height
+/// @param  undo - If not NULL, appended with what to restore, in the order
+///                UndoMaterialEdits() needs
+/// @param  error - Set to the reason on failure
+///
+/// @return False if an edit could not be applied
+///////////////////////////////////////////////////////////////////////////////
+bool ApplyMaterialEdits(const std::vector<MaterialEdit> & edits, const Hittable & world, const Camera & camera, const uint32_t width,
+    const uint32_t height, std::vector<MaterialUndo> * undo, std::string & error);
+
+// Restore the materials ApplyMaterialEdits() changed, and empty undo
+void UndoMaterialEdits(std::vector<MaterialUndo> & undo);
+
+#endif//MATERIAL_EDIT_H
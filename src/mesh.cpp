@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mesh.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Indexed triangle mesh
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+
+#include "mesh.h"
+#include "scheduler.h"
+#include "simd.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define MESH_REFIT_GRAIN 1024   ///< Packets repacked per refit task
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Per-ray setup for the watertight test: the ray is mapped to +Z by a
+// permutation and shear, after which triangles are tested in 2-D
+struct WatertightRay {
+    int32_t kx;     ///< Permuted X axis
+    int32_t ky;     ///< Permuted Y axis
+    int32_t kz;     ///< Axis with the largest direction component
+    float sx;       ///< Shear along X
+    float sy;       ///< Shear along Y
+    float sz;       ///< Scale along Z
+    vec3 origin;    ///< Ray origin
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static inline WatertightRay PrepareRay(const Ray & ray) {
+    WatertightRay r;
+    const vec3 & d = ray.B;
+
+    vec3 a(fabsf(d.x()), fabsf(d.y()), fabsf(d.z()));
+    r.kz = ((a.x() > a.y()) && (a.x() > a.z())) ? 0 : ((a.y() > a.z()) ? 1 : 2);
+    r.kx = (r.kz + 1) % 3;
+    r.ky = (r.kx + 1) % 3;
+
+    // Swap to preserve the winding direction of triangles
+    if (d[r.kz] < 0.0F) {
+        int32_t temp = r.kx;
+        r.kx = r.ky;
+        r.ky = temp;
+    }
+
+    r.sx = d[r.kx] / d[r.kz];
+    r.sy = d[r.ky] / d[r.kz];
+    r.sz = 1.0F / d[r.kz];
+    r.origin = ray.A;
+    return r;
+}
+
+// Recompute one lane's edge functions in double precision. Single precision
+// can round an edge function to exactly zero, which is where watertightness
+// would otherwise be lost
+static void EdgeFunctionsDouble(const TrianglePacket & p, const int32_t lane, const WatertightRay & r, float * u, float * v, float * w) {
+    double x[3];
+    double y[3];
+
+    for (int32_t i = 0; i < 3; ++i) {
+        double pz = (double)p.v[i][r.kz][lane] - r.origin[r.kz];
+        x[i] = ((double)p.v[i][r.kx][lane] - r.origin[r.kx]) - (r.sx * pz);
+        y[i] = ((double)p.v[i][r.ky][lane] - r.origin[r.ky]) - (r.sy * pz);
+    }
+
+    u[lane] = (float)((x[2] * y[1]) - (y[2] * x[1]));
+    v[lane] = (float)((x[0] * y[2]) - (y[0] * x[2]));
+    w[lane] = (float)((x[1] * y[0]) - (y[1] * x[0]));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Intersect a ray with a packet of triangles
+///
+/// @param  p - The packet
+/// @param  r - Prepared ray
+/// @param  t_min - Minimum ray parameter
+/// @param  t_max - Maximum ray parameter
+/// @param  t - Output hit distance per lane
+/// @param  u - Output (unnormalized) barycentric of vertex 0 per lane
+/// @param  v - Output (unnormalized) barycentric of vertex 1 per lane
+/// @param  det - Output barycentric normalizer per lane
+///
+/// @return Bit mask of lanes hit within (t_min, t_max)
+///////////////////////////////////////////////////////////////////////////////
+static inline int32_t IntersectPacket(const TrianglePacket & p, const WatertightRay & r, const float t_min, const float t_max, float * t, float * u, float * v, float * det) {
+    const float4 ox(r.origin[r.kx]);
+    const float4 oy(r.origin[r.ky]);
+    const float4 oz(r.origin[r.kz]);
+    const float4 sx(r.sx);
+    const float4 sy(r.sy);
+    const float4 zero(0.0F);
+
+    // Vertices relative to the origin, then sheared so the ray is +Z
+    float4 az = float4::load(p.v[0][r.kz]) - oz;
+    float4 bz = float4::load(p.v[1][r.kz]) - oz;
+    float4 cz = float4::load(p.v[2][r.kz]) - oz;
+    float4 ax = (float4::load(p.v[0][r.kx]) - ox) - (sx * az);
+    float4 ay = (float4::load(p.v[0][r.ky]) - oy) - (sy * az);
+    float4 bx = (float4::load(p.v[1][r.kx]) - ox) - (sx * bz);
+    float4 by = (float4::load(p.v[1][r.ky]) - oy) - (sy * bz);
+    float4 cx = (float4::load(p.v[2][r.kx]) - ox) - (sx * cz);
+    float4 cy = (float4::load(p.v[2][r.ky]) - oy) - (sy * cz);
+
+    // Scaled barycentrics (2-D edge functions)
+    float4 U = (cx * by) - (cy * bx);
+    float4 V = (ax * cy) - (ay * cx);
+    float4 W = (bx * ay) - (by * ax);
+
+    int32_t on_edge = movemask((U == zero) | (V == zero) | (W == zero));
+    if (on_edge != 0) {
+        float uu[TRIANGLE_PACKET_WIDTH];
+        float vv[TRIANGLE_PACKET_WIDTH];
+        float ww[TRIANGLE_PACKET_WIDTH];
+        U.store(uu);
+        V.store(vv);
+        W.store(ww);
+
+        for (int32_t lane = 0; lane < TRIANGLE_PACKET_WIDTH; ++lane) {
+            if (on_edge & (1 << lane)) {
+                EdgeFunctionsDouble(p, lane, r, uu, vv, ww);
+            }
+        }
+
+        U = float4::load(uu);
+        V = float4::load(vv);
+        W = float4::load(ww);
+    }
+
+    // Mixed signs mean the ray passes outside the triangle (either winding hits)
+    int32_t outside = movemask(((U < zero) | (V < zero) | (W < zero)) & ((U > zero) | (V > zero) | (W > zero)));
+
+    float4 D = U + V + W;
+    float4 T = float4(r.sz) * ((U * az) + (V * bz) + (W * cz));
+    float4 distance = T / D;
+
+    // Padding lanes hold NaNs, which fail every ordered comparison here
+    int32_t mask = movemask((D != zero) & (distance > float4(t_min)) & (distance < float4(t_max)));
+    mask &= ~outside;
+
+    if (mask != 0) {
+        distance.store(t);
+        U.store(u);
+        V.store(v);
+        D.store(det);
+    }
+
+    return mask;
+}
+
+TriangleMesh::TriangleMesh(Material * m) :
+    vertices(NULL),
+    num_vertices(0),
+    indices(NULL),
+    num_indices(0),
+    normals(NULL),
+    material(m),
+    mapping(NULL),
+    built_cost(0.0) {
+}
+
+TriangleMesh::TriangleMesh(std::vector<vec3> v, std::vector<uint32_t> i, Material * m, std::vector<vec3> n) :
+    material(m),
+    vertex_storage(std::move(v)),
+    index_storage(std::move(i)),
+    normal_storage(std::move(n)),
+    mapping(NULL) {
+    vertices = vertex_storage.data();
+    num_vertices = vertex_storage.size();
+    indices = index_storage.data();
+    num_indices = index_storage.size();
+    normals = normal_storage.empty() ? NULL : normal_storage.data();
+    build();
+}
+
+TriangleMesh::~TriangleMesh() {
+    delete mapping;
+}
+
+void TriangleMesh::build(const BVHBuildOptions & options) {
+    const size_t n = num_triangles();
+    std::vector<AABB> bounds(n);
+    std::vector<uint32_t> order;
+
+    for (size_t i = 0; i < n; ++i) {
+        for (int32_t k = 0; k < 3; ++k) {
+            bounds[i].expand(vertices[indices[(3 * i) + k]]);
+        }
+    }
+
+    BuildBVH(bounds, options, nodes, order);
+
+    // Repack every leaf's triangles into packets; leaves then address packets
+    packets.clear();
+    packets.reserve((n / TRIANGLE_PACKET_WIDTH) + nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        BVHNode & node = nodes[i];
+        if (node.count == 0) {
+            continue;
+        }
+
+        uint32_t first_packet = packets.size();
+        for (uint32_t k = 0; k < node.count; k += TRIANGLE_PACKET_WIDTH) {
+            TrianglePacket packet;
+
+            for (int32_t lane = 0; lane < TRIANGLE_PACKET_WIDTH; ++lane) {
+                bool used = (k + lane) < node.count;
+                uint32_t triangle = used ? order[node.offset + k + lane] : 0;
+
+                for (int32_t vertex = 0; vertex < 3; ++vertex) {
+                    const vec3 & p = vertices[indices[(3 * triangle) + vertex]];
+                    for (int32_t axis = 0; axis < 3; ++axis) {
+                        packet.v[vertex][axis][lane] = used ? p[axis] : NAN;
+                    }
+                }
+                packet.triangle[lane] = triangle;
+            }
+
+            packets.push_back(packet);
+        }
+
+        node.offset = first_packet;
+        node.count = packets.size() - first_packet;
+    }
+
+    root_bounds = nodes.empty() ? AABB() : nodes[0].bounds;
+    compressed.clear();
+    if (options.compress_nodes) {
+        CompressBVH(nodes, compressed);
+        std::vector<BVHNode>().swap(nodes);
+    }
+    built_cost = compressed.empty() ? BVHCost(nodes) : QBVHCost(compressed);
+}
+
+bool TriangleMesh::refit(const BVHBuildOptions & options) {
+    if (packets.empty()) {
+        return false;
+    }
+
+    // Leaves address packets, so the packets are the primitives refit over
+    std::vector<AABB> bounds(packets.size());
+    Scheduler::Instance().parallel_for(uint32_t(packets.size()), [&](const uint32_t i) {
+        TrianglePacket & packet = packets[i];
+        AABB box;
+        for (int32_t lane = 0; lane < TRIANGLE_PACKET_WIDTH; ++lane) {
+            // Unused lanes keep their NaNs
+            if (std::isnan(packet.v[0][0][lane])) {
+                continue;
+            }
+
+            for (int32_t vertex = 0; vertex < 3; ++vertex) {
+                const vec3 & p = vertices[indices[(3 * packet.triangle[lane]) + vertex]];
+                for (int32_t axis = 0; axis < 3; ++axis) {
+                    packet.v[vertex][axis][lane] = p[axis];
+                }
+                box.expand(p);
+            }
+        }
+        bounds[i] = box;
+    }, MESH_REFIT_GRAIN);
+
+    float cost;
+    if (!compressed.empty()) {
+        root_bounds = RefitQBVH(compressed, bounds);
+        cost = QBVHCost(compressed);
+    } else {
+        RefitBVH(nodes, bounds);
+        root_bounds = nodes[0].bounds;
+        cost = BVHCost(nodes);
+    }
+
+    if (cost > built_cost * (1.0F + options.rebuild_threshold)) {
+        build(options);
+        return true;
+    }
+    return false;
+}
+
+bool TriangleMesh::hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const {
+    if (packets.empty()) {
+        return false;
+    }
+
+    const WatertightRay r = PrepareRay(ray);
+    const TrianglePacket * all = packets.data();
+
+    uint32_t best_triangle = 0;
+    float best_u = 0.0;
+    float best_v = 0.0;
+    float best_det = 1.0;
+
+    auto leaf = [&](const uint32_t first, const uint32_t count, const float leaf_t_min, float & closest_so_far) {
+        bool hit_anything = false;
+        float t[TRIANGLE_PACKET_WIDTH];
+        float u[TRIANGLE_PACKET_WIDTH];
+        float v[TRIANGLE_PACKET_WIDTH];
+        float det[TRIANGLE_PACKET_WIDTH];
+
+        CountStat(STAT_PRIMITIVE_TESTS, count * TRIANGLE_PACKET_WIDTH);
+        for (uint32_t i = first; i < first + count; ++i) {
+            int32_t mask = IntersectPacket(all[i], r, leaf_t_min, closest_so_far, t, u, v, det);
+
+            while (mask != 0) {
+                int32_t lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+
+                if (t[lane] < closest_so_far) {
+                    closest_so_far = t[lane];
+                    best_triangle = all[i].triangle[lane];
+                    best_u = u[lane];
+                    best_v = v[lane];
+                    best_det = det[lane];
+                    hit_anything = true;
+                }
+            }
+        }
+
+        return hit_anything;
+    };
+
+    float closest_so_far = t_max;
+    bool hit_anything = compressed.empty() ?
+        TraverseBVH(nodes.data(), ray, t_min, closest_so_far, leaf) :
+        TraverseQBVH(compressed.data(), ray, t_min, closest_so_far, leaf);
+    if (!hit_anything) {
+        return false;
+    }
+
+    const uint32_t * tri = &indices[3 * best_triangle];
+
+    record.t = closest_so_far;
+    record.p = ray.point_at_parameter(record.t);
+    record.material = material;
+
+    if (normals == NULL) {
+        record.normal = unit_vector(cross(vertices[tri[1]] - vertices[tri[0]], vertices[tri[2]] - vertices[tri[0]]));
+    } else {
+        float b0 = best_u / best_det;
+        float b1 = best_v / best_det;
+        float b2 = 1.0F - b0 - b1;
+        record.normal = unit_vector((b0 * normals[tri[0]]) + (b1 * normals[tri[1]]) + (b2 * normals[tri[2]]));
+    }
+
+    return true;
+}
+
+bool TriangleMesh::bounding_box(AABB & box) const {
+    if (packets.empty()) {
+        return false;
+    }
+
+    box = root_bounds;
+    return true;
+}
+
+TriangleMesh * UVSphereMesh(const vec3 & centre, const float radius, const uint32_t segments, const uint32_t rings, Material * m) {
+    std::vector<vec3> vertices;
+    std::vector<vec3> normals;
+    std::vector<uint32_t> indices;
+
+    for (uint32_t r = 0; r <= rings; ++r) {
+        float theta = M_PI * r / rings;
+        for (uint32_t s = 0; s < segments; ++s) {
+            float phi = 2.0 * M_PI * s / segments;
+            vec3 n(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+            normals.push_back(n);
+            vertices.push_back(centre + (radius * n));
+        }
+    }
+
+    // Wrap around the seam by index so the mesh stays closed; the triangles
+    // that would collapse onto the poles are skipped
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            uint32_t a = (r * segments) + s;
+            uint32_t b = (r * segments) + ((s + 1) % segments);
+            uint32_t c = ((r + 1) * segments) + s;
+            uint32_t d = ((r + 1) * segments) + ((s + 1) % segments);
+
+            if (r != 0) {
+                indices.push_back(a);
+                indices.push_back(b);
+                indices.push_back(c);
+            }
+
+            if (r != (rings - 1)) {
+                indices.push_back(b);
+                indices.push_back(d);
+                indices.push_back(c);
+            }
+        }
+    }
+
+    return new TriangleMesh(vertices, indices, m, normals);
+}
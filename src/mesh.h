@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mesh.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Indexed triangle mesh
+///
+/// @detail The mesh owns a shared vertex buffer, an index buffer and optional
+///         per-vertex normals, plus its own bottom-level BVH. BVH leaves
+///         point at packets of four triangles stored structure-of-arrays,
+///         which are tested together with the watertight ray/triangle
+///         algorithm of Woop, Benthin and Wald (JCGT 2013).
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MESH_H
+#define MESH_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "hittable.h"
+#include "bvh.h"
+#include "mapped_file.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define TRIANGLE_PACKET_WIDTH 4     ///< Triangles tested together
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Four triangles, structure-of-arrays; unused lanes are degenerate and never hit
+struct TrianglePacket {
+    float v[3][3][TRIANGLE_PACKET_WIDTH];       ///< v[vertex][axis][lane]
+    uint32_t triangle[TRIANGLE_PACKET_WIDTH];   ///< Triangle index of each lane
+};
+
+class TriangleMesh : public Hittable {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  TriangleMesh constructor for importers
+    ///
+    /// @detail Buffers are filled in afterwards, either by pointing them at
+    ///         externally owned memory (e.g. a mapped file) or at the
+    ///         *_storage vectors, and then build() is called
+    ///
+    /// @param  m - Material
+    ///////////////////////////////////////////////////////////////////////////
+    TriangleMesh(Material * m);
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  TriangleMesh constructor from owned buffers
+    ///
+    /// @param  v - Vertex positions
+    /// @param  i - Vertex indices, three per triangle
+    /// @param  m - Material
+    /// @param  n - Per-vertex normals (empty = flat shading)
+    ///////////////////////////////////////////////////////////////////////////
+    TriangleMesh(std::vector<vec3> v, std::vector<uint32_t> i, Material * m, std::vector<vec3> n = std::vector<vec3>());
+
+    ~TriangleMesh();
+
+    virtual bool hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
+
+    // (Re)build the bottom-level BVH after the buffers change
+    void build(const BVHBuildOptions & options = BVHBuildOptions());
+
+    // Refit the bottom-level BVH after the vertices move, keeping the same
+    // triangles, or rebuild it if refitting leaves it more than
+    // options.rebuild_threshold worse than when it was built. True if rebuilt
+    bool refit(const BVHBuildOptions & options = BVHBuildOptions());
+
+    inline size_t num_triangles() const { return num_indices / 3; }
+
+    const vec3 * vertices;                  ///< Shared vertex buffer
+    size_t num_vertices;                    ///< Number of vertices
+    const uint32_t * indices;               ///< Index buffer, three per triangle
+    size_t num_indices;                     ///< Number of indices
+    const vec3 * normals;                   ///< Optional per-vertex normals (NULL = flat shading)
+    Material * material;                    ///< Material
+
+    std::vector<vec3> vertex_storage;       ///< Owned vertices, if not borrowed
+    std::vector<uint32_t> index_storage;    ///< Owned indices, if not borrowed
+    std::vector<vec3> normal_storage;       ///< Owned normals, if not borrowed
+    MappedFile * mapping;                   ///< File the buffers may point into, unmapped with the mesh
+
+    std::vector<BVHNode> nodes;             ///< Bottom-level BVH; leaves address packets (empty if compressed)
+    std::vector<QBVHNode> compressed;       ///< Compressed bottom-level BVH (empty if not compressed)
+    AABB root_bounds;                       ///< Bounds of the mesh
+    float built_cost;                       ///< SAH cost of the BVH right after the last build()
+    std::vector<TrianglePacket> packets;    ///< Triangles in leaf order
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Tessellated sphere with smooth normals, mostly for testing
+TriangleMesh * UVSphereMesh(const vec3 & centre, const float radius, const uint32_t segments, const uint32_t rings, Material * m);
+
+#endif//MESH_H
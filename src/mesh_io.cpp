@@ -0,0 +1,731 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mesh_io.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Triangle mesh importers
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include "mesh_io.h"
+#include "scheduler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define PARALLEL_MIN_BYTES (1 << 20)    ///< Files smaller than this are parsed on one thread
+#define OBJ_CHUNKS_PER_THREAD 4         ///< OBJ chunks per thread, for load balance
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct PLYProperty {
+    std::string name;       ///< Property name
+    uint32_t size;          ///< Size in bytes (of the count, for lists)
+    uint32_t item_size;     ///< Size of list items, 0 if not a list
+    bool is_float;          ///< Scalar type is float32
+    uint32_t offset;        ///< Offset in the element record (scalars only)
+};
+
+struct PLYElement {
+    std::string name;                       ///< Element name
+    size_t count;                           ///< Number of records
+    std::vector<PLYProperty> properties;    ///< Properties, in file order
+    uint32_t stride;                        ///< Record size, 0 if it contains lists
+};
+
+struct OBJChunk {
+    const char * begin;     ///< First byte
+    const char * end;       ///< One past the last byte
+    size_t vertices;        ///< 'v' lines
+    size_t normals;         ///< 'vn' lines
+    size_t triangles;       ///< Triangles after fan triangulation
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Run fn(i) for i in [0, n) on the scheduler's threads
+template <typename Function>
+static void ParallelFor(const size_t n, const Function & fn) {
+    Scheduler::Instance().parallel_for(uint32_t(n), [&](const uint32_t i) { fn(size_t(i)); });
+}
+
+// Split [0, n) into contiguous ranges, one per task, sized for 'bytes' of input
+static size_t NumTasks(const size_t n, const size_t bytes) {
+    if ((bytes < PARALLEL_MIN_BYTES) || (n == 0)) {
+        return 1;
+    }
+    return std::min(n, (size_t)Scheduler::Instance().size() * OBJ_CHUNKS_PER_THREAD);
+}
+
+static uint32_t PLYTypeSize(const std::string & type, bool & is_float) {
+    is_float = (type == "float") || (type == "float32");
+
+    if ((type == "char") || (type == "uchar") || (type == "int8") || (type == "uint8")) return 1;
+    if ((type == "short") || (type == "ushort") || (type == "int16") || (type == "uint16")) return 2;
+    if ((type == "int") || (type == "uint") || (type == "int32") || (type == "uint32") || is_float) return 4;
+    if ((type == "double") || (type == "float64")) return 8;
+    return 0;
+}
+
+// Read an unsigned integer of 1, 2 or 4 bytes from an unaligned little-endian address
+static inline uint32_t ReadUnsigned(const uint8_t * p, const uint32_t size) {
+    if (size == 1) {
+        return p[0];
+    } else if (size == 2) {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return v;
+    }
+
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static bool ParsePLYHeader(const MappedFile & file, std::vector<PLYElement> & elements, size_t & data_offset) {
+    const char * text = (const char *)file.data;
+    const char * end = text + file.size;
+    const char * marker = "end_header\n";
+
+    const char * header_end = std::search(text, end, marker, marker + strlen(marker));
+    if ((file.size < 4) || (memcmp(text, "ply\n", 4) != 0) || (header_end == end)) {
+        fprintf(stderr, "Not a PLY file\n");
+        return false;
+    }
+    data_offset = (header_end - text) + strlen(marker);
+
+    std::string header(text, header_end);
+    size_t pos = 0;
+
+    while (pos < header.size()) {
+        size_t eol = header.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = header.size();
+        }
+
+        char word[5][64] = { { 0 } };
+        int32_t n = sscanf(header.substr(pos, eol - pos).c_str(), "%63s %63s %63s %63s %63s", word[0], word[1], word[2], word[3], word[4]);
+        pos = eol + 1;
+
+        if (n <= 0) {
+            continue;
+        }
+
+        if (strcmp(word[0], "format") == 0) {
+            if (strcmp(word[1], "binary_little_endian") != 0) {
+                fprintf(stderr, "Unsupported PLY format '%s' (only binary_little_endian)\n", word[1]);
+                return false;
+            }
+        } else if ((strcmp(word[0], "element") == 0) && (n >= 3)) {
+            PLYElement element;
+            element.name = word[1];
+            element.count = strtoull(word[2], NULL, 10);
+            element.stride = 0;
+            elements.push_back(element);
+        } else if ((strcmp(word[0], "property") == 0) && !elements.empty()) {
+            PLYElement & element = elements.back();
+            PLYProperty property;
+            bool is_float;
+
+            if ((strcmp(word[1], "list") == 0) && (n >= 5)) {
+                property.name = word[4];
+                property.size = PLYTypeSize(word[2], is_float);
+                property.item_size = PLYTypeSize(word[3], is_float);
+                property.is_float = false;
+            } else {
+                property.name = word[2];
+                property.size = PLYTypeSize(word[1], property.is_float);
+                property.item_size = 0;
+            }
+
+            if ((property.size == 0) || (property.size > 8) || (property.item_size > 4) || (property.item_size == 3) ||
+                ((property.item_size != 0) && (property.size > 4))) {
+                fprintf(stderr, "Unsupported PLY property '%s'\n", property.name.c_str());
+                return false;
+            }
+            element.properties.push_back(property);
+        }
+    }
+
+    // Work out fixed record layouts
+    for (size_t e = 0; e < elements.size(); ++e) {
+        uint32_t offset = 0;
+        bool fixed = true;
+
+        for (size_t p = 0; p < elements[e].properties.size(); ++p) {
+            PLYProperty & property = elements[e].properties[p];
+            property.offset = offset;
+            offset += property.size;
+            fixed = fixed && (property.item_size == 0);
+        }
+
+        elements[e].stride = fixed ? offset : 0;
+    }
+
+    return true;
+}
+
+TriangleMesh * LoadPLY(const char * path, Material * m, const BVHBuildOptions & options) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+    fprintf(stderr, "%s: binary PLY import needs a little-endian host\n", path);
+    return NULL;
+#endif
+
+    MappedFile * file = new MappedFile();
+    if (!file->open(path)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        delete file;
+        return NULL;
+    }
+
+    std::vector<PLYElement> elements;
+    size_t offset = 0;
+
+    if (!ParsePLYHeader(*file, elements, offset)) {
+        fprintf(stderr, "%s: bad header\n", path);
+        delete file;
+        return NULL;
+    }
+
+    TriangleMesh * mesh = new TriangleMesh(m);
+    mesh->mapping = file;
+    bool borrowed = false;
+
+    for (size_t e = 0; e < elements.size(); ++e) {
+        const PLYElement & element = elements[e];
+        const uint8_t * data = file->data + offset;
+
+        if (element.name == "vertex") {
+            int32_t xyz[3] = { -1, -1, -1 };
+            int32_t nxyz[3] = { -1, -1, -1 };
+            const char * names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+
+            for (size_t p = 0; p < element.properties.size(); ++p) {
+                for (int32_t k = 0; k < 6; ++k) {
+                    if (element.properties[p].is_float && (element.properties[p].name == names[k])) {
+                        ((k < 3) ? xyz : nxyz)[k % 3] = element.properties[p].offset;
+                    }
+                }
+            }
+
+            if ((element.stride == 0) || (xyz[0] < 0) || (xyz[1] < 0) || (xyz[2] < 0)) {
+                fprintf(stderr, "%s: vertices need fixed-size float x, y, z\n", path);
+                delete mesh;
+                return NULL;
+            }
+
+            if ((offset + (element.count * element.stride)) > file->size) {
+                fprintf(stderr, "%s: truncated vertex data\n", path);
+                delete mesh;
+                return NULL;
+            }
+
+            mesh->num_vertices = element.count;
+
+            // Tightly packed x, y, z at a float-aligned address: use the mapping as is
+            if ((element.stride == sizeof(vec3)) && (xyz[0] == 0) && (xyz[1] == 4) && (xyz[2] == 8) && (((uintptr_t)data % alignof(vec3)) == 0)) {
+                mesh->vertices = (const vec3 *)data;
+                borrowed = true;
+            } else {
+                mesh->vertex_storage.resize(element.count);
+                vec3 * out = mesh->vertex_storage.data();
+                size_t tasks = NumTasks(element.count, element.count * element.stride);
+
+                ParallelFor(tasks, [&](const size_t task) {
+                    for (size_t i = (task * element.count) / tasks; i < ((task + 1) * element.count) / tasks; ++i) {
+                        const uint8_t * record = data + (i * element.stride);
+                        for (int32_t a = 0; a < 3; ++a) {
+                            memcpy(&out[i].e[a], record + xyz[a], sizeof(float));
+                        }
+                    }
+                });
+                mesh->vertices = out;
+            }
+
+            if ((nxyz[0] >= 0) && (nxyz[1] >= 0) && (nxyz[2] >= 0)) {
+                mesh->normal_storage.resize(element.count);
+                vec3 * out = mesh->normal_storage.data();
+                size_t tasks = NumTasks(element.count, element.count * element.stride);
+
+                ParallelFor(tasks, [&](const size_t task) {
+                    for (size_t i = (task * element.count) / tasks; i < ((task + 1) * element.count) / tasks; ++i) {
+                        const uint8_t * record = data + (i * element.stride);
+                        for (int32_t a = 0; a < 3; ++a) {
+                            memcpy(&out[i].e[a], record + nxyz[a], sizeof(float));
+                        }
+                    }
+                });
+                mesh->normals = out;
+            }
+
+            offset += element.count * element.stride;
+        } else if (element.name == "face") {
+            if ((element.properties.size() != 1) || (element.properties[0].item_size == 0)) {
+                fprintf(stderr, "%s: faces must have a single vertex index list\n", path);
+                delete mesh;
+                return NULL;
+            }
+
+            const uint32_t count_size = element.properties[0].size;
+            const uint32_t index_size = element.properties[0].item_size;
+            const size_t triangle_stride = count_size + (3 * index_size);
+            bool all_triangles = (offset + (element.count * triangle_stride)) <= file->size;
+
+            // Optimistically assume a pure triangle mesh, which has fixed-size
+            // records and can be decoded in parallel; check as we go
+            if (all_triangles) {
+                mesh->index_storage.resize(3 * element.count);
+                uint32_t * out = mesh->index_storage.data();
+                size_t tasks = NumTasks(element.count, element.count * triangle_stride);
+                std::atomic<bool> ok(true);
+
+                ParallelFor(tasks, [&](const size_t task) {
+                    for (size_t i = (task * element.count) / tasks; i < ((task + 1) * element.count) / tasks; ++i) {
+                        const uint8_t * record = data + (i * triangle_stride);
+                        if (ReadUnsigned(record, count_size) != 3) {
+                            ok = false;
+                            return;
+                        }
+                        for (int32_t k = 0; k < 3; ++k) {
+                            out[(3 * i) + k] = ReadUnsigned(record + count_size + (k * index_size), index_size);
+                        }
+                    }
+                });
+
+                all_triangles = ok;
+                if (all_triangles) {
+                    offset += element.count * triangle_stride;
+                }
+            }
+
+            // General polygons: variable-size records, so one sequential pass with fan triangulation
+            if (!all_triangles) {
+                mesh->index_storage.clear();
+                for (size_t i = 0; i < element.count; ++i) {
+                    if ((offset + count_size) > file->size) {
+                        fprintf(stderr, "%s: truncated face data\n", path);
+                        delete mesh;
+                        return NULL;
+                    }
+
+                    size_t n = ReadUnsigned(file->data + offset, count_size);
+                    offset += count_size;
+                    if ((offset + (n * index_size)) > file->size) {
+                        fprintf(stderr, "%s: truncated face data\n", path);
+                        delete mesh;
+                        return NULL;
+                    }
+
+                    const uint8_t * list = file->data + offset;
+                    for (size_t k = 2; k < n; ++k) {
+                        mesh->index_storage.push_back(ReadUnsigned(list, index_size));
+                        mesh->index_storage.push_back(ReadUnsigned(list + ((k - 1) * index_size), index_size));
+                        mesh->index_storage.push_back(ReadUnsigned(list + (k * index_size), index_size));
+                    }
+                    offset += n * index_size;
+                }
+            }
+
+            mesh->indices = mesh->index_storage.data();
+            mesh->num_indices = mesh->index_storage.size();
+        } else if (element.stride > 0) {
+            offset += element.count * element.stride;
+        } else {
+            fprintf(stderr, "%s: cannot skip variable-size element '%s'\n", path, element.name.c_str());
+            delete mesh;
+            return NULL;
+        }
+    }
+
+    for (size_t i = 0; i < mesh->num_indices; ++i) {
+        if (mesh->indices[i] >= mesh->num_vertices) {
+            fprintf(stderr, "%s: vertex index %u out of range\n", path, mesh->indices[i]);
+            delete mesh;
+            return NULL;
+        }
+    }
+
+    // Only keep the mapping alive if the mesh still points into it
+    if (!borrowed) {
+        delete mesh->mapping;
+        mesh->mapping = NULL;
+    }
+
+    mesh->build(options);
+    return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OBJ
+///////////////////////////////////////////////////////////////////////////////
+static inline const char * SkipSpaces(const char * p, const char * end) {
+    while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) {
+        ++p;
+    }
+    return p;
+}
+
+static inline const char * NextLine(const char * p, const char * end) {
+    const char * eol = (const char *)memchr(p, '\n', end - p);
+    return (eol == NULL) ? end : eol + 1;
+}
+
+// Bounded decimal parser; the mapping is not NUL-terminated, so strtof can't be used
+static const char * ParseFloat(const char * p, const char * end, float & value) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    int32_t digits = 0;
+    const char * start = p;
+
+    for (; (p < end) && (*p >= '0') && (*p <= '9'); ++p) {
+        if (digits < 19) {
+            mantissa = (mantissa * 10) + (*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            ++exponent;
+        }
+    }
+
+    if ((p < end) && (*p == '.')) {
+        for (++p; (p < end) && (*p >= '0') && (*p <= '9'); ++p) {
+            if (digits < 19) {
+                mantissa = (mantissa * 10) + (*p - '0');
+                digits += (mantissa != 0);
+                --exponent;
+            }
+        }
+    }
+
+    if ((p == start) || ((p == start + 1) && (*start == '.'))) {
+        return NULL;
+    }
+
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        const char * q = p + 1;
+        bool negative_exponent = false;
+        if ((q < end) && ((*q == '-') || (*q == '+'))) {
+            negative_exponent = (*q == '-');
+            ++q;
+        }
+
+        int32_t e = 0;
+        const char * digits_start = q;
+        for (; (q < end) && (*q >= '0') && (*q <= '9'); ++q) {
+            e = std::min((e * 10) + (*q - '0'), 1000);
+        }
+
+        if (q != digits_start) {
+            exponent += negative_exponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double v = (double)mantissa;
+    if ((exponent >= 0) && (exponent <= 22)) {
+        v *= powers[exponent];
+    } else if ((exponent < 0) && (exponent >= -22)) {
+        v /= powers[-exponent];
+    } else {
+        v *= pow(10.0, exponent);
+    }
+
+    value = (float)(negative ? -v : v);
+    return p;
+}
+
+static const char * ParseInt(const char * p, const char * end, int64_t & value) {
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    const char * start = p;
+    int64_t v = 0;
+    for (; (p < end) && (*p >= '0') && (*p <= '9'); ++p) {
+        v = (v * 10) + (*p - '0');
+    }
+
+    if (p == start) {
+        return NULL;
+    }
+
+    value = negative ? -v : v;
+    return p;
+}
+
+// Number of corners on a face line (starting after the 'f')
+static uint32_t CountFaceCorners(const char * p, const char * end) {
+    uint32_t n = 0;
+    while (true) {
+        p = SkipSpaces(p, end);
+        if ((p == end) || (*p == '\n') || (*p == '#')) {
+            return n;
+        }
+        ++n;
+        while ((p < end) && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n')) {
+            ++p;
+        }
+    }
+}
+
+// Pass 1: count what each chunk will write
+static void CountOBJChunk(OBJChunk & chunk) {
+    chunk.vertices = 0;
+    chunk.normals = 0;
+    chunk.triangles = 0;
+
+    for (const char * p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end)) {
+        const char * q = SkipSpaces(p, chunk.end);
+        if ((chunk.end - q) < 2) {
+            continue;
+        }
+
+        if ((q[0] == 'v') && ((q[1] == ' ') || (q[1] == '\t'))) {
+            chunk.vertices++;
+        } else if ((q[0] == 'v') && (q[1] == 'n')) {
+            chunk.normals++;
+        } else if ((q[0] == 'f') && ((q[1] == ' ') || (q[1] == '\t'))) {
+            uint32_t corners = CountFaceCorners(q + 1, chunk.end);
+            chunk.triangles += (corners >= 3) ? (corners - 2) : 0;
+        }
+    }
+}
+
+// Pass 2: parse a chunk into its slice of the final buffers. Returns false on malformed input
+static bool ParseOBJChunk(const OBJChunk & chunk, const size_t vertex_base, const size_t normal_base, const size_t triangle_base,
+                          TriangleMesh & mesh, std::atomic<bool> & normals_match) {
+    vec3 * vertices = mesh.vertex_storage.data() + vertex_base;
+    vec3 * normals = mesh.normal_storage.data() + normal_base;
+    uint32_t * indices = mesh.index_storage.data() + (3 * triangle_base);
+    const int64_t num_vertices = mesh.vertex_storage.size();
+
+    size_t v = 0;
+    size_t vn = 0;
+    size_t t = 0;
+
+    for (const char * p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end)) {
+        const char * end = NextLine(p, chunk.end);
+        const char * q = SkipSpaces(p, end);
+        if ((end - q) < 2) {
+            continue;
+        }
+
+        if ((q[0] == 'v') && ((q[1] == ' ') || (q[1] == '\t') || (q[1] == 'n'))) {
+            bool normal = (q[1] == 'n');
+            vec3 & out = normal ? normals[vn++] : vertices[v++];
+
+            q += normal ? 2 : 1;
+            for (int32_t a = 0; a < 3; ++a) {
+                q = ParseFloat(q, end, out.e[a]);
+                if (q == NULL) {
+                    return false;
+                }
+            }
+        } else if ((q[0] == 'f') && ((q[1] == ' ') || (q[1] == '\t'))) {
+            // Indices are 1-based, or negative relative to the vertices read so far
+            const int64_t vertices_so_far = vertex_base + v;
+            uint32_t first = 0;
+            uint32_t previous = 0;
+            uint32_t corner = 0;
+
+            q += 1;
+            while (true) {
+                q = SkipSpaces(q, end);
+                if ((q == end) || (*q == '\n') || (*q == '#')) {
+                    break;
+                }
+
+                int64_t index;
+                q = ParseInt(q, end, index);
+                if (q == NULL) {
+                    return false;
+                }
+
+                index = (index < 0) ? (vertices_so_far + index) : (index - 1);
+                if ((index < 0) || (index >= num_vertices)) {
+                    return false;
+                }
+
+                // Optional /texcoord and /normal; only the normal index is checked
+                if ((q < end) && (*q == '/')) {
+                    ++q;
+                    int64_t unused;
+                    if ((q < end) && (*q != '/')) {
+                        q = ParseInt(q, end, unused);
+                        if (q == NULL) {
+                            return false;
+                        }
+                    }
+                    if ((q < end) && (*q == '/')) {
+                        ++q;
+                        int64_t normal_index;
+                        q = ParseInt(q, end, normal_index);
+                        if (q == NULL) {
+                            return false;
+                        }
+                        normal_index = (normal_index < 0) ? ((int64_t)(normal_base + vn) + normal_index) : (normal_index - 1);
+                        if (normal_index != index) {
+                            normals_match = false;
+                        }
+                    }
+                }
+
+                // Fan triangulation
+                if (corner == 0) {
+                    first = index;
+                } else if (corner >= 2) {
+                    indices[(3 * t) + 0] = first;
+                    indices[(3 * t) + 1] = previous;
+                    indices[(3 * t) + 2] = index;
+                    ++t;
+                }
+                previous = index;
+                ++corner;
+            }
+        }
+    }
+
+    return true;
+}
+
+TriangleMesh * LoadOBJ(const char * path, Material * m, const BVHBuildOptions & options) {
+    MappedFile file;
+    if (!file.open(path)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    const char * begin = (const char *)file.data;
+    const char * end = begin + file.size;
+
+    // Cut into chunks at line boundaries
+    size_t num_chunks = NumTasks(file.size, file.size);
+    std::vector<OBJChunk> chunks;
+    const char * p = begin;
+
+    for (size_t c = 0; (c < num_chunks) && (p < end); ++c) {
+        const char * target = begin + (((c + 1) * file.size) / num_chunks);
+        const char * chunk_end = (target <= p) ? p : NextLine(target - 1, end);
+
+        if ((c + 1) == num_chunks) {
+            chunk_end = end;
+        }
+
+        OBJChunk chunk;
+        chunk.begin = p;
+        chunk.end = chunk_end;
+        chunks.push_back(chunk);
+        p = chunk_end;
+    }
+
+    ParallelFor(chunks.size(), [&](const size_t c) {
+        CountOBJChunk(chunks[c]);
+    });
+
+    // Exclusive prefix sums give each chunk its output offsets
+    std::vector<size_t> vertex_base(chunks.size());
+    std::vector<size_t> normal_base(chunks.size());
+    std::vector<size_t> triangle_base(chunks.size());
+    size_t num_vertices = 0;
+    size_t num_normals = 0;
+    size_t num_triangles = 0;
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        vertex_base[c] = num_vertices;
+        normal_base[c] = num_normals;
+        triangle_base[c] = num_triangles;
+        num_vertices += chunks[c].vertices;
+        num_normals += chunks[c].normals;
+        num_triangles += chunks[c].triangles;
+    }
+
+    TriangleMesh * mesh = new TriangleMesh(m);
+    mesh->vertex_storage.resize(num_vertices);
+    mesh->normal_storage.resize(num_normals);
+    mesh->index_storage.resize(3 * num_triangles);
+
+    std::atomic<bool> ok(true);
+    std::atomic<bool> normals_match(num_normals == num_vertices);
+
+    ParallelFor(chunks.size(), [&](const size_t c) {
+        if (!ParseOBJChunk(chunks[c], vertex_base[c], normal_base[c], triangle_base[c], *mesh, normals_match)) {
+            ok = false;
+        }
+    });
+
+    if (!ok) {
+        fprintf(stderr, "%s: malformed OBJ\n", path);
+        delete mesh;
+        return NULL;
+    }
+
+    // Per-vertex normals only make sense if every corner uses its vertex's own normal
+    if (!normals_match) {
+        std::vector<vec3>().swap(mesh->normal_storage);
+    }
+
+    mesh->vertices = mesh->vertex_storage.data();
+    mesh->num_vertices = num_vertices;
+    mesh->indices = mesh->index_storage.data();
+    mesh->num_indices = mesh->index_storage.size();
+    mesh->normals = mesh->normal_storage.empty() ? NULL : mesh->normal_storage.data();
+
+    mesh->build(options);
+    return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DISPATCH
+///////////////////////////////////////////////////////////////////////////////
+static bool HasExtension(const char * path, const char * extension) {
+    size_t n = strlen(path);
+    size_t e = strlen(extension);
+    return (n > e) && (strcasecmp(path + n - e, extension) == 0);
+}
+
+bool IsMeshFile(const char * path) {
+    return HasExtension(path, ".ply") || HasExtension(path, ".obj");
+}
+
+TriangleMesh * LoadMesh(const char * path, Material * m, const BVHBuildOptions & options) {
+    if (HasExtension(path, ".ply")) {
+        return LoadPLY(path, m, options);
+    } else if (HasExtension(path, ".obj")) {
+        return LoadOBJ(path, m, options);
+    }
+
+    fprintf(stderr, "%s: unknown mesh format\n", path);
+    return NULL;
+}
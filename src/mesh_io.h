@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: mesh_io.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Triangle mesh importers
+///
+/// @detail Both importers memory-map the file and write straight into the
+///         mesh's final buffers; nothing goes through iostreams or
+///         intermediate arrays.
+///
+///         - PLY (binary little-endian): a vertex element that is exactly
+///           float x, y, z is used in place from the mapping. Other layouts,
+///           normals and faces are decoded in parallel, one copy each.
+///         - OBJ: the file is cut into chunks at line boundaries. One
+///           parallel pass counts each chunk's vertices and triangles; a
+///           second pass parses every chunk straight into its slice of the
+///           final buffers. Polygons are fan-triangulated.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MESH_IO_H
+#define MESH_IO_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "mesh.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Each returns a built mesh, or NULL after printing the reason to stderr
+TriangleMesh * LoadPLY(const char * path, Material * m, const BVHBuildOptions & options = BVHBuildOptions());
+TriangleMesh * LoadOBJ(const char * path, Material * m, const BVHBuildOptions & options = BVHBuildOptions());
+
+// Pick the importer from the file extension (.ply or .obj)
+TriangleMesh * LoadMesh(const char * path, Material * m, const BVHBuildOptions & options = BVHBuildOptions());
+
+// True if the path has an extension LoadMesh() understands
+bool IsMeshFile(const char * path);
+
+#endif//MESH_IO_H
@@ -32,7 +32,7 @@ public:
 
     virtual bool scatter(const Ray & ray, const HitRecord & record, vec3 & attenuation, Ray & scattered) const {
         vec3 reflected = Reflect(unit_vector(ray.direction()), record.normal);
-        scattered = Ray(record.p, reflected + (fuzz * RandomInUnitSphere()));
+        scattered = Ray(record.p, reflected + (fuzz * RandomInUnitSphere()), ray.time());
         attenuation = albedo;
         return (dot(scattered.direction(), record.normal) > 0);
     }
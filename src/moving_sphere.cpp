@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: moving_sphere.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Defines a sphere moving in a straight line over the frame
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "moving_sphere.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+bool MovingSphere::hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const {
+    CountStat(STAT_PRIMITIVE_TESTS);
+    const vec3 c = centre(ray.time());
+    const vec3 oc = ray.origin() - c;
+
+    const float a = dot(ray.direction(), ray.direction());
+    const float b = dot(oc, ray.direction());
+    const float d = dot(oc, oc) - SQUARE(radius);
+    const float discriminant = SQUARE(b) - (a * d);
+    if (discriminant <= 0) {
+        return false;
+    }
+
+    // Nearer root first
+    const float root = sqrt(discriminant);
+    float temp = (-b - root) / a;
+    if (!((temp < t_max) && (temp > t_min))) {
+        temp = (-b + root) / a;
+        if (!((temp < t_max) && (temp > t_min))) {
+            return false;
+        }
+    }
+
+    record.t = temp;
+    record.p = ray.point_at_parameter(record.t);
+    record.normal = (record.p - c) / radius;
+    record.material = material;
+    return true;
+}
+
+bool MovingSphere::bounding_box(AABB & box) const {
+    AABB end;
+    motion_bounds(box, end);
+    box.expand(end);
+    return true;
+}
+
+bool MovingSphere::motion_bounds(AABB & start, AABB & end) const {
+    vec3 r(fabsf(radius), fabsf(radius), fabsf(radius));
+    start = AABB(centre0 - r, centre0 + r);
+    end = AABB(centre1 - r, centre1 + r);
+    return true;
+}
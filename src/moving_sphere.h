@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: moving_sphere.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Defines a sphere moving in a straight line over the frame
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MOVING_SPHERE_H
+#define MOVING_SPHERE_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "hittable.h"
+#include "material.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class MovingSphere: public Hittable {
+public:
+    MovingSphere() {}
+    MovingSphere(vec3 c0, vec3 c1, const float r, Material * m): centre0(c0), centre1(c1), radius(r), material(m) {};
+    virtual bool hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
+    virtual bool motion_bounds(AABB & start, AABB & end) const;
+
+    // Centre at a time within the frame
+    inline vec3 centre(const float time) const { return centre0 + (time * (centre1 - centre0)); }
+
+    vec3 centre0;           ///< Centre at time 0
+    vec3 centre1;           ///< Centre at time 1
+    float radius;           ///< Radius
+    Material * material;    ///< Material
+};
+
+#endif//MOVING_SPHERE_H
@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: numa.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  NUMA topology, thread pinning and memory placement
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define NUMA_MAX_NODES 1024     ///< Bits in a node mask passed to the kernel
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct NumaTopology {
+    std::vector<uint32_t> ids;                  ///< Kernel node number of each node
+    std::vector<std::vector<uint32_t>> cpus;    ///< CPUs of each node this process may use
+    std::vector<uint32_t> allowed;              ///< Every CPU this process could use at startup
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+thread_local uint32_t numa_thread_node = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+#if defined(__linux__)
+
+// Parse a kernel list such as "0-3,8-11"
+static std::vector<uint32_t> ParseList(const std::string & text) {
+    std::vector<uint32_t> values;
+    const char * p = text.c_str();
+
+    while ((*p >= '0') && (*p <= '9')) {
+        char * end;
+        const uint32_t first = strtoul(p, &end, 10);
+        uint32_t last = first;
+        if (*end == '-') {
+            last = strtoul(end + 1, &end, 10);
+        }
+        for (uint32_t v = first; v <= last; ++v) {
+            values.push_back(v);
+        }
+
+        p = (*end == ',') ? (end + 1) : end;
+    }
+    return values;
+}
+
+static std::string ReadLine(const std::string & path) {
+    char line[4096] = "";
+    FILE * file = fopen(path.c_str(), "r");
+    if (file != NULL) {
+        if (fgets(line, sizeof(line), file) == NULL) {
+            line[0] = '\0';
+        }
+        fclose(file);
+    }
+    return line;
+}
+
+static const NumaTopology & Topology() {
+    static NumaTopology * topology = NULL;
+    static std::once_flag once;
+
+    std::call_once(once, []() {
+        topology = new NumaTopology();
+
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (uint32_t cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1U); ++cpu) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                topology->allowed.push_back(cpu);
+            }
+        }
+
+        const std::vector<uint32_t> nodes = ParseList(ReadLine("/sys/devices/system/node/online"));
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const std::string path = "/sys/devices/system/node/node" + std::to_string(nodes[i]) + "/cpulist";
+            std::vector<uint32_t> cpus;
+            const std::vector<uint32_t> listed = ParseList(ReadLine(path));
+            for (size_t k = 0; k < listed.size(); ++k) {
+                if ((listed[k] < CPU_SETSIZE) && CPU_ISSET(listed[k], &allowed)) {
+                    cpus.push_back(listed[k]);
+                }
+            }
+
+            if (!cpus.empty()) {
+                topology->ids.push_back(nodes[i]);
+                topology->cpus.push_back(cpus);
+            }
+        }
+
+        // No sysfs (or no usable node): one node with every allowed CPU
+        if (topology->ids.empty()) {
+            topology->ids.push_back(0);
+            topology->cpus.push_back(topology->allowed);
+        }
+    });
+
+    return *topology;
+}
+
+static bool SetMemoryPolicy(const int mode, const std::vector<uint32_t> & nodes) {
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i] < NUMA_MAX_NODES) {
+            mask[nodes[i] / (8 * sizeof(unsigned long))] |= 1UL << (nodes[i] % (8 * sizeof(unsigned long)));
+        }
+    }
+
+    const bool empty = nodes.empty();
+    return syscall(SYS_set_mempolicy, mode, empty ? NULL : mask, empty ? 0 : NUMA_MAX_NODES) == 0;
+}
+
+uint32_t NumNumaNodes() {
+    return Topology().ids.size();
+}
+
+bool PinThread(const uint32_t slot) {
+    const NumaTopology & topology = Topology();
+    const uint32_t num_nodes = topology.ids.size();
+    const uint32_t node = slot % num_nodes;
+    const std::vector<uint32_t> & cpus = topology.cpus[node];
+    if (cpus.empty()) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(slot / num_nodes) % cpus.size()], &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        return false;
+    }
+
+    numa_thread_node = node;
+    return true;
+}
+
+static void AllowedSet(cpu_set_t & set) {
+    const std::vector<uint32_t> & allowed = Topology().allowed;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < allowed.size(); ++i) {
+        CPU_SET(allowed[i], &set);
+    }
+}
+
+bool UnpinThread() {
+    cpu_set_t set;
+    AllowedSet(set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        return false;
+    }
+
+    numa_thread_node = 0;
+    return true;
+}
+
+bool ThreadUnpinned() {
+    cpu_set_t set;
+    AllowedSet(set);
+    cpu_set_t current;
+    CPU_ZERO(&current);
+    return (sched_getaffinity(0, sizeof(current), &current) == 0) && CPU_EQUAL(&set, &current);
+}
+
+bool InterleaveAllocations(const bool interleave) {
+    const NumaTopology & topology = Topology();
+    if (topology.ids.size() < 2) {
+        return true;
+    }
+
+    if (interleave) {
+        return SetMemoryPolicy(MPOL_INTERLEAVE, topology.ids);
+    }
+    return SetMemoryPolicy(MPOL_DEFAULT, std::vector<uint32_t>());
+}
+
+void RunOnNumaNode(const uint32_t node, const std::function<void()> & fn) {
+    const NumaTopology & topology = Topology();
+
+    // A new thread inherits its creator's affinity and memory policy, so it
+    // sets both before touching anything
+    std::thread thread([&]() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < topology.cpus[node].size(); ++i) {
+            CPU_SET(topology.cpus[node][i], &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+        SetMemoryPolicy(MPOL_PREFERRED, std::vector<uint32_t>(1, topology.ids[node]));
+        numa_thread_node = node;
+        fn();
+    });
+    thread.join();
+}
+
+#else
+
+uint32_t NumNumaNodes() {
+    return 1;
+}
+
+bool PinThread(const uint32_t) {
+    return false;
+}
+
+bool UnpinThread() {
+    return true;
+}
+
+bool ThreadUnpinned() {
+    return true;
+}
+
+bool InterleaveAllocations(const bool) {
+    return true;
+}
+
+void RunOnNumaNode(const uint32_t, const std::function<void()> & fn) {
+    fn();
+}
+
+#endif
+
+std::thread StartHelperThread(const std::function<void()> & fn) {
+    return std::thread([fn]() {
+        UnpinThread();
+        fn();
+    });
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: numa.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  NUMA topology, thread pinning and memory placement
+///
+/// @detail On a multi-socket machine a page lives in the memory of one node,
+///         normally the node of the thread that first wrote to it, and every
+///         other socket pays remote latency to read it. A scene built by the
+///         main thread therefore sits on one node while the render threads
+///         of every node read it for each ray.
+///
+///         The topology comes from /sys/devices/system/node, limited to the
+///         CPUs this process may run on; memory policies are set with the
+///         Linux set_mempolicy system call, so nothing needs libnuma.
+///         Elsewhere, or on a single node, there is one node holding every
+///         CPU and placement does nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef NUMA_H
+#define NUMA_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <functional>
+#include <thread>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum class NumaPlacement {
+    FirstTouch,     ///< Wherever the allocating thread runs (the OS default)
+    Interleave,     ///< Scene pages spread round-robin over the nodes
+    Replicate       ///< Interleaved, plus a copy of the top-level BVH on each node
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+extern thread_local uint32_t numa_thread_node;  ///< Set by PinThread()
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Nodes with CPUs this process may use; at least 1
+uint32_t NumNumaNodes();
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Pin the calling thread to one CPU
+///
+/// @detail Slots alternate between the nodes (slot 0 on node 0, slot 1 on
+///         node 1, ...) so a pool of any size uses every node's memory
+///         bandwidth, and wrap around once every CPU has a thread.
+///
+/// @param  slot - The thread's index in its pool
+///
+/// @return False if the thread could not be pinned
+///////////////////////////////////////////////////////////////////////////////
+bool PinThread(const uint32_t slot);
+
+// Let the calling thread run on every CPU the process could when it started,
+// undoing a PinThread() it inherited from its creator. False if it can't
+bool UnpinThread();
+
+// True if the calling thread may run on every CPU the process could when it
+// started
+bool ThreadUnpinned();
+
+// Start a thread for work beside the render (encoding, checkpoints, stats):
+// a thread inherits its creator's affinity, and the creator may be pinned to
+// the one CPU of pool slot 0, so fn runs unpinned
+std::thread StartHelperThread(const std::function<void()> & fn);
+
+// Index of the node the calling thread is pinned to, 0 if it isn't
+inline uint32_t ThreadNumaNode() { return numa_thread_node; }
+
+// Spread the pages the calling thread allocates from now on over all nodes,
+// or go back to first touch. False if the policy could not be set
+bool InterleaveAllocations(const bool interleave);
+
+// Run fn on a thread on the CPUs of one node, preferring that node's memory,
+// and wait for it: what fn allocates and fills lives on the node
+void RunOnNumaNode(const uint32_t node, const std::function<void()> & fn);
+
+#endif//NUMA_H
@@ -0,0 +1,840 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: options.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Command line options
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "options.h"
+#include "image_io.h"
+#include "mesh_io.h"
+#include "scenes.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+enum LongOption {
+    OPTION_WIDTH = 256,
+    OPTION_HEIGHT,
+    OPTION_SCENE,
+    OPTION_BVH,
+    OPTION_MORTON_BITS,
+    OPTION_TREELET_PASSES,
+    OPTION_LEAF_SIZE,
+    OPTION_BVH_NODES,
+    OPTION_TONEMAP,
+    OPTION_EXPOSURE,
+    OPTION_GAMMA,
+    OPTION_CHECKPOINT,
+    OPTION_CHECKPOINT_INTERVAL,
+    OPTION_RESUME,
+    OPTION_PROGRESSIVE,
+    OPTION_TIME_LIMIT,
+    OPTION_NOISE_THRESHOLD,
+    OPTION_STATS,
+    OPTION_STATS_INTERVAL,
+    OPTION_HEATMAP,
+    OPTION_TRACE,
+    OPTION_PERF_COUNTERS,
+    OPTION_COORDINATE,
+    OPTION_WORKERS,
+    OPTION_TASK_ROWS,
+    OPTION_WORK,
+    OPTION_SAMPLE_RANGE,
+    OPTION_PARTIAL,
+    OPTION_MERGE,
+    OPTION_LOOK_FROM,
+    OPTION_LOOK_AT,
+    OPTION_FOV,
+    OPTION_APERTURE,
+    OPTION_FOCAL_DISTANCE,
+    OPTION_SERVE,
+    OPTION_SUBMIT,
+    OPTION_PIN_THREADS,
+    OPTION_NUMA,
+    OPTION_CROP,
+    OPTION_FRAMES,
+    OPTION_FIRST_FRAME,
+    OPTION_CAMERA_PATH,
+    OPTION_TURNTABLE,
+    OPTION_SHUTTER,
+    OPTION_MATERIAL
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+Options::Options() :
+    width(1200),
+    height(800),
+    crop_left(0),
+    crop_top(0),
+    crop_width(0),
+    crop_height(0),
+    num_samples(80),
+    num_threads(0),
+    pin_threads(false),
+    numa(NumaPlacement::FirstTouch),
+    scene("random"),
+    look_from(13, 2, 3),
+    look_at(0, 0, 0),
+    vertical_fov(20.0),
+    aperture(0.1),
+    focal_distance(10.0),
+    shutter_open(0.0),
+    shutter_close(0.0),
+    num_frames(0),
+    first_frame(0),
+    turntable(false),
+    animation(false),
+    use_bvh(true),
+    progressive(false),
+    time_limit(0.0),
+    noise_threshold(0.0),
+    stats(false),
+    perf_counters(false),
+    stats_interval(0.0),
+    checkpoint_interval(300),
+    resume(false),
+    first_sample(0),
+    workers(0),
+    task_rows(16) {
+}
+
+void PrintUsage(const char * program) {
+    printf("Usage: %s [options]\n", program);
+    printf("\n");
+    printf("Image:\n");
+    printf("  --width <pixels>          Image width (default 1200)\n");
+    printf("  --height <pixels>         Image height (default 800)\n");
+    printf("  -s, --samples <n>         Samples per pixel (default 80)\n");
+    printf("  --crop <x>,<y>,<w>,<h>    Render only the w x h region with its top left\n");
+    printf("                            corner at pixel x,y, exactly as those pixels of\n");
+    printf("                            the whole frame; images and partials hold just the\n");
+    printf("                            region, and --merge pastes it over the frame\n");
+    printf("  -t, --threads <n>         Render threads (default: one per hardware thread)\n");
+    printf("  --pin-threads             Pin each render thread to a CPU, alternating\n");
+    printf("                            between NUMA nodes\n");
+    printf("  --numa <first-touch|interleave|replicate>\n");
+    printf("                            Scene memory: on the node that builds it, spread\n");
+    printf("                            over every node, or spread with a copy of the BVH\n");
+    printf("                            on each node (implies --pin-threads) (default\n");
+    printf("                            first-touch)\n");
+    printf("\n");
+    printf("Output:\n");
+    printf("  -o, --output <file>       Image to write; may be repeated. The extension picks\n");
+    printf("                            the format: .png (tone mapped, 8-bit), or .exr, .pfm\n");
+    printf("                            or .hdr (linear float) (default scene.png)\n");
+    printf("  --tonemap <clamp|reinhard|aces>\n");
+    printf("                            Tone curve for 8-bit outputs (default clamp)\n");
+    printf("  --exposure <stops>        Exposure for 8-bit outputs (default 0)\n");
+    printf("  --gamma <g>               Display gamma for 8-bit outputs (default 2)\n");
+    printf("\n");
+    printf("Progressive rendering:\n");
+    printf("  --progressive             Render passes of 1, 2, 4, ... samples per pixel up\n");
+    printf("                            to --samples, writing the outputs after each pass\n");
+    printf("  --time-limit <seconds>    Stop at this wall-clock time, mid-pass if need be,\n");
+    printf("                            and write what there is (implies --progressive)\n");
+    printf("  --noise-threshold <t>     Stop once the mean relative standard error of the\n");
+    printf("                            pixels is below t, e.g. 0.01 (implies --progressive)\n");
+    printf("\n");
+    printf("Statistics:\n");
+    printf("  --stats                   Print ray counts, Mrays/s, samples/s and time per\n");
+    printf("                            phase when done\n");
+    printf("  --stats-interval <secs>   Also print throughput every <secs> seconds while\n");
+    printf("                            rendering (implies --stats)\n");
+    printf("  --perf-counters           Also report hardware counters per phase (IPC,\n");
+    printf("                            cache misses per 1000 instructions, branch miss\n");
+    printf("                            rate), Linux only (implies --stats)\n");
+    printf("  --heatmap <prefix>        Write the per-sample cost of each pixel: BVH node\n");
+    printf("                            visits, primitive tests, path segments and time,\n");
+    printf("                            to <prefix>-{nodes,tests,segments,time}.{png,pfm}\n");
+    printf("  --trace <file.json>       Record a timeline of scene loading, BVH builds,\n");
+    printf("                            tiles rendered by each thread, encoding and\n");
+    printf("                            checkpoints, for chrome://tracing or Perfetto\n");
+    printf("\n");
+    printf("Checkpointing:\n");
+    printf("  --checkpoint <file>       Save the render in progress to this file\n");
+    printf("                            periodically, on SIGINT/SIGTERM and at the end\n");
+    printf("  --checkpoint-interval <seconds>\n");
+    printf("                            Time between checkpoints (default 300, 0 = only\n");
+    printf("                            on signals and at the end)\n");
+    printf("  --resume                  Continue from the checkpoint file if it exists;\n");
+    printf("                            with more samples than before, adds samples\n");
+    printf("\n");
+    printf("Splitting samples:\n");
+    printf("  --sample-range <first>:<n>\n");
+    printf("                            Render only samples first to first + n - 1 of\n");
+    printf("                            every pixel (replaces --samples)\n");
+    printf("  --partial <file>          Save the pixel sums and counts to <file> when done,\n");
+    printf("                            for --merge; no image is written unless -o is given\n");
+    printf("  --merge <file>...         Sum partial files of disjoint sample ranges of one\n");
+    printf("                            frame into the outputs (and into --partial, if\n");
+    printf("                            the ranges leave no gaps) instead of rendering\n");
+    printf("\n");
+    printf("Distributed rendering:\n");
+    printf("  --coordinate <address>    Hand out bands of rows to worker processes that\n");
+    printf("                            connect to unix:<path> or <host>:<port>\n");
+    printf("  --workers <n>             Start n workers on this machine, splitting the\n");
+    printf("                            threads between them (listens on a Unix socket\n");
+    printf("                            if --coordinate is not given)\n");
+    printf("  --task-rows <n>           Rows in each band handed to a worker (default 16)\n");
+    printf("  --work <address>          Render bands for the coordinator at <address>\n");
+    printf("                            with this machine's -t threads\n");
+    printf("\n");
+    printf("Render server:\n");
+    printf("  --serve <address>         Keep scenes and their BVHs loaded and render the\n");
+    printf("                            jobs sent to unix:<path> or <host>:<port>, one at\n");
+    printf("                            a time with all of this process's threads\n");
+    printf("  --submit <address>        Send this render to a server and show its progress;\n");
+    printf("                            the other options describe the job\n");
+    printf("\n");
+    printf("Scene:\n");
+    printf("  --scene <name>            random, motion (the same scene with its small\n");
+    printf("                            diffuse spheres bouncing; see --shutter),\n");
+    printf("                            instanced (the same scene built from instances\n");
+    printf("                            of one shared sphere), mesh (large spheres as\n");
+    printf("                            triangle meshes), field (40,000 small spheres),\n");
+    printf("                            glass (all glass) or metal (all fuzzy metal)\n");
+    printf("                            (default random), or a .ply/.obj file to render\n");
+    printf("                            on a ground plane\n");
+    printf("\n");
+    printf("Camera:\n");
+    printf("  --look-from <x,y,z>       Camera position (default 13,2,3)\n");
+    printf("  --look-at <x,y,z>         Point the camera looks at (default 0,0,0)\n");
+    printf("  --fov <degrees>           Vertical field of view (default 20)\n");
+    printf("  --aperture <a>            Lens diameter, 0 for a pinhole (default 0.1)\n");
+    printf("  --focal-distance <d>      Distance to the plane in focus (default 10)\n");
+    printf("  --shutter <open>,<close>  Times within the frame, from 0 to 1, between which\n");
+    printf("                            rays are cast, blurring objects that move, e.g.\n");
+    printf("                            0,0.5 (default 0,0: no motion blur)\n");
+    printf("\n");
+    printf("Materials:\n");
+    printf("  --material <x>,<y>:<parameter>=<value>\n");
+    printf("                            Change the material seen through frame pixel x,y\n");
+    printf("                            (from the top left), on every object sharing it:\n");
+    printf("                            albedo=r,g,b (lambertian or metal), fuzz=f (metal)\n");
+    printf("                            or ior=n (dielectric). May be repeated. Jobs sent\n");
+    printf("                            to a server change its loaded scene for just that\n");
+    printf("                            job, with no rebuild\n");
+    printf("\n");
+    printf("Animation:\n");
+    printf("  --frames <n>              Render n frames, loading the scene and building its\n");
+    printf("                            BVH once; a '#' run in each output name is replaced\n");
+    printf("                            by the zero-padded frame number, or _0000 is added\n");
+    printf("                            before the extension (default: to the last key of\n");
+    printf("                            --camera-path)\n");
+    printf("  --first-frame <f>         Number of the first frame (default 0)\n");
+    printf("  --camera-path <file>      Key the camera options at frames, one frame per\n");
+    printf("                            line: <frame> look-from=x,y,z fov=30 ... and move\n");
+    printf("                            through them along a smooth spline\n");
+    printf("  --turntable               Orbit the camera once around the look-at point,\n");
+    printf("                            about the vertical axis, over the frames\n");
+    printf("\n");
+    printf("Acceleration structure:\n");
+    printf("  --bvh <sah|lbvh|none>     BVH builder: SAH (best quality), LBVH (fastest build)\n");
+    printf("                            or none for a brute-force list (default sah)\n");
+    printf("  --morton-bits <30|63>     LBVH Morton code length (default 30)\n");
+    printf("  --treelet-passes <n>      LBVH treelet re-optimization passes (default 0)\n");
+    printf("  --leaf-size <n>           Maximum primitives per BVH leaf (default 4)\n");
+    printf("  --bvh-nodes <standard|compressed>\n");
+    printf("                            Node format: binary with float bounds, or 4-wide\n");
+    printf("                            with 8-bit quantized bounds, about a third of the\n");
+    printf("                            memory (default standard)\n");
+    printf("\n");
+    printf("  --help                    Show this message\n");
+}
+
+// Parse a float argument, rejecting trailing junk and infinities or NaN
+static bool ParseFloat(const char * name, const char * arg, float & value) {
+    char * end = NULL;
+    float v = strtof(arg, &end);
+
+    if ((end == arg) || (*end != '\0') || !isfinite(v)) {
+        fprintf(stderr, "Invalid value for --%s: '%s'\n", name, arg);
+        return false;
+    }
+
+    value = v;
+    return true;
+}
+
+// Parse an unsigned integer argument, rejecting trailing junk, signs (which
+// strtoul would wrap) and values past UINT32_MAX
+static bool ParseUnsigned(const char * name, const char * arg, uint32_t & value) {
+    char * end = NULL;
+    errno = 0;
+    unsigned long v = strtoul(arg, &end, 10);
+
+    if ((*arg < '0') || (*arg > '9') || (*end != '\0') || (errno == ERANGE) || (v > UINT32_MAX)) {
+        fprintf(stderr, "Invalid value for --%s: '%s'\n", name, arg);
+        return false;
+    }
+
+    value = (uint32_t)v;
+    return true;
+}
+
+// Parse "x,y,z"
+static bool ParseVector(const char * name, const char * arg, vec3 & value) {
+    float x, y, z;
+    char end;
+    if ((sscanf(arg, "%f,%f,%f%c", &x, &y, &z, &end) != 3) || !isfinite(x) || !isfinite(y) || !isfinite(z)) {
+        fprintf(stderr, "Invalid value for --%s: '%s' (expected x,y,z)\n", name, arg);
+        return false;
+    }
+
+    value = vec3(x, y, z);
+    return true;
+}
+
+// Parse "<open>,<close>", 0 <= open <= close <= 1
+static bool ParseShutter(const char * arg, Options & options) {
+    float open, close;
+    char end;
+    if (sscanf(arg, "%f,%f%c", &open, &close, &end) != 2) {
+        fprintf(stderr, "Invalid value for --shutter: '%s' (expected <open>,<close>)\n", arg);
+        return false;
+    }
+
+    if (!(open >= 0.0F) || !(open <= close) || !(close <= 1.0F)) {
+        fprintf(stderr, "--shutter times must be in order, from 0 to 1\n");
+        return false;
+    }
+
+    options.shutter_open = open;
+    options.shutter_close = close;
+    return true;
+}
+
+// Parse "<x>,<y>:<parameter>=<value>": albedo=r,g,b (non-negative), fuzz
+// (0 to 1) or ior (positive)
+static bool ParseMaterialEdit(const char * arg, Options & options) {
+    MaterialEdit edit;
+    char name[16];
+    int32_t length = 0;
+    if (sscanf(arg, "%u,%u:%15[a-z]=%n", &edit.x, &edit.y, name, &length) != 3 || (length == 0)) {
+        fprintf(stderr, "Invalid value for --material: '%s' (expected <x>,<y>:<parameter>=<value>)\n", arg);
+        return false;
+    }
+
+    int32_t parameter = 0;
+    while ((parameter < NUM_MATERIAL_PARAMETERS) && (strcmp(name, MaterialParameterName(MaterialParameter(parameter))) != 0)) {
+        ++parameter;
+    }
+    if (parameter == NUM_MATERIAL_PARAMETERS) {
+        fprintf(stderr, "Unknown --material parameter '%s' (expected albedo, fuzz or ior)\n", name);
+        return false;
+    }
+    edit.parameter = MaterialParameter(parameter);
+
+    const char * value = arg + length;
+    float x, y, z;
+    char end;
+    if (edit.parameter == MATERIAL_ALBEDO) {
+        if ((sscanf(value, "%f,%f,%f%c", &x, &y, &z, &end) != 3) || !(x >= 0.0F) || !(y >= 0.0F) || !(z >= 0.0F)) {
+            fprintf(stderr, "Invalid --material albedo: '%s' (expected r,g,b, each 0 or more)\n", value);
+            return false;
+        }
+        edit.value = vec3(x, y, z);
+    } else {
+        if (sscanf(value, "%f%c", &x, &end) != 1) {
+            fprintf(stderr, "Invalid --material %s: '%s'\n", name, value);
+            return false;
+        }
+        if ((edit.parameter == MATERIAL_FUZZ) && !((x >= 0.0F) && (x <= 1.0F))) {
+            fprintf(stderr, "--material fuzz must be from 0 to 1\n");
+            return false;
+        }
+        if ((edit.parameter == MATERIAL_IOR) && !(x > 0.0F)) {
+            fprintf(stderr, "--material ior must be positive\n");
+            return false;
+        }
+        edit.value = vec3(x, 0, 0);
+    }
+
+    options.material_edits.push_back(edit);
+    return true;
+}
+
+// Parse "<x>,<y>,<w>,<h>", w and h non-zero
+static bool ParseCrop(const char * arg, Options & options) {
+    uint32_t values[4];
+    const char * p = arg;
+    for (int32_t i = 0; i < 4; ++i) {
+        char * end = NULL;
+        const unsigned long v = strtoul(p, &end, 10);
+        if ((end == p) || (v > 0xFFFFFFFFUL) || (*end != ((i < 3) ? ',' : '\0'))) {
+            fprintf(stderr, "Invalid value for --crop: '%s' (expected <x>,<y>,<w>,<h>)\n", arg);
+            return false;
+        }
+        values[i] = (uint32_t)v;
+        p = end + 1;
+    }
+
+    if ((values[2] == 0) || (values[3] == 0)) {
+        fprintf(stderr, "--crop width and height must be non-zero\n");
+        return false;
+    }
+
+    options.crop_left = values[0];
+    options.crop_top = values[1];
+    options.crop_width = values[2];
+    options.crop_height = values[3];
+    return true;
+}
+
+static bool ParseSampleRange(const char * arg, uint32_t & first, uint32_t & n) {
+    char * end = NULL;
+    unsigned long f = strtoul(arg, &end, 10);
+    char * count = end + 1;
+    unsigned long c = 0;
+
+    if ((end == arg) || (*end != ':') || ((c = strtoul(count, &end, 10)) == 0) || (end == count) || (*end != '\0') ||
+        (f + c > 0xFFFFFFFFUL)) {
+        fprintf(stderr, "Invalid value for --sample-range: '%s' (expected <first>:<n>)\n", arg);
+        return false;
+    }
+
+    first = (uint32_t)f;
+    n = (uint32_t)c;
+    return true;
+}
+
+bool ParseOptions(int argc, char ** argv, Options & options) {
+    static const struct option long_options[] = {
+        { "width",          required_argument,  NULL, OPTION_WIDTH },
+        { "height",         required_argument,  NULL, OPTION_HEIGHT },
+        { "samples",        required_argument,  NULL, 's' },
+        { "threads",        required_argument,  NULL, 't' },
+        { "pin-threads",    no_argument,        NULL, OPTION_PIN_THREADS },
+        { "numa",           required_argument,  NULL, OPTION_NUMA },
+        { "scene",          required_argument,  NULL, OPTION_SCENE },
+        { "bvh",            required_argument,  NULL, OPTION_BVH },
+        { "morton-bits",    required_argument,  NULL, OPTION_MORTON_BITS },
+        { "treelet-passes", required_argument,  NULL, OPTION_TREELET_PASSES },
+        { "leaf-size",      required_argument,  NULL, OPTION_LEAF_SIZE },
+        { "bvh-nodes",      required_argument,  NULL, OPTION_BVH_NODES },
+        { "output",         required_argument,  NULL, 'o' },
+        { "tonemap",        required_argument,  NULL, OPTION_TONEMAP },
+        { "exposure",       required_argument,  NULL, OPTION_EXPOSURE },
+        { "gamma",          required_argument,  NULL, OPTION_GAMMA },
+        { "progressive",    no_argument,        NULL, OPTION_PROGRESSIVE },
+        { "time-limit",     required_argument,  NULL, OPTION_TIME_LIMIT },
+        { "noise-threshold", required_argument, NULL, OPTION_NOISE_THRESHOLD },
+        { "stats",          no_argument,        NULL, OPTION_STATS },
+        { "stats-interval", required_argument,  NULL, OPTION_STATS_INTERVAL },
+        { "heatmap",        required_argument,  NULL, OPTION_HEATMAP },
+        { "trace",          required_argument,  NULL, OPTION_TRACE },
+        { "perf-counters",  no_argument,        NULL, OPTION_PERF_COUNTERS },
+        { "checkpoint",     required_argument,  NULL, OPTION_CHECKPOINT },
+        { "checkpoint-interval", required_argument, NULL, OPTION_CHECKPOINT_INTERVAL },
+        { "resume",         no_argument,        NULL, OPTION_RESUME },
+        { "coordinate",     required_argument,  NULL, OPTION_COORDINATE },
+        { "workers",        required_argument,  NULL, OPTION_WORKERS },
+        { "task-rows",      required_argument,  NULL, OPTION_TASK_ROWS },
+        { "work",           required_argument,  NULL, OPTION_WORK },
+        { "sample-range",   required_argument,  NULL, OPTION_SAMPLE_RANGE },
+        { "crop",           required_argument,  NULL, OPTION_CROP },
+        { "partial",        required_argument,  NULL, OPTION_PARTIAL },
+        { "merge",          no_argument,        NULL, OPTION_MERGE },
+        { "look-from",      required_argument,  NULL, OPTION_LOOK_FROM },
+        { "look-at",        required_argument,  NULL, OPTION_LOOK_AT },
+        { "fov",            required_argument,  NULL, OPTION_FOV },
+        { "aperture",       required_argument,  NULL, OPTION_APERTURE },
+        { "focal-distance", required_argument,  NULL, OPTION_FOCAL_DISTANCE },
+        { "shutter",        required_argument,  NULL, OPTION_SHUTTER },
+        { "material",       required_argument,  NULL, OPTION_MATERIAL },
+        { "frames",         required_argument,  NULL, OPTION_FRAMES },
+        { "first-frame",    required_argument,  NULL, OPTION_FIRST_FRAME },
+        { "camera-path",    required_argument,  NULL, OPTION_CAMERA_PATH },
+        { "turntable",      no_argument,        NULL, OPTION_TURNTABLE },
+        { "serve",          required_argument,  NULL, OPTION_SERVE },
+        { "submit",         required_argument,  NULL, OPTION_SUBMIT },
+        { "help",           no_argument,        NULL, 'h' },
+        { NULL,             0,                  NULL, 0 }
+    };
+
+    // Start over if called before: a worker parses its job's arguments too
+    optind = 0;
+
+    bool merging = false;
+    int c;
+    while ((c = getopt_long(argc, argv, "s:t:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case OPTION_WIDTH:
+            if (!ParseUnsigned("width", optarg, options.width)) return false;
+            break;
+
+        case OPTION_HEIGHT:
+            if (!ParseUnsigned("height", optarg, options.height)) return false;
+            break;
+
+        case 's':
+            if (!ParseUnsigned("samples", optarg, options.num_samples)) return false;
+            break;
+
+        case OPTION_SCENE:
+            if (!IsBuiltInScene(optarg) && !IsMeshFile(optarg)) {
+                fprintf(stderr, "Unknown scene '%s'\n", optarg);
+                return false;
+            }
+            options.scene = optarg;
+            break;
+
+        case OPTION_BVH:
+            if (strcmp(optarg, "sah") == 0) {
+                options.use_bvh = true;
+                options.bvh.method = BVHBuildMethod::SAH;
+            } else if (strcmp(optarg, "lbvh") == 0) {
+                options.use_bvh = true;
+                options.bvh.method = BVHBuildMethod::LBVH;
+            } else if (strcmp(optarg, "none") == 0) {
+                options.use_bvh = false;
+            } else {
+                fprintf(stderr, "Unknown BVH builder '%s'\n", optarg);
+                return false;
+            }
+            break;
+
+        case OPTION_MORTON_BITS:
+            if (!ParseUnsigned("morton-bits", optarg, options.bvh.morton_bits)) return false;
+            if ((options.bvh.morton_bits != 30) && (options.bvh.morton_bits != 63)) {
+                fprintf(stderr, "--morton-bits must be 30 or 63\n");
+                return false;
+            }
+            break;
+
+        case OPTION_TREELET_PASSES:
+            if (!ParseUnsigned("treelet-passes", optarg, options.bvh.treelet_passes)) return false;
+            break;
+
+        case OPTION_LEAF_SIZE:
+            if (!ParseUnsigned("leaf-size", optarg, options.bvh.max_leaf_size)) return false;
+            break;
+
+        case OPTION_BVH_NODES:
+            if (strcmp(optarg, "standard") == 0) {
+                options.bvh.compress_nodes = false;
+            } else if (strcmp(optarg, "compressed") == 0) {
+                options.bvh.compress_nodes = true;
+            } else {
+                fprintf(stderr, "Unknown BVH node format '%s'\n", optarg);
+                return false;
+            }
+            break;
+
+        case 't':
+            if (!ParseUnsigned("threads", optarg, options.num_threads)) return false;
+            break;
+
+        case OPTION_PIN_THREADS:
+            options.pin_threads = true;
+            break;
+
+        case OPTION_NUMA:
+            if (strcmp(optarg, "first-touch") == 0) {
+                options.numa = NumaPlacement::FirstTouch;
+            } else if (strcmp(optarg, "interleave") == 0) {
+                options.numa = NumaPlacement::Interleave;
+            } else if (strcmp(optarg, "replicate") == 0) {
+                options.numa = NumaPlacement::Replicate;
+                options.pin_threads = true;
+            } else {
+                fprintf(stderr, "Unknown NUMA placement '%s'\n", optarg);
+                return false;
+            }
+            break;
+
+        case 'o':
+            if (!IsImageFile(optarg)) {
+                fprintf(stderr, "Unknown image format '%s'\n", optarg);
+                return false;
+            }
+            options.outputs.push_back(optarg);
+            break;
+
+        case OPTION_TONEMAP:
+            if (strcmp(optarg, "clamp") == 0) {
+                options.tonemap.op = TonemapOperator::Clamp;
+            } else if (strcmp(optarg, "reinhard") == 0) {
+                options.tonemap.op = TonemapOperator::Reinhard;
+            } else if (strcmp(optarg, "aces") == 0) {
+                options.tonemap.op = TonemapOperator::ACES;
+            } else {
+                fprintf(stderr, "Unknown tone curve '%s'\n", optarg);
+                return false;
+            }
+            break;
+
+        case OPTION_EXPOSURE:
+            if (!ParseFloat("exposure", optarg, options.tonemap.exposure)) return false;
+            break;
+
+        case OPTION_GAMMA:
+            if (!ParseFloat("gamma", optarg, options.tonemap.gamma)) return false;
+            if (!(options.tonemap.gamma > 0.0F)) {
+                fprintf(stderr, "--gamma must be positive\n");
+                return false;
+            }
+            break;
+
+        case OPTION_PROGRESSIVE:
+            options.progressive = true;
+            break;
+
+        case OPTION_TIME_LIMIT:
+            if (!ParseFloat("time-limit", optarg, options.time_limit)) return false;
+            options.progressive = true;
+            break;
+
+        case OPTION_NOISE_THRESHOLD:
+            if (!ParseFloat("noise-threshold", optarg, options.noise_threshold)) return false;
+            options.progressive = true;
+            break;
+
+        case OPTION_STATS:
+            options.stats = true;
+            break;
+
+        case OPTION_STATS_INTERVAL:
+            if (!ParseFloat("stats-interval", optarg, options.stats_interval)) return false;
+            options.stats = true;
+            break;
+
+        case OPTION_HEATMAP:
+            options.heatmap = optarg;
+            break;
+
+        case OPTION_PERF_COUNTERS:
+            options.perf_counters = true;
+            options.stats = true;
+            break;
+
+        case OPTION_TRACE:
+            options.trace = optarg;
+            break;
+
+        case OPTION_CHECKPOINT:
+            options.checkpoint = optarg;
+            break;
+
+        case OPTION_CHECKPOINT_INTERVAL:
+            if (!ParseUnsigned("checkpoint-interval", optarg, options.checkpoint_interval)) return false;
+            break;
+
+        case OPTION_RESUME:
+            options.resume = true;
+            break;
+
+        case OPTION_COORDINATE:
+            options.coordinate = optarg;
+            break;
+
+        case OPTION_WORKERS:
+            if (!ParseUnsigned("workers", optarg, options.workers)) return false;
+            break;
+
+        case OPTION_TASK_ROWS:
+            if (!ParseUnsigned("task-rows", optarg, options.task_rows)) return false;
+            if (options.task_rows == 0) {
+                fprintf(stderr, "--task-rows must be non-zero\n");
+                return false;
+            }
+            break;
+
+        case OPTION_WORK:
+            options.work = optarg;
+            break;
+
+        case OPTION_CROP:
+            if (!ParseCrop(optarg, options)) return false;
+            break;
+
+        case OPTION_SAMPLE_RANGE:
+            if (!ParseSampleRange(optarg, options.first_sample, options.num_samples)) return false;
+            break;
+
+        case OPTION_PARTIAL:
+            options.partial = optarg;
+            break;
+
+        case OPTION_MERGE:
+            merging = true;
+            break;
+
+        case OPTION_LOOK_FROM:
+            if (!ParseVector("look-from", optarg, options.look_from)) return false;
+            break;
+
+        case OPTION_LOOK_AT:
+            if (!ParseVector("look-at", optarg, options.look_at)) return false;
+            break;
+
+        case OPTION_FOV:
+            if (!ParseFloat("fov", optarg, options.vertical_fov)) return false;
+            if (!(options.vertical_fov > 0.0F) || !(options.vertical_fov < 180.0F)) {
+                fprintf(stderr, "--fov must be between 0 and 180 degrees\n");
+                return false;
+            }
+            break;
+
+        case OPTION_APERTURE:
+            if (!ParseFloat("aperture", optarg, options.aperture)) return false;
+            if (!(options.aperture >= 0.0F)) {
+                fprintf(stderr, "--aperture must not be negative\n");
+                return false;
+            }
+            break;
+
+        case OPTION_FOCAL_DISTANCE:
+            if (!ParseFloat("focal-distance", optarg, options.focal_distance)) return false;
+            if (!(options.focal_distance > 0.0F)) {
+                fprintf(stderr, "--focal-distance must be positive\n");
+                return false;
+            }
+            break;
+
+        case OPTION_SHUTTER:
+            if (!ParseShutter(optarg, options)) return false;
+            break;
+
+        case OPTION_MATERIAL:
+            if (!ParseMaterialEdit(optarg, options)) return false;
+            break;
+
+        case OPTION_FRAMES:
+            if (!ParseUnsigned("frames", optarg, options.num_frames)) return false;
+            if (options.num_frames == 0) {
+                fprintf(stderr, "--frames must be non-zero\n");
+                return false;
+            }
+            options.animation = true;
+            break;
+
+        case OPTION_FIRST_FRAME:
+            if (!ParseUnsigned("first-frame", optarg, options.first_frame)) return false;
+            options.animation = true;
+            break;
+
+        case OPTION_CAMERA_PATH:
+            options.camera_path = optarg;
+            options.animation = true;
+            break;
+
+        case OPTION_TURNTABLE:
+            options.turntable = true;
+            options.animation = true;
+            break;
+
+        case OPTION_SERVE:
+            options.serve = optarg;
+            break;
+
+        case OPTION_SUBMIT:
+            options.submit = optarg;
+            break;
+
+        case 'h':
+            PrintUsage(argv[0]);
+            return false;
+
+        default:
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if ((options.width == 0) || (options.height == 0) || (options.num_samples == 0)) {
+        fprintf(stderr, "Width, height and samples must be non-zero\n");
+        return false;
+    }
+
+    if ((options.look_from - options.look_at).squared_length() == 0.0F) {
+        fprintf(stderr, "--look-from and --look-at must differ\n");
+        return false;
+    }
+
+    if (options.crop_width == 0) {
+        options.crop_left = 0;
+        options.crop_top = 0;
+        options.crop_width = options.width;
+        options.crop_height = options.height;
+    } else if ((uint64_t(options.crop_left) + options.crop_width > options.width) || (uint64_t(options.crop_top) + options.crop_height > options.height)) {
+        fprintf(stderr, "--crop %u,%u,%u,%u is not inside the %ux%u frame\n", options.crop_left, options.crop_top,
+            options.crop_width, options.crop_height, options.width, options.height);
+        return false;
+    }
+
+    for (size_t i = 0; i < options.material_edits.size(); ++i) {
+        const MaterialEdit & edit = options.material_edits[i];
+        if ((edit.x >= options.width) || (edit.y >= options.height)) {
+            fprintf(stderr, "--material pixel %u,%u is not inside the %ux%u frame\n", edit.x, edit.y, options.width, options.height);
+            return false;
+        }
+    }
+
+    if (options.resume && options.checkpoint.empty()) {
+        fprintf(stderr, "--resume needs --checkpoint\n");
+        return false;
+    }
+
+    // What getopt left over: the files to merge
+    for (int i = optind; i < argc; ++i) {
+        if (!merging) {
+            fprintf(stderr, "Unexpected argument '%s'\n", argv[i]);
+            return false;
+        }
+        options.merge.push_back(argv[i]);
+    }
+
+    if (merging && options.merge.empty()) {
+        fprintf(stderr, "--merge needs the files to merge\n");
+        return false;
+    }
+
+    const bool coordinating = !options.coordinate.empty() || (options.workers > 0);
+    if (coordinating && (options.progressive || !options.checkpoint.empty() || !options.heatmap.empty())) {
+        fprintf(stderr, "--coordinate and --workers can't be used with progressive rendering, checkpoints or heatmaps\n");
+        return false;
+    }
+
+    if (!options.serve.empty() && (coordinating || !options.work.empty() || !options.merge.empty() || !options.submit.empty())) {
+        fprintf(stderr, "--serve can't be used with --coordinate, --workers, --work, --merge or --submit\n");
+        return false;
+    }
+
+    if (options.animation && (options.progressive || !options.checkpoint.empty() || !options.partial.empty() ||
+        !options.heatmap.empty() || coordinating || !options.work.empty() || !options.merge.empty())) {
+        fprintf(stderr, "Animations can't be used with progressive rendering, checkpoints, --partial, heatmaps,\n"
+            "--coordinate, --workers, --work or --merge\n");
+        return false;
+    }
+
+    if (coordinating && !options.work.empty()) {
+        fprintf(stderr, "--work can't be used with --coordinate or --workers\n");
+        return false;
+    }
+
+    if (options.outputs.empty() && options.partial.empty()) {
+        options.outputs.push_back("scene.png");
+    }
+
+    return true;
+}
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: options.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Command line options
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "material_edit.h"
+#include "numa.h"
+#include "tonemap.h"
+#include "vec3.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct Options {
+    Options();
+
+    uint32_t width;             ///< Scene width
+    uint32_t height;            ///< Scene height
+    uint32_t crop_left;         ///< Frame column of the left edge of the region rendered
+    uint32_t crop_top;          ///< Frame row of the top edge of the region rendered
+    uint32_t crop_width;        ///< Width of the region rendered (the whole frame unless --crop)
+    uint32_t crop_height;       ///< Height of the region rendered
+    uint32_t num_samples;       ///< Number of samples over which to average edge colour
+    uint32_t num_threads;       ///< Render threads (0 = one per hardware thread)
+    bool pin_threads;           ///< Pin each render thread to a CPU
+    NumaPlacement numa;         ///< Where the scene's memory goes
+    std::string scene;          ///< Built-in scene name
+    vec3 look_from;             ///< Camera position
+    vec3 look_at;               ///< Point the camera looks at
+    float vertical_fov;         ///< Vertical field of view in degrees
+    float aperture;             ///< Lens diameter (0 = pinhole)
+    float focal_distance;       ///< Distance to the plane in focus
+    float shutter_open;         ///< Time within the frame (0 to 1) the shutter opens
+    float shutter_close;        ///< Time within the frame the shutter closes (= shutter_open: no motion blur)
+    std::vector<MaterialEdit> material_edits;   ///< Changes to the scene's materials, in order
+    uint32_t num_frames;        ///< Animation frames to render (0 = as many as the camera path keys, or 1)
+    uint32_t first_frame;       ///< Number of the first animation frame
+    std::string camera_path;    ///< Keyframed camera path file (empty = none)
+    bool turntable;             ///< Orbit look_from once around look_at over the animation
+    bool animation;             ///< Any of the above was given: render numbered frames
+    bool use_bvh;               ///< Build a BVH over the scene (false = brute-force list)
+    BVHBuildOptions bvh;        ///< BVH build options
+    std::vector<std::string> outputs;   ///< Images to write, format by extension
+    TonemapOptions tonemap;     ///< Tone mapping for 8-bit outputs
+    bool progressive;           ///< Render in passes of doubling sample counts, publishing each
+    float time_limit;           ///< Progressive: stop after this many seconds (0 = no limit)
+    float noise_threshold;      ///< Progressive: stop once Framebuffer::noise() is this low (0 = off)
+    std::string heatmap;        ///< Prefix of per-pixel cost images (empty = none)
+    std::string trace;          ///< Chrome trace JSON file (empty = no tracing)
+    bool stats;                 ///< Print ray statistics and phase times at the end
+    bool perf_counters;         ///< Count cycles, instructions, cache and branch misses per phase
+    float stats_interval;       ///< Seconds between throughput reports (0 = none)
+    std::string checkpoint;     ///< Checkpoint file (empty = no checkpoints)
+    uint32_t checkpoint_interval;   ///< Seconds between checkpoints
+    bool resume;                ///< Continue from the checkpoint file if it exists
+    uint32_t first_sample;      ///< Render samples [first_sample, first_sample + num_samples) of each pixel
+    std::string partial;        ///< File to save the pixel sums and counts to, for merging (empty = none)
+    std::vector<std::string> merge;     ///< Partial files to merge instead of rendering
+    std::string serve;          ///< Address to take render jobs on (empty = render once)
+    std::string submit;         ///< Server address to send this render to (empty = render here)
+    std::string coordinate;     ///< Address to hand out bands of rows on (empty = not distributed)
+    uint32_t workers;           ///< Local worker processes to start as coordinator
+    uint32_t task_rows;         ///< Rows in each band handed to a worker
+    std::string work;           ///< Coordinator address to work for (empty = not a worker)
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Parse the command line
+///
+/// @param  argc - Argument count
+/// @param  argv - Argument vector
+/// @param  options - Options to fill in; unset options keep their defaults
+///
+/// @return False if the program should exit (bad arguments or --help)
+///////////////////////////////////////////////////////////////////////////////
+bool ParseOptions(int argc, char ** argv, Options & options);
+
+void PrintUsage(const char * program);
+
+#endif//OPTIONS_H
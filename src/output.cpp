@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: output.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Asynchronous image output
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <memory>
+#include <stdio.h>
+
+#include "output.h"
+#include "numa.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+OutputPipeline::OutputPipeline() : stopping(false), ok(true) {
+    thread = StartHelperThread([this]() { run(); });
+}
+
+OutputPipeline::~OutputPipeline() {
+    finish();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work.notify_one();
+    thread.join();
+}
+
+bool OutputPipeline::begin_frame(const Framebuffer * framebuffer, const std::vector<std::string> & paths, const TonemapOptions & tonemap) {
+    Frame * frame = new Frame();
+    frame->framebuffer = framebuffer;
+    frame->done.assign(framebuffer->height, 0);
+    frame->next_row = 0;
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ImageStream * stream = OpenImageStream(paths[i].c_str(), framebuffer->width, framebuffer->height, tonemap);
+        if (stream == NULL) {
+            for (size_t k = 0; k < frame->streams.size(); ++k) {
+                delete frame->streams[k];
+            }
+            delete frame;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ok = false;
+            return false;
+        }
+        frame->streams.push_back(stream);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [&]() {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (frames[i]->framebuffer == framebuffer) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    frames.push_back(frame);
+    return true;
+}
+
+void OutputPipeline::row_done(const uint32_t y) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Frame * frame = frames.back();
+        frame->done[y] = 1;
+
+        // Only rows that extend the finished run at the top are any use yet
+        if ((frame != frames.front()) || (y != frame->next_row)) {
+            return;
+        }
+    }
+    work.notify_one();
+}
+
+bool OutputPipeline::finish() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [&]() { return frames.empty(); });
+    return ok;
+}
+
+void OutputPipeline::run() {
+    SetTraceThreadName("encoder");
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        work.wait(lock, [&]() {
+            return stopping || (!frames.empty() && frames.front()->done[frames.front()->next_row]);
+        });
+
+        if (frames.empty()) {
+            return;
+        }
+
+        // Take the run of finished rows, and encode it without the lock held
+        Frame * frame = frames.front();
+        const uint32_t height = frame->framebuffer->height;
+        const uint32_t begin = frame->next_row;
+        uint32_t end = begin;
+        while ((end < height) && frame->done[end]) {
+            ++end;
+        }
+        lock.unlock();
+
+        // Each stream has its own file and encoder state, so they are
+        // encoded side by side
+        ScopedPhase phase(PHASE_ENCODE);
+        const std::thread::id encoder = std::this_thread::get_id();
+        std::vector<char> streams_ok(frame->streams.size());
+        Scheduler::Instance().parallel_for(uint32_t(frame->streams.size()), [&](const uint32_t i) {
+            // This thread's hardware counts are in the phase above
+            std::unique_ptr<PhaseCounters> counters;
+            if (std::this_thread::get_id() != encoder) {
+                counters.reset(new PhaseCounters(PHASE_ENCODE));
+            }
+
+            ImageStream * stream = frame->streams[i];
+            bool stream_ok = stream->write_rows(*frame->framebuffer, begin, end);
+            if (stream_ok && (end == height)) {
+                TraceSpan span("finish", "output");
+                stream_ok = stream->finish();
+            }
+            streams_ok[i] = stream_ok;
+        });
+
+        // A stream that fails is dropped; its error has already been printed
+        bool frame_ok = true;
+        for (size_t i = frame->streams.size(); i-- > 0;) {
+            if (!streams_ok[i] || (end == height)) {
+                delete frame->streams[i];
+                frame->streams.erase(frame->streams.begin() + i);
+                frame_ok = frame_ok && streams_ok[i];
+            }
+        }
+
+        lock.lock();
+        ok = ok && frame_ok;
+        frame->next_row = end;
+
+        if (end == height) {
+            frames.pop_front();
+            delete frame;
+            written.notify_all();
+        }
+    }
+}
+
+std::string NumberedPath(const std::string & path, const uint32_t frame) {
+    const size_t slash = path.find_last_of('/');
+    const size_t name = (slash == std::string::npos) ? 0 : (slash + 1);
+    char number[16];
+
+    const size_t last = path.find_last_of('#');
+    if ((last != std::string::npos) && (last >= name)) {
+        size_t first = last;
+        while ((first > name) && (path[first - 1] == '#')) {
+            --first;
+        }
+        snprintf(number, sizeof(number), "%0*u", int(last + 1 - first), frame);
+        return path.substr(0, first) + number + path.substr(last + 1);
+    }
+
+    size_t dot = path.find_last_of('.');
+    if ((dot == std::string::npos) || (dot < name)) {
+        dot = path.size();
+    }
+    snprintf(number, sizeof(number), "_%04u", frame);
+    return path.substr(0, dot) + number + path.substr(dot);
+}
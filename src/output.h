@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: output.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Asynchronous image output
+///
+/// @detail A background thread encodes finished rows while the render
+///         threads carry on, so when the last row is done only its own
+///         encoding is left. Frames are queued: frame N can still be
+///         encoding while frame N + 1 renders into another framebuffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framebuffer.h"
+#include "image_io.h"
+#include "tonemap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class OutputPipeline {
+public:
+    OutputPipeline();
+    ~OutputPipeline();
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Start writing a frame
+    ///
+    /// @detail Opens the outputs straight away so bad paths are reported
+    ///         before rendering starts. Blocks while an earlier frame still
+    ///         reads from the same framebuffer.
+    ///
+    /// @param  framebuffer - Framebuffer the frame is rendered into; must
+    ///                       stay alive until the frame has been written
+    /// @param  paths - Images to write, format by extension
+    /// @param  tonemap - Tone mapping for 8-bit formats
+    ///
+    /// @return False, with no frame queued, if any output could not be opened
+    ///////////////////////////////////////////////////////////////////////////
+    bool begin_frame(const Framebuffer * framebuffer, const std::vector<std::string> & paths, const TonemapOptions & tonemap);
+
+    // Mark a row of the most recently begun frame as final. Thread-safe
+    void row_done(const uint32_t y);
+
+    // Wait for every queued frame to be written; false if any write failed
+    bool finish();
+
+private:
+    struct Frame {
+        const Framebuffer * framebuffer;        ///< Pixels being written
+        std::vector<ImageStream *> streams;     ///< One per output
+        std::vector<uint8_t> done;              ///< Rows marked final
+        uint32_t next_row;                      ///< First row not yet encoded
+    };
+
+    void run();
+
+    std::thread thread;                 ///< Encoder thread
+    std::mutex mutex;                   ///< Guards everything below
+    std::condition_variable work;       ///< Signalled when rows or frames arrive
+    std::condition_variable written;    ///< Signalled when a frame has been written
+    std::deque<Frame *> frames;         ///< Frames begun but not yet written
+    bool stopping;                      ///< Encoder thread should exit
+    bool ok;                            ///< No write has failed
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Name one frame's image of an animation
+///
+/// @detail The last run of '#' in the file name is replaced by the frame
+///         number, zero-padded to the run's length ("shot_###.png" gives
+///         "shot_007.png"); a name without one gets "_%04u" before its
+///         extension ("shot.png" gives "shot_0007.png").
+///
+/// @param  path - Image path given for the animation
+/// @param  frame - Frame number
+///
+/// @return Path of the frame's image
+///////////////////////////////////////////////////////////////////////////////
+std::string NumberedPath(const std::string & path, const uint32_t frame);
+
+#endif//OUTPUT_H
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: perf_counters.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Hardware performance counters
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+std::atomic<bool> perf_enabled(false);
+
+#if defined(__linux__)
+
+static const uint64_t perf_configs[NUM_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// The counters of the thread that opened it, scheduled onto the PMU together
+// so ratios between them are consistent
+class CounterGroup {
+public:
+    CounterGroup() : error(0) {
+        for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            fds[i] = -1;
+        }
+
+        for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = perf_configs[i];
+            attr.disabled = (i == 0);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // This thread, any CPU, in the leader's group
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : fds[0], PERF_FLAG_FD_CLOEXEC);
+            if (fds[i] < 0) {
+                error = errno;
+                return;
+            }
+        }
+
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~CounterGroup() {
+        for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+    }
+
+    bool read(PerfSample & sample) const {
+        if (error != 0) {
+            return false;
+        }
+
+        // Number of counters, time enabled, time running, then the values
+        uint64_t data[3 + NUM_PERF_COUNTERS];
+        if ((::read(fds[0], data, sizeof(data)) != ssize_t(sizeof(data))) || (data[0] != NUM_PERF_COUNTERS)) {
+            return false;
+        }
+
+        sample.time_enabled = data[1];
+        sample.time_running = data[2];
+        for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            sample.values[i] = data[3 + i];
+        }
+        return true;
+    }
+
+    int fds[NUM_PERF_COUNTERS];     ///< Leader first
+    int error;                      ///< errno of a failed open, 0 if all opened
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static const CounterGroup & LocalGroup() {
+    static thread_local CounterGroup group;
+    return group;
+}
+
+bool StartPerfCounters() {
+    const CounterGroup & group = LocalGroup();
+    if (group.error != 0) {
+        fprintf(stderr, "Hardware counters unavailable: %s (check /proc/sys/kernel/perf_event_paranoid)\n", strerror(group.error));
+        return false;
+    }
+
+    perf_enabled = true;
+    return true;
+}
+
+bool ReadPerfCounters(PerfSample & sample) {
+    return perf_enabled.load(std::memory_order_relaxed) && LocalGroup().read(sample);
+}
+
+#else
+
+bool StartPerfCounters() {
+    fprintf(stderr, "Hardware counters are only supported on Linux\n");
+    return false;
+}
+
+bool ReadPerfCounters(PerfSample &) {
+    return false;
+}
+
+#endif
+
+void PerfCountsBetween(const PerfSample & start, const PerfSample & end, uint64_t counts[NUM_PERF_COUNTERS]) {
+    // Scale the raw deltas by the interval's own enabled/running ratio;
+    // scaling each sample by its lifetime ratio first could make the end
+    // smaller than the start
+    const uint64_t enabled = (end.time_enabled > start.time_enabled) ? (end.time_enabled - start.time_enabled) : 0;
+    const uint64_t running = (end.time_running > start.time_running) ? (end.time_running - start.time_running) : 0;
+    const double scale = (running > 0) ? double(enabled) / double(running) : 0.0;
+    for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+        const uint64_t delta = (end.values[i] > start.values[i]) ? (end.values[i] - start.values[i]) : 0;
+        counts[i] = uint64_t(double(delta) * scale);
+    }
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: perf_counters.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Hardware performance counters
+///
+/// @detail Reads the calling thread's cycles, instructions, last-level cache
+///         misses, branches and branch misses through Linux perf_event_open,
+///         user space only. Each thread opens its own counter group on its
+///         first read and closes it when it exits; counts over an interval
+///         are scaled up if the kernel had to multiplex the group with
+///         other users during it.
+///
+///         Elsewhere, or where the kernel refuses (perf_event_paranoid, no
+///         PMU in a VM), StartPerfCounters() fails and nothing is counted.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <atomic>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum PerfCounter {
+    PERF_CYCLES,                ///< CPU cycles
+    PERF_INSTRUCTIONS,          ///< Instructions retired
+    PERF_CACHE_MISSES,          ///< Last-level cache misses
+    PERF_BRANCHES,              ///< Branch instructions retired
+    PERF_BRANCH_MISSES,         ///< Mispredicted branches
+    NUM_PERF_COUNTERS
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+// Raw counts, to be turned into counts over an interval by PerfCountsBetween()
+struct PerfSample {
+    uint64_t values[NUM_PERF_COUNTERS];     ///< Counts since the thread's group was opened, while it was on the PMU
+    uint64_t time_enabled;                  ///< Nanoseconds the group has been enabled
+    uint64_t time_running;                  ///< Nanoseconds the group has been on the PMU
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+extern std::atomic<bool> perf_enabled;      ///< Set by StartPerfCounters()
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Check the counters can be opened and turn counting on. False after
+// printing the reason to stderr
+bool StartPerfCounters();
+
+// Read the calling thread's counters, opening them on first use. False if
+// counting is off or the thread's counters could not be opened
+bool ReadPerfCounters(PerfSample & sample);
+
+// Counts between two samples of one thread, extrapolated over the time the
+// group was enabled if the kernel only had it on the PMU for part of it
+void PerfCountsBetween(const PerfSample & start, const PerfSample & end, uint64_t counts[NUM_PERF_COUNTERS]);
+
+#endif//PERF_COUNTERS_H
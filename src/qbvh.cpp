@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: qbvh.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Compressed 4-wide bounding volume hierarchy
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+
+#include "bvh.h"
+#include "qbvh.h"
+#include "scheduler.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define QBVH_REFIT_PARALLEL_MIN 1024    ///< Subtrees of at least this many nodes are refit as tasks of their own
+
+static_assert(sizeof(QBVHNode) == 64, "QBVHNode should fill exactly one cache line");
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Smallest power-of-two spacing that spans the extent in 255 steps
+static int32_t GridExponent(const float extent) {
+    int32_t exponent;
+    frexpf(extent / 255.0F, &exponent);
+    return std::min(std::max(exponent, -126), 127);
+}
+
+// Quantize [minimum, maximum] outwards on the grid, checked with the exact
+// arithmetic traversal uses. False if it does not fit in 8 bits
+static bool Quantize(const float origin, const int32_t exponent, const float minimum, const float maximum, uint8_t & lo, uint8_t & hi) {
+    const float scale = QBVHScale(exponent);
+
+    float q_lo = floorf((minimum - origin) / scale);
+    float q_hi = ceilf((maximum - origin) / scale);
+
+    while ((q_lo > 0.0F) && ((origin + (q_lo * scale)) > minimum)) {
+        q_lo -= 1.0F;
+    }
+    while ((q_hi < 255.0F) && ((origin + (q_hi * scale)) < maximum)) {
+        q_hi += 1.0F;
+    }
+
+    if ((q_lo < 0.0F) || (q_hi > 255.0F) || ((origin + (q_lo * scale)) > minimum) || ((origin + (q_hi * scale)) < maximum)) {
+        return false;
+    }
+
+    lo = (uint8_t) q_lo;
+    hi = (uint8_t) q_hi;
+    return true;
+}
+
+// Set a node's corner, grid and quantized child boxes to enclose the boxes
+// of its num_children children
+static void QuantizeChildren(QBVHNode & node, const AABB * boxes) {
+    const uint32_t num_children = node.num_children;
+    AABB bounds;
+    for (uint32_t i = 0; i < num_children; ++i) {
+        bounds.expand(boxes[i]);
+    }
+
+    for (int32_t a = 0; a < 3; ++a) {
+        node.origin[a] = bounds.minimum[a];
+
+        int32_t exponent = GridExponent(bounds.maximum[a] - bounds.minimum[a]);
+        while (true) {
+            bool fits = true;
+            for (uint32_t i = 0; (i < num_children) && fits; ++i) {
+                fits = Quantize(node.origin[a], exponent, boxes[i].minimum[a], boxes[i].maximum[a], node.lo[a][i], node.hi[a][i]);
+            }
+
+            // Rounding can push the top just past 255 steps; coarsen the grid
+            if (fits || (exponent == 127)) {
+                break;
+            }
+            ++exponent;
+        }
+        node.exponent[a] = exponent;
+
+        // Unused slots get an inverted box; they are masked out anyway
+        for (uint32_t i = num_children; i < QBVH_WIDTH; ++i) {
+            node.lo[a][i] = 255;
+            node.hi[a][i] = 0;
+        }
+    }
+}
+
+static uint32_t CompressNode(const std::vector<BVHNode> & nodes, const uint32_t index, std::vector<QBVHNode> & compressed) {
+    // Gather up to four children by repeatedly opening the largest interior one
+    uint32_t children[QBVH_WIDTH];
+    uint32_t num_children = 0;
+
+    if (nodes[index].count > 0) {
+        children[num_children++] = index;
+    } else {
+        children[num_children++] = index + 1;
+        children[num_children++] = nodes[index].offset;
+    }
+
+    while (num_children < QBVH_WIDTH) {
+        int32_t best = -1;
+        float best_area = -1.0;
+        for (uint32_t i = 0; i < num_children; ++i) {
+            const BVHNode & node = nodes[children[i]];
+            if ((node.count == 0) && (node.bounds.surface_area() > best_area)) {
+                best = i;
+                best_area = node.bounds.surface_area();
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        uint32_t opened = children[best];
+        children[best] = opened + 1;
+        children[num_children++] = nodes[opened].offset;
+    }
+
+    AABB boxes[QBVH_WIDTH];
+    for (uint32_t i = 0; i < num_children; ++i) {
+        boxes[i] = nodes[children[i]].bounds;
+    }
+
+    QBVHNode node;
+    memset(&node, 0, sizeof(node));
+    node.num_children = num_children;
+    QuantizeChildren(node, boxes);
+
+    uint32_t compressed_index = compressed.size();
+    compressed.push_back(node);
+
+    for (uint32_t i = 0; i < num_children; ++i) {
+        const BVHNode & child = nodes[children[i]];
+        if (child.count > 0) {
+            compressed[compressed_index].child[i] = child.offset;
+            compressed[compressed_index].count[i] = child.count;
+        } else {
+            uint32_t child_index = CompressNode(nodes, children[i], compressed);
+            compressed[compressed_index].child[i] = child_index;
+            compressed[compressed_index].count[i] = 0;
+        }
+    }
+
+    return compressed_index;
+}
+
+void CompressBVH(const std::vector<BVHNode> & nodes, std::vector<QBVHNode> & compressed) {
+    TraceSpan span("BVH compress", "scene", nodes.size());
+    compressed.clear();
+    if (nodes.empty()) {
+        return;
+    }
+
+    compressed.reserve((nodes.size() / 3) + 1);
+    CompressNode(nodes, 0, compressed);
+}
+
+// Refit the node at index, whose subtree fills [index, end) of the array,
+// and return its box
+static AABB RefitNode(std::vector<QBVHNode> & compressed, const std::vector<AABB> & bounds, const uint32_t index, const uint32_t end) {
+    QBVHNode & node = compressed[index];
+    AABB boxes[QBVH_WIDTH];
+    TaskGroup group;
+
+    // Interior children's subtrees follow the node in child order, each
+    // running up to the next one's
+    for (uint32_t i = 0; i < node.num_children; ++i) {
+        if (node.count[i] > 0) {
+            for (uint32_t k = node.child[i]; k < node.child[i] + node.count[i]; ++k) {
+                boxes[i].expand(bounds[k]);
+            }
+            continue;
+        }
+
+        uint32_t child_end = end;
+        for (uint32_t k = i + 1; k < node.num_children; ++k) {
+            if (node.count[k] == 0) {
+                child_end = node.child[k];
+                break;
+            }
+        }
+
+        const uint32_t child = node.child[i];
+        AABB & box = boxes[i];
+        if (child_end - child >= QBVH_REFIT_PARALLEL_MIN) {
+            group.run([&compressed, &bounds, &box, child, child_end]() { box = RefitNode(compressed, bounds, child, child_end); });
+        } else {
+            box = RefitNode(compressed, bounds, child, child_end);
+        }
+    }
+    group.wait();
+
+    QuantizeChildren(node, boxes);
+
+    AABB box;
+    for (uint32_t i = 0; i < node.num_children; ++i) {
+        box.expand(boxes[i]);
+    }
+    return box;
+}
+
+AABB RefitQBVH(std::vector<QBVHNode> & compressed, const std::vector<AABB> & bounds) {
+    TraceSpan span("BVH refit", "scene", compressed.size());
+    if (compressed.empty()) {
+        return AABB();
+    }
+    return RefitNode(compressed, bounds, 0, compressed.size());
+}
+
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: qbvh.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Compressed 4-wide bounding volume hierarchy
+///
+/// @detail A binary hierarchy is collapsed into nodes of up to four children
+///         whose bounds are stored as 8-bit offsets from the node's corner,
+///         on a power-of-two grid per axis. Quantization always rounds
+///         outwards, so a dequantized child box contains the real one and
+///         traversal can only visit more nodes, never miss a primitive.
+///
+///         A node is one 64-byte cache line and replaces three binary
+///         interior nodes plus the four child boxes (about 1/3 of the
+///         binary node memory overall).
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef QBVH_H
+#define QBVH_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <vector>
+
+#include "aabb.h"
+#include "ray.h"
+#include "simd.h"
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define QBVH_WIDTH 4                    ///< Children per node
+#define QBVH_STACK_SIZE (3 * 64 + 1)    ///< Each of up to BVH_MAX_DEPTH levels leaves at most three siblings behind
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct BVHNode;
+
+// Child bounds on axis a are origin[a] + q * 2^exponent[a], q in [lo, hi]
+struct QBVHNode {
+    float origin[3];                    ///< Minimum corner of the node
+    int8_t exponent[3];                 ///< Grid spacing per axis, as a power of two
+    uint8_t num_children;               ///< Number of used child slots
+    uint8_t lo[3][QBVH_WIDTH];          ///< Quantized child minimum, lo[axis][child]
+    uint8_t hi[3][QBVH_WIDTH];          ///< Quantized child maximum, hi[axis][child]
+    uint32_t child[QBVH_WIDTH];         ///< Interior: node index. Leaf: first primitive
+    uint8_t count[QBVH_WIDTH];          ///< Number of primitives in a leaf child, 0 for interior children
+    uint8_t padding[4];                 ///< Pad to a cache line
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// 2^exponent, built directly from the bits; exponent must be in [-126, 127]
+inline float QBVHScale(const int8_t exponent) {
+    uint32_t bits = (uint32_t) (exponent + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Collapse and quantize a binary hierarchy
+///
+/// @param  nodes - Flattened binary nodes, root first (see BuildBVH())
+/// @param  compressed - Output compressed nodes, root first. Leaves keep the
+///                      primitive ranges of the binary leaves
+///////////////////////////////////////////////////////////////////////////////
+void CompressBVH(const std::vector<BVHNode> & nodes, std::vector<QBVHNode> & compressed);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Refit a compressed hierarchy to moved primitives, keeping its shape
+///
+/// @detail Each node's child boxes are recomputed from the primitives below
+///         and quantized again on a fresh grid, bottom-up, with large
+///         subtrees refit in parallel.
+///
+/// @param  compressed - Compressed nodes, root first
+/// @param  bounds - Box of the primitive in each leaf slot
+///
+/// @return Box of everything
+///////////////////////////////////////////////////////////////////////////////
+AABB RefitQBVH(std::vector<QBVHNode> & compressed, const std::vector<AABB> & bounds);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Closest-hit traversal of a compressed hierarchy
+///
+/// @detail Same contract as TraverseBVH(). All four children of a node are
+///         slab-tested together; hit children are visited nearest first and
+///         skipped on the way back if a closer hit has been found since.
+///////////////////////////////////////////////////////////////////////////////
+template <typename LeafFunction>
+inline bool TraverseQBVH(const QBVHNode * nodes, const Ray & ray, const float t_min, float & t_max, LeafFunction & leaf) {
+    struct Entry {
+        uint32_t index;     ///< Node index, or first primitive
+        uint32_t count;     ///< Number of primitives, 0 for nodes
+        float t;            ///< Entry distance into the child box
+    };
+
+    const float inv[3] = { 1.0F / ray.B.x(), 1.0F / ray.B.y(), 1.0F / ray.B.z() };
+    const float4 origin[3] = { float4(ray.A.x()), float4(ray.A.y()), float4(ray.A.z()) };
+    const float4 inv_direction[3] = { float4(inv[0]), float4(inv[1]), float4(inv[2]) };
+
+    Entry stack[QBVH_STACK_SIZE];
+    uint32_t stack_size = 0;
+    uint32_t visits = 0;
+    bool hit_anything = false;
+
+    stack[stack_size++] = Entry { 0, 0, t_min };
+
+    while (stack_size > 0) {
+        const Entry entry = stack[--stack_size];
+        if (entry.t > t_max) {
+            continue;
+        }
+
+        if (entry.count > 0) {
+            if (leaf(entry.index, entry.count, t_min, t_max)) {
+                hit_anything = true;
+            }
+            continue;
+        }
+
+        const QBVHNode & node = nodes[entry.index];
+        ++visits;
+        float4 t_near(t_min);
+        float4 t_far(t_max);
+
+        for (int32_t a = 0; a < 3; ++a) {
+            const float4 corner(node.origin[a]);
+            const float4 scale(QBVHScale(node.exponent[a]));
+            const float4 lo = corner + (float4::from_bytes(node.lo[a]) * scale);
+            const float4 hi = corner + (float4::from_bytes(node.hi[a]) * scale);
+
+            float4 t0 = ((inv[a] < 0.0F) ? hi - origin[a] : lo - origin[a]) * inv_direction[a];
+            float4 t1 = ((inv[a] < 0.0F) ? lo - origin[a] : hi - origin[a]) * inv_direction[a];
+
+            // Same far-distance widening as AABB::hit(); NaNs go first so they are ignored
+            t1 = t1 * float4(1.00000072F);
+            t_near = max(t0, t_near);
+            t_far = min(t1, t_far);
+        }
+
+        int32_t mask = movemask(t_near <= t_far) & ((1 << node.num_children) - 1);
+        if (mask == 0) {
+            continue;
+        }
+
+        float distances[QBVH_WIDTH];
+        t_near.store(distances);
+
+        // Push far to near so the nearest child is popped first
+        Entry hits[QBVH_WIDTH];
+        uint32_t num_hits = 0;
+        while (mask != 0) {
+            int32_t i = __builtin_ctz(mask);
+            mask &= mask - 1;
+
+            Entry e = { node.child[i], node.count[i], distances[i] };
+            uint32_t j = num_hits++;
+            while ((j > 0) && (hits[j - 1].t < e.t)) {
+                hits[j] = hits[j - 1];
+                --j;
+            }
+            hits[j] = e;
+        }
+
+        for (uint32_t i = 0; i < num_hits; ++i) {
+            stack[stack_size++] = hits[i];
+        }
+    }
+
+    CountStat(STAT_NODE_VISITS, visits);
+    return hit_anything;
+}
+
+#endif//QBVH_H
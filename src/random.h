@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: random.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Random number generation for rendering
+///
+/// @detail drand48() shares one global state, which render threads would
+///         race on. Each thread instead owns a small PCG32 generator, which
+///         the renderer reseeds for every sample of every pixel, so an image
+///         does not depend on how its pixels were spread over threads or its
+///         samples over passes.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// PCG32 (O'Neill, "PCG: A Family of Simple Fast Space-Efficient Statistically
+// Good Algorithms for Random Number Generation")
+class Random {
+public:
+    Random() { seed(0); }
+
+    // Restart the sequence from any 64-bit value
+    inline void seed(const uint64_t s) {
+        state = Mix(s);
+    }
+
+    inline uint32_t next() {
+        uint64_t old = state;
+        state = (old * 6364136223846793005ULL) + 1442695040888963407ULL;
+        uint32_t shifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+        uint32_t rotation = (uint32_t) (old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    // Uniform in [0, 1)
+    inline float uniform() {
+        return (next() >> 8) * (1.0F / 16777216.0F);
+    }
+
+    // SplitMix64 finalizer, to turn nearby seeds into unrelated states
+    static inline uint64_t Mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t state;     ///< Generator state
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// The calling thread's generator
+inline Random & ThreadRandom() {
+    static thread_local Random random;
+    return random;
+}
+
+// Uniform in [0, 1) from the calling thread's generator
+inline float RandomFloat() {
+    return ThreadRandom().uniform();
+}
+
+#endif//RANDOM_H
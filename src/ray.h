@@ -24,14 +24,16 @@
 ///////////////////////////////////////////////////////////////////////////////
 class Ray {
 public:
-    Ray() {}
-    Ray(const vec3 & a, const vec3 & b) : A(a), B(b) {}
+    Ray() : T(0.0F) {}
+    Ray(const vec3 & a, const vec3 & b, const float t = 0.0F) : A(a), B(b), T(t) {}
     vec3 origin() const { return A; }
     vec3 direction() const { return B; }
+    float time() const { return T; }
     vec3 point_at_parameter(const float t) const { return A + (t * B); }
 
     vec3 A;
     vec3 B;
+    float T;    ///< Time within the frame, 0 to 1, at which the ray is cast
 };
 
 #endif//RAY_H
@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: renderer.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Multithreaded frame renderer
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "renderer.h"
+#include "random.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "trace.h"
+#include "utilities.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+// Point d along a Hilbert curve filling a side x side square (side a power of two)
+static void HilbertPoint(const uint32_t side, uint32_t d, uint32_t & x, uint32_t & y) {
+    x = 0;
+    y = 0;
+    for (uint32_t s = 1; s < side; s *= 2) {
+        const uint32_t rx = 1 & (d / 2);
+        const uint32_t ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+}
+
+Renderer::Renderer(const Camera & c, Hittable * w) : camera(c), world(w), seed(0), first_sample(0), deadline(std::chrono::steady_clock::time_point::max()), costs(NULL), cancelled(false) {
+}
+
+bool Renderer::render(Framebuffer & framebuffer, const uint32_t num_samples, const std::function<void(uint32_t)> & row_done) {
+    return render(framebuffer, 0, framebuffer.height, num_samples, row_done);
+}
+
+bool Renderer::render(Framebuffer & framebuffer, const uint32_t row_begin, const uint32_t row_end, const uint32_t num_samples, const std::function<void(uint32_t)> & row_done) {
+    const uint32_t width = framebuffer.width;
+    const uint32_t frame_width = framebuffer.frame_width;
+    const uint32_t frame_height = framebuffer.frame_height;
+    const uint32_t num_rows = row_end - row_begin;
+    const uint32_t tiles_x = (width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    const uint32_t tiles_y = (num_rows + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    const std::thread::id caller = std::this_thread::get_id();
+    ScopedPhase phase(PHASE_RENDER);
+
+    // Tiles in the order a Hilbert curve over the smallest power-of-two
+    // square covering them visits them, so a run of tiles is a compact patch
+    // of the frame rather than a strip
+    uint32_t side = 1;
+    while ((side < tiles_x) || (side < tiles_y)) {
+        side *= 2;
+    }
+    std::vector<uint32_t> order;
+    order.reserve(size_t(tiles_x) * tiles_y);
+    for (uint32_t d = 0; d < side * side; ++d) {
+        uint32_t tx, ty;
+        HilbertPoint(side, d, tx, ty);
+        if ((tx < tiles_x) && (ty < tiles_y)) {
+            order.push_back((ty * tiles_x) + tx);
+        }
+    }
+
+    // A band of rows is done when its last tile is
+    std::unique_ptr<std::atomic<uint32_t>[]> band_tiles(new std::atomic<uint32_t>[tiles_y]);
+    for (uint32_t ty = 0; ty < tiles_y; ++ty) {
+        band_tiles[ty] = tiles_x;
+    }
+    std::atomic<uint32_t> rows_complete(0);
+
+    auto stopped = [&]() {
+        return cancelled || (std::chrono::steady_clock::now() >= deadline);
+    };
+
+    auto render_tile = [&](const uint32_t index) {
+        const uint32_t tile = order[index];
+        const uint32_t tx = tile % tiles_x;
+        const uint32_t ty = tile / tiles_x;
+        const uint32_t x_begin = tx * RENDER_TILE_SIZE;
+        const uint32_t x_end = std::min(x_begin + RENDER_TILE_SIZE, width);
+        const uint32_t y_begin = row_begin + (ty * RENDER_TILE_SIZE);
+        const uint32_t y_end = std::min(y_begin + RENDER_TILE_SIZE, row_end);
+
+        Random & random = ThreadRandom();
+        ThreadStats & stats = LocalStats();
+        TraceSpan span("tile", "render", tile);
+
+        // The calling thread's hardware counts are in render()'s own phase
+        std::unique_ptr<PhaseCounters> counters;
+        if (std::this_thread::get_id() != caller) {
+            counters.reset(new PhaseCounters(PHASE_RENDER));
+        }
+
+        vec3 sums[RENDER_TILE_SIZE];
+        float squares[RENDER_TILE_SIZE];
+        uint32_t counts[RENDER_TILE_SIZE];
+
+        for (uint32_t y = y_begin; y < y_end; ++y) {
+            // Rows are counted from the top, the camera's v from the bottom;
+            // both are the frame's, which a crop is a window of
+            const uint32_t j = frame_height - 1 - (framebuffer.top + y);
+            bool row_complete = true;
+
+            std::fill(counts, counts + RENDER_TILE_SIZE, 0);
+            for (uint32_t i = x_begin; i < x_end; ++i) {
+                if (stopped()) {
+                    row_complete = false;
+                    break;
+                }
+
+                const uint64_t pixel = (uint64_t(y) * width) + i;
+                const uint64_t frame_pixel = (uint64_t(framebuffer.top + y) * frame_width) + framebuffer.left + i;
+                const uint32_t first = std::min(framebuffer.samples[pixel], num_samples);
+
+                // Every sample has its own sequence and carries on from the
+                // pixel's running sums, so splitting a render into passes,
+                // resumes or crops adds up to the same bits as rendering it
+                // in one go. The seed is mixed on its own first, so that
+                // frames seeded f and 0 don't share pixel x ^ f's sequences
+                const uint64_t pixel_seed = Random::Mix(Random::Mix(seed) ^ frame_pixel) + first_sample;
+                vec3 colour = framebuffer.sums[pixel];
+                float colour_squares = framebuffer.squares[pixel];
+
+                // Costs are this thread's counters before and after the pixel
+                uint64_t before[NUM_RAY_STATS];
+                std::chrono::steady_clock::time_point pixel_start;
+                if (costs != NULL) {
+                    for (int32_t k = 0; k < NUM_RAY_STATS; ++k) {
+                        before[k] = stats.counts[k].load(std::memory_order_relaxed);
+                    }
+                    pixel_start = std::chrono::steady_clock::now();
+                }
+
+                // Sample the edge values to perform anti-aliasing
+                for (uint32_t s = first; s < num_samples; ++s) {
+                    random.seed(pixel_seed + s);
+                    float u = float(framebuffer.left + i + random.uniform()) / float(frame_width);
+                    float v = float(j + random.uniform()) / float(frame_height);
+
+                    Ray ray = camera.get_ray(u, v);
+                    vec3 sample = Colour(ray, world, 0);
+                    colour += sample;
+                    colour_squares += Luminance(sample) * Luminance(sample);
+                }
+
+                sums[i - x_begin] = colour;
+                squares[i - x_begin] = colour_squares;
+                counts[i - x_begin] = (first < num_samples) ? num_samples : 0;
+                stats.add(STAT_CAMERA_RAYS, num_samples - first);
+
+                if ((costs != NULL) && (first < num_samples)) {
+                    double c[NUM_PIXEL_COSTS];
+                    c[COST_NANOSECONDS] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - pixel_start).count();
+                    c[COST_NODE_VISITS] = stats.counts[STAT_NODE_VISITS].load(std::memory_order_relaxed) - before[STAT_NODE_VISITS];
+                    c[COST_PRIMITIVE_TESTS] = stats.counts[STAT_PRIMITIVE_TESTS].load(std::memory_order_relaxed) - before[STAT_PRIMITIVE_TESTS];
+                    c[COST_PATH_SEGMENTS] = stats.counts[STAT_CAMERA_RAYS].load(std::memory_order_relaxed) - before[STAT_CAMERA_RAYS] +
+                        stats.counts[STAT_BOUNCE_RAYS].load(std::memory_order_relaxed) - before[STAT_BOUNCE_RAYS];
+                    costs->add(pixel, c, num_samples - first);
+                }
+            }
+
+            // Only this tile writes these pixels; the lock keeps snapshot() from seeing half of them
+            {
+                std::lock_guard<std::mutex> lock(row_locks[y % RENDER_ROW_LOCKS]);
+                for (uint32_t i = x_begin; i < x_end; ++i) {
+                    if (counts[i - x_begin] > 0) {
+                        framebuffer.set(i, y, sums[i - x_begin], squares[i - x_begin], counts[i - x_begin]);
+                    }
+                }
+            }
+
+            if (!row_complete) {
+                return;
+            }
+        }
+
+        if (--band_tiles[ty] == 0) {
+            for (uint32_t y = y_begin; y < y_end; ++y) {
+                ++rows_complete;
+                row_done(y);
+            }
+        }
+    };
+
+    Scheduler::Instance().parallel_for(uint32_t(order.size()), render_tile);
+
+    return rows_complete == num_rows;
+}
+
+void Renderer::cancel() {
+    cancelled = true;
+}
+
+void Renderer::snapshot(const Framebuffer & framebuffer, Framebuffer & copy) {
+    const size_t width = framebuffer.width;
+    copy.width = framebuffer.width;
+    copy.height = framebuffer.height;
+    copy.left = framebuffer.left;
+    copy.top = framebuffer.top;
+    copy.frame_width = framebuffer.frame_width;
+    copy.frame_height = framebuffer.frame_height;
+    copy.sums.resize(framebuffer.sums.size());
+    copy.squares.resize(framebuffer.squares.size());
+    copy.samples.resize(framebuffer.samples.size());
+
+    for (uint32_t y = 0; y < framebuffer.height; ++y) {
+        std::lock_guard<std::mutex> lock(row_locks[y % RENDER_ROW_LOCKS]);
+        std::copy(&framebuffer.sums[y * width], &framebuffer.sums[y * width] + width, &copy.sums[y * width]);
+        std::copy(&framebuffer.squares[y * width], &framebuffer.squares[y * width] + width, &copy.squares[y * width]);
+        std::copy(&framebuffer.samples[y * width], &framebuffer.samples[y * width] + width, &copy.samples[y * width]);
+    }
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: renderer.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Multithreaded frame renderer
+///
+/// @detail The frame is cut into square tiles, taken in Hilbert curve order
+///         and rendered as tasks on the work-stealing scheduler: a thread that
+///         runs out of tiles takes a run of them from a busy one, so threads
+///         stay busy however unevenly the cost is spread over the frame, and
+///         each thread's tiles stay close together on screen. A band of rows
+///         is handed to the output stage once all of its tiles are done.
+///
+///         Each sample's random sequence is seeded from its pixel and its
+///         index, and is added on to the pixel's running sums, so rendering
+///         the samples a pixel is missing gives the same result whether the
+///         frame was rendered in one go, in passes, or resumed. Offsetting
+///         the sample indices renders a later range of the samples instead,
+///         for frames split across jobs by sample range.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "heatmap.h"
+#include "hittable.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define RENDER_ROW_LOCKS 64     ///< Finished row y is stored under lock y % RENDER_ROW_LOCKS
+#define RENDER_TILE_SIZE 16     ///< Tile width and height in pixels
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class Renderer {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Renderer constructor
+    ///
+    /// @param  c - Camera
+    /// @param  w - Scene
+    ///////////////////////////////////////////////////////////////////////////
+    Renderer(const Camera & c, Hittable * w);
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Render a frame
+    ///
+    /// @detail Pixels that already have samples (e.g. from a checkpoint) only
+    ///         get the ones they are missing.
+    ///
+    /// @param  framebuffer - Framebuffer the samples are added to
+    /// @param  num_samples - Samples per pixel to reach
+    /// @param  row_done - Called with each row once it is complete, from the
+    ///                    thread that rendered its last tile
+    ///
+    /// @return False if cancel() or the deadline stopped the frame early, in
+    ///         which case the tiles in progress keep the pixels they finished
+    ///////////////////////////////////////////////////////////////////////////
+    bool render(Framebuffer & framebuffer, const uint32_t num_samples, const std::function<void(uint32_t)> & row_done);
+
+    // Render rows [row_begin, row_end) of a frame only, as render() does
+    bool render(Framebuffer & framebuffer, const uint32_t row_begin, const uint32_t row_end, const uint32_t num_samples, const std::function<void(uint32_t)> & row_done);
+
+    // Stop render() after the pixels in progress. Thread-safe
+    void cancel();
+
+    // Copy a framebuffer being rendered into, without tearing any pixel
+    void snapshot(const Framebuffer & framebuffer, Framebuffer & copy);
+
+    const Camera & camera;      ///< Camera
+    Hittable * world;           ///< Scene
+    uint64_t seed;              ///< Seed for the per-pixel random sequences
+    uint32_t first_sample;      ///< Index of a pixel's first sample, to render only samples [first_sample, first_sample + n)
+    std::chrono::steady_clock::time_point deadline;     ///< render() stops at this time
+    CostMap * costs;            ///< If set, each pixel's costs are added to it (slower)
+
+private:
+    std::atomic<bool> cancelled;                ///< Set by cancel()
+    std::mutex row_locks[RENDER_ROW_LOCKS];     ///< Held while rows are stored or copied
+};
+
+#endif//RENDERER_H
@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: scenes.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Built-in scenes
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "scenes.h"
+#include "options.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "trace.h"
+#include "sphere.h"
+#include "moving_sphere.h"
+#include "instance.h"
+#include "mesh.h"
+#include "mesh_io.h"
+#include "lambertian.h"
+#include "metal.h"
+#include "dielectric.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+// The cover scene, its diffuse spheres moving up by up to half a unit over
+// the frame if moving is set. Both draw the same numbers in the same order
+// up to the motion, so they share a layout
+static HittableList * CoverScene(const bool moving) {
+    int32_t n = 500;
+    Hittable ** list = new Hittable * [n + 1];
+    list[0] =  new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
+    int32_t i = 1;
+    for (int32_t a = -11; a < 11; a++) {
+        for (int32_t b = -11; b < 11; b++) {
+            float material = drand48();
+            vec3 centre(a + 0.9 * drand48(), 0.2, b + 0.9 * drand48()); 
+            if ((centre - vec3(4, 0.2, 0)).length() > 0.9) {
+                // Diffuse 
+                if (material < 0.8) {
+                    Material * diffuse = new Lambertian(vec3(drand48() * drand48(), drand48() * drand48(), drand48() * drand48()));
+                    if (moving) {
+                        list[i++] = new MovingSphere(centre, centre + vec3(0, 0.5 * drand48(), 0), 0.2, diffuse);
+                    } else {
+                        list[i++] = new Sphere(centre, 0.2, diffuse);
+                    }
+                }
+
+                // Metal
+                else if (material < 0.95) {
+                    list[i++] = new Sphere(centre, 0.2,
+                            new Metal(vec3(0.5 * (1 + drand48()), 0.5 * (1 + drand48()), 0.5 * (1 + drand48())),  0.5 * drand48()));
+                }
+                
+                // Glass
+                else {
+                    list[i++] = new Sphere(centre, 0.2, new Dielectric(1.5));
+                }
+            }
+        }
+    }
+
+    list[i++] = new Sphere(vec3(0, 1, 0), 1.0, new Dielectric(1.5));
+    list[i++] = new Sphere(vec3(-4, 1, 0), 1.0, new Lambertian(vec3(0.4, 0.2, 0.1)));
+    list[i++] = new Sphere(vec3(4, 1, 0), 1.0, new Metal(vec3(0.7, 0.6, 0.5), 0.0));
+
+    return new HittableList(list, i);
+}
+
+HittableList * RandomScene() {
+    return CoverScene(false);
+}
+
+HittableList * MotionScene() {
+    return CoverScene(true);
+}
+
+HittableList * InstancedScene() {
+    // Shared object-space geometry; every placement below references it
+    Hittable * unit_sphere = new Sphere(vec3(0, 0, 0), 1.0, NULL);
+
+    int32_t n = 500;
+    Hittable ** list = new Hittable * [n + 1];
+    list[0] = new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
+    int32_t i = 1;
+
+    // Same placements and random sequence as RandomScene()
+    for (int32_t a = -11; a < 11; a++) {
+        for (int32_t b = -11; b < 11; b++) {
+            float material = drand48();
+            vec3 centre(a + 0.9 * drand48(), 0.2, b + 0.9 * drand48());
+            if ((centre - vec3(4, 0.2, 0)).length() > 0.9) {
+                Material * m;
+
+                if (material < 0.8) {
+                    m = new Lambertian(vec3(drand48() * drand48(), drand48() * drand48(), drand48() * drand48()));
+                } else if (material < 0.95) {
+                    m = new Metal(vec3(0.5 * (1 + drand48()), 0.5 * (1 + drand48()), 0.5 * (1 + drand48())),  0.5 * drand48());
+                } else {
+                    m = new Dielectric(1.5);
+                }
+
+                list[i++] = new Instance(unit_sphere, Transform::Translate(centre) * Transform::Scale(0.2), m);
+            }
+        }
+    }
+
+    list[i++] = new Instance(unit_sphere, Transform::Translate(vec3(0, 1, 0)), new Dielectric(1.5));
+    list[i++] = new Instance(unit_sphere, Transform::Translate(vec3(-4, 1, 0)), new Lambertian(vec3(0.4, 0.2, 0.1)));
+    list[i++] = new Instance(unit_sphere, Transform::Translate(vec3(4, 1, 0)), new Metal(vec3(0.7, 0.6, 0.5), 0.0));
+
+    return new HittableList(list, i);
+}
+
+HittableList * MeshScene() {
+    Hittable ** list = new Hittable * [4];
+    list[0] = new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
+    list[1] = UVSphereMesh(vec3(0, 1, 0), 1.0, 64, 32, new Dielectric(1.5));
+    list[2] = UVSphereMesh(vec3(-4, 1, 0), 1.0, 64, 32, new Lambertian(vec3(0.4, 0.2, 0.1)));
+    list[3] = UVSphereMesh(vec3(4, 1, 0), 1.0, 64, 32, new Metal(vec3(0.7, 0.6, 0.5), 0.0));
+
+    return new HittableList(list, 4);
+}
+
+// A sphere of radius 0.2 jittered in each unit cell of a square grid
+// around the origin, keeping clear of the cover scene's metal sphere. Each
+// gets a material from make()
+static HittableList * GridScene(const int32_t half_extent, Material * (*make)()) {
+    const int32_t n = 4 * half_extent * half_extent;
+    Hittable ** list = new Hittable * [n + 4];
+    list[0] = new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
+    int32_t i = 1;
+
+    for (int32_t a = -half_extent; a < half_extent; a++) {
+        for (int32_t b = -half_extent; b < half_extent; b++) {
+            vec3 centre(a + 0.9 * drand48(), 0.2, b + 0.9 * drand48());
+            if ((centre - vec3(4, 0.2, 0)).length() > 0.9) {
+                list[i++] = new Sphere(centre, 0.2, make());
+            }
+        }
+    }
+
+    list[i++] = new Sphere(vec3(0, 1, 0), 1.0, new Dielectric(1.5));
+    list[i++] = new Sphere(vec3(-4, 1, 0), 1.0, new Lambertian(vec3(0.4, 0.2, 0.1)));
+    list[i++] = new Sphere(vec3(4, 1, 0), 1.0, new Metal(vec3(0.7, 0.6, 0.5), 0.0));
+
+    return new HittableList(list, i);
+}
+
+// The cover scene's material mix
+static Material * MixedMaterial() {
+    float material = drand48();
+    if (material < 0.8) {
+        return new Lambertian(vec3(drand48() * drand48(), drand48() * drand48(), drand48() * drand48()));
+    } else if (material < 0.95) {
+        return new Metal(vec3(0.5 * (1 + drand48()), 0.5 * (1 + drand48()), 0.5 * (1 + drand48())),  0.5 * drand48());
+    }
+    return new Dielectric(1.5);
+}
+
+static Material * GlassMaterial() {
+    return new Dielectric(1.3 + (0.5 * drand48()));
+}
+
+static Material * FuzzyMetalMaterial() {
+    return new Metal(vec3(0.5 * (1 + drand48()), 0.5 * (1 + drand48()), 0.5 * (1 + drand48())), 0.2 + (0.8 * drand48()));
+}
+
+HittableList * SphereFieldScene() {
+    return GridScene(100, MixedMaterial);
+}
+
+HittableList * GlassScene() {
+    return GridScene(11, GlassMaterial);
+}
+
+HittableList * MetalScene() {
+    return GridScene(11, FuzzyMetalMaterial);
+}
+
+HittableList * BuiltInScene(const std::string & name) {
+    if (name == "random") {
+        return RandomScene();
+    } else if (name == "motion") {
+        return MotionScene();
+    } else if (name == "instanced") {
+        return InstancedScene();
+    } else if (name == "mesh") {
+        return MeshScene();
+    } else if (name == "field") {
+        return SphereFieldScene();
+    } else if (name == "glass") {
+        return GlassScene();
+    } else if (name == "metal") {
+        return MetalScene();
+    }
+    return NULL;
+}
+
+bool IsBuiltInScene(const std::string & name) {
+    return (name == "random") || (name == "motion") || (name == "instanced") || (name == "mesh") || (name == "field") || (name == "glass") || (name == "metal");
+}
+
+HittableList * MeshFileScene(const char * path, const BVHBuildOptions & options) {
+    TriangleMesh * mesh = LoadMesh(path, new Lambertian(vec3(0.7, 0.3, 0.2)), options);
+    if (mesh == NULL) {
+        return NULL;
+    }
+
+    AABB box;
+    if (!mesh->bounding_box(box)) {
+        fprintf(stderr, "%s: no triangles\n", path);
+        return NULL;
+    }
+
+    // Fit the largest dimension to 2 units, resting on the ground at the origin
+    vec3 extent = box.extent();
+    const float largest = fmax(extent.x(), fmax(extent.y(), extent.z()));
+    if (!(largest > 0) || !isfinite(largest)) {
+        fprintf(stderr, "%s: the mesh has no size to fit to the scene\n", path);
+        return NULL;
+    }
+    float scale = 2.0 / largest;
+    vec3 base(box.centroid().x(), box.minimum.y(), box.centroid().z());
+
+    Hittable ** list = new Hittable * [2];
+    list[0] = new Sphere(vec3(0,-1000,0), 1000, new Lambertian(vec3(0.5, 0.5, 0.5)));
+    list[1] = new Instance(mesh, Transform::Scale(scale) * Transform::Translate(-base));
+
+    return new HittableList(list, 2);
+}
+
+Hittable * BuildWorld(const Options & options) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Threads take on the memory policy of the thread that starts them, so
+    // the pool is started before this one's is changed
+    const bool interleave = (options.numa != NumaPlacement::FirstTouch);
+    if (interleave) {
+        Scheduler::Instance();
+        InterleaveAllocations(true);
+    }
+
+    HittableList * scene;
+    {
+        TraceSpan span("scene load", "scene");
+        if (IsMeshFile(options.scene.c_str())) {
+            scene = MeshFileScene(options.scene.c_str(), options.bvh);
+            if (scene == NULL) {
+                InterleaveAllocations(false);
+                return NULL;
+            }
+        } else {
+            // The random sequence a fresh process starts with
+            unsigned short state[3] = { 0, 0, 0 };
+            seed48(state);
+            scene = BuiltInScene(options.scene);
+        }
+    }
+
+    Hittable * world = scene;
+    if (options.use_bvh) {
+        BVH * bvh = new BVH(scene->list, scene->size, options.bvh);
+        if (options.numa == NumaPlacement::Replicate) {
+            bvh->replicate();
+        }
+        world = bvh;
+    }
+
+    if (interleave) {
+        InterleaveAllocations(false);
+    }
+    AddPhaseTime(PHASE_SCENE, std::chrono::steady_clock::now() - start);
+    return world;
+}
+
+Camera * BuildCamera(const Options & options) {
+    const vec3 vup(0, 1, 0);
+    const float aspect_ratio = float(options.width) / options.height;
+    return new Camera(options.look_from, options.look_at, vup, options.vertical_fov, aspect_ratio, options.aperture, options.focal_distance,
+        options.shutter_open, options.shutter_close);
+}
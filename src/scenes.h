@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: scenes.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Built-in scenes
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SCENES_H
+#define SCENES_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+
+#include "camera.h"
+#include "hittable_list.h"
+#include "bvh.h"
+
+struct Options;
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// The cover scene: a field of small random spheres around three large ones
+HittableList * RandomScene();
+
+// The cover scene with its diffuse spheres moving up by up to half a unit
+// over the frame, for motion blur
+HittableList * MotionScene();
+
+// The cover scene built from instances of one shared unit sphere, each with
+// its own transform and material
+HittableList * InstancedScene();
+
+// The cover scene's three large spheres as tessellated triangle meshes
+HittableList * MeshScene();
+
+// The cover scene's material mix on a 200 x 200 grid: about 40,000 spheres
+HittableList * SphereFieldScene();
+
+// The cover scene's layout with every small sphere glass, of random
+// refractive index
+HittableList * GlassScene();
+
+// The cover scene's layout with every small sphere fuzzy metal
+HittableList * MetalScene();
+
+// One of the scenes above by name: random, motion, instanced, mesh, field, glass or
+// metal. NULL for any other name
+HittableList * BuiltInScene(const std::string & name);
+bool IsBuiltInScene(const std::string & name);
+
+// A mesh file (.ply or .obj) on a ground plane, scaled and moved to sit where
+// the cover scene's centre sphere is. Returns NULL if the file can't be loaded
+HittableList * MeshFileScene(const char * path, const BVHBuildOptions & options);
+
+// The scene options.scene names, built-in or from a mesh file, under a BVH
+// unless options.use_bvh is off. Returns NULL if the file can't be loaded.
+// Built-in scenes come out the same however many have been built before
+Hittable * BuildWorld(const Options & options);
+
+// The camera the options describe, for an options.width x options.height image
+Camera * BuildCamera(const Options & options);
+
+#endif//SCENES_H
@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: scheduler.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Work-stealing task scheduler
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <string>
+
+#include "numa.h"
+#include "scheduler.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+static std::atomic<uint32_t> configured_threads(0);     ///< Thread count for Instance()
+static std::atomic<bool> configured_pinning(false);     ///< Pinning for Instance()
+static thread_local uint32_t queue_index = 0;           ///< The calling thread's queue; 0 if not a worker
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+Scheduler::Scheduler(const uint32_t n, const bool pin) : num_threads(n), pinned(pin), queued(0), sleeping_outside(0), stopping(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    queues.reset(new Queue[num_threads]);
+    for (uint32_t i = 1; i < num_threads; ++i) {
+        threads.push_back(std::thread(&Scheduler::run, this, i));
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
+Scheduler & Scheduler::Instance() {
+    // Never destroyed: workers may still be parked when the process exits
+    static Scheduler * scheduler = new Scheduler(configured_threads.load(), configured_pinning.load());
+    return *scheduler;
+}
+
+void Scheduler::Configure(const uint32_t n, const bool pin) {
+    configured_threads = n;
+    configured_pinning = pin;
+}
+
+void Scheduler::push(Task * task) {
+    Queue & queue = queues[queue_index];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    ++queued;
+
+    // Taking the lock orders this against a thread about to sleep. A thread
+    // outside the pool only takes its own group's tasks, so while one is
+    // asleep waking a single thread could wake it for a task it won't run
+    bool wake_all;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake_all = (sleeping_outside > 0);
+    }
+    if (wake_all) {
+        wake.notify_all();
+    } else {
+        wake.notify_one();
+    }
+}
+
+Scheduler::Task * Scheduler::pop(const TaskGroup * group) {
+    if ((queued.load() == 0) || ((group != NULL) && (group->queued.load() == 0))) {
+        return NULL;
+    }
+
+    // Newest of our own first, then the oldest of everyone else's; of one
+    // group's only, if given
+    for (uint32_t k = 0; k < num_threads; ++k) {
+        const uint32_t victim = (queue_index + k) % num_threads;
+        Queue & queue = queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        Task * task = NULL;
+        if (group == NULL) {
+            if (k == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+        } else if (k == 0) {
+            for (size_t i = queue.tasks.size(); i-- > 0;) {
+                if (queue.tasks[i]->group == group) {
+                    task = queue.tasks[i];
+                    queue.tasks.erase(queue.tasks.begin() + i);
+                    break;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < queue.tasks.size(); ++i) {
+                if (queue.tasks[i]->group == group) {
+                    task = queue.tasks[i];
+                    queue.tasks.erase(queue.tasks.begin() + i);
+                    break;
+                }
+            }
+        }
+
+        if (task == NULL) {
+            continue;
+        }
+        --queued;
+        --task->group->queued;
+        return task;
+    }
+    return NULL;
+}
+
+void Scheduler::execute(Task * task) {
+    task->fn();
+    TaskGroup * group = task->group;
+    delete task;
+
+    if (--group->pending == 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_all();
+    }
+}
+
+void Scheduler::run(const uint32_t index) {
+    queue_index = index;
+    SetTraceThreadName("worker " + std::to_string(index));
+    if (pinned) {
+        PinThread(index);
+    }
+
+    for (;;) {
+        Task * task = pop(NULL);
+        if (task != NULL) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&]() { return stopping || (queued.load() > 0); });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void Scheduler::parallel_for(const uint32_t n, const std::function<void(uint32_t)> & fn, const uint32_t grain) {
+    TaskGroup group(*this);
+    const uint32_t step = std::max(grain, 1U);
+
+    // Leave the upper half for thieves and carry on with the lower half
+    std::function<void(uint32_t, uint32_t)> split = [&](uint32_t begin, uint32_t end) {
+        while (end - begin > step) {
+            const uint32_t middle = begin + ((end - begin) / 2);
+            group.run([&split, middle, end]() { split(middle, end); });
+            end = middle;
+        }
+
+        for (uint32_t i = begin; i < end; ++i) {
+            fn(i);
+        }
+    };
+
+    split(0, n);
+    group.wait();
+}
+
+void TaskGroup::run(const std::function<void()> & fn) {
+    Scheduler::Task * task = new Scheduler::Task();
+    task->fn = fn;
+    task->group = this;
+    ++pending;
+    ++queued;
+    scheduler.push(task);
+}
+
+void TaskGroup::wait() {
+    // Threads outside the pool keep to their own group's tasks
+    const bool outside = (queue_index == 0);
+
+    while (pending.load() > 0) {
+        Scheduler::Task * task = scheduler.pop(outside ? this : NULL);
+        if (task != NULL) {
+            scheduler.execute(task);
+            continue;
+        }
+
+        // Everything left of the group is running elsewhere
+        std::unique_lock<std::mutex> lock(scheduler.sleep_mutex);
+        if (outside) {
+            ++scheduler.sleeping_outside;
+            scheduler.wake.wait(lock, [&]() { return (pending.load() == 0) || (queued.load() > 0); });
+            --scheduler.sleeping_outside;
+        } else {
+            scheduler.wake.wait(lock, [&]() { return (pending.load() == 0) || (scheduler.queued.load() > 0); });
+        }
+    }
+}
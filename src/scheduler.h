@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: scheduler.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Work-stealing task scheduler
+///
+/// @detail One pool of threads for the whole process. Each worker thread has
+///         its own deque: it pushes and pops new tasks at the back, so it
+///         carries on with the work it just split off while it is still in
+///         cache, and idle threads steal from the front, where the oldest
+///         and largest pieces of work are. Threads that aren't workers (main,
+///         the encoder, a server's job thread) share one more deque.
+///
+///         A thread waiting on a TaskGroup runs tasks until the group is done
+///         rather than blocking, so groups can nest (a BVH subtree build
+///         splitting into more subtree builds) without tying up threads, and
+///         the waiting thread counts as one of the pool's threads. A worker
+///         runs any task while it waits; a thread outside the pool only runs
+///         its own group's, so the encoder never ends up rendering a tile
+///         and the main thread never ends up encoding.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class TaskGroup;
+
+class Scheduler {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Scheduler constructor; starts n - 1 worker threads, the
+    ///         waiting thread being the nth
+    ///
+    /// @param  n - Threads (0 = one per hardware thread)
+    /// @param  pin - Pin worker i with PinThread(i), leaving slot 0 to the
+    ///               waiting thread
+    ///////////////////////////////////////////////////////////////////////////
+    Scheduler(const uint32_t n, const bool pin);
+    ~Scheduler();
+
+    // The process's scheduler, created on first use with the settings last
+    // passed to Configure()
+    static Scheduler & Instance();
+
+    // Set the thread count and pinning of Instance(); has no effect once it
+    // exists
+    static void Configure(const uint32_t n, const bool pin);
+
+    // Threads working on a group, counting the one waiting on it
+    uint32_t size() const { return num_threads; }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  Run fn(i) for every i in [0, n) and wait for them all
+    ///
+    /// @detail The range is split in halves, the upper half left for other
+    ///         threads to steal, until pieces are down to grain indices, so
+    ///         each thread works through contiguous runs of indices.
+    ///
+    /// @param  n - Number of indices
+    /// @param  fn - Called once per index, from any thread
+    /// @param  grain - Indices run as one task
+    ///////////////////////////////////////////////////////////////////////////
+    void parallel_for(const uint32_t n, const std::function<void(uint32_t)> & fn, const uint32_t grain = 1);
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> fn;       ///< Work
+        TaskGroup * group;              ///< Group told when it's done
+    };
+
+    // A thread's tasks; the owner works at the back, thieves at the front
+    struct Queue {
+        std::mutex mutex;               ///< Guards tasks
+        std::deque<Task *> tasks;       ///< Pending tasks
+    };
+
+    void push(Task * task);
+    Task * pop(const TaskGroup * group);
+    void execute(Task * task);
+    void run(const uint32_t index);
+
+    uint32_t num_threads;                   ///< Workers plus the waiting thread
+    bool pinned;                            ///< Workers are pinned to CPUs
+    std::unique_ptr<Queue[]> queues;        ///< Queue 0 is shared by non-worker threads
+    std::vector<std::thread> threads;       ///< Workers 1 to num_threads - 1
+    std::atomic<uint32_t> queued;           ///< Tasks in all queues
+    std::mutex sleep_mutex;                 ///< Guards sleeping
+    std::condition_variable wake;           ///< Signalled on new tasks, finished groups and stopping
+    uint32_t sleeping_outside;              ///< Threads outside the pool asleep in TaskGroup::wait(), guarded by sleep_mutex
+    bool stopping;                          ///< Workers should exit
+};
+
+// Tasks that can be waited on together
+class TaskGroup {
+public:
+    explicit TaskGroup(Scheduler & s = Scheduler::Instance()) : scheduler(s), pending(0), queued(0) {}
+    ~TaskGroup() { wait(); }
+
+    // Queue fn on the calling thread's deque
+    void run(const std::function<void()> & fn);
+
+    // Run tasks until every task of this group has finished: any group's on
+    // a worker, only this group's on a thread outside the pool
+    void wait();
+
+private:
+    friend class Scheduler;
+
+    Scheduler & scheduler;                  ///< Scheduler running the tasks
+    std::atomic<uint32_t> pending;          ///< Tasks queued or running
+    std::atomic<uint32_t> queued;           ///< Tasks not yet taken by a thread
+};
+
+#endif//SCHEDULER_H
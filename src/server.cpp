@@ -0,0 +1,409 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: server.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Render server
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "checkpoint.h"
+#include "framebuffer.h"
+#include "heatmap.h"
+#include "material_edit.h"
+#include "mesh_io.h"
+#include "numa.h"
+#include "output.h"
+#include "renderer.h"
+#include "scenes.h"
+#include "socket_io.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+///////////////////////////////////////////////////////////////////////////////
+static const size_t MAX_REQUEST_BYTES = 65536;          ///< Longest request line
+static const uint32_t REQUEST_TIMEOUT_S = 10;           ///< Time a client has to send its request
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct Job {
+    uint32_t id;                ///< Job number, from 1
+    int fd;                     ///< Client connection
+    Options options;            ///< What to render
+};
+
+// Jobs waiting for the render thread
+struct JobQueue {
+    std::mutex mutex;                       ///< Guards jobs
+    std::condition_variable added;          ///< Signalled when a job is queued
+    std::deque<Job *> jobs;                 ///< Oldest first
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static std::string Resolve(const std::string & directory, const std::string & path) {
+    if (path.empty() || (path[0] == '/') || directory.empty()) {
+        return path;
+    }
+    return directory + "/" + path;
+}
+
+// Everything a built scene depends on
+static std::string SceneKey(const Options & options) {
+    char text[128];
+    snprintf(text, sizeof(text), "|%d|%d|%u|%u|%u|%d|%d", int(options.use_bvh), int(options.bvh.method), options.bvh.max_leaf_size,
+        options.bvh.morton_bits, options.bvh.treelet_passes, int(options.bvh.compress_nodes), int(options.numa));
+    return options.scene + text;
+}
+
+// Whether a client has closed its connection. Clients send nothing after
+// their request, so the end of their stream means they have left
+static bool ClientGone(const int fd) {
+    struct pollfd p = { fd, POLLRDHUP, 0 };
+    return (poll(&p, 1, 0) > 0) && ((p.revents & (POLLRDHUP | POLLHUP | POLLERR)) != 0);
+}
+
+static bool SendLine(const int fd, const char * format, ...) __attribute__((format(printf, 2, 3)));
+static bool SendLine(const int fd, const char * format, ...) {
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    return SendText(fd, std::string(line) + "\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Parse a request line into a job
+///
+/// @param  request - Tab-separated directory and arguments
+/// @param  options - Filled in from the arguments
+/// @param  error - Set to the reason on failure
+///
+/// @return False if the job is malformed or asks for something a server
+///         can't do
+///////////////////////////////////////////////////////////////////////////////
+static bool ParseJob(const std::string & request, Options & options, std::string & error) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (size_t tab; (tab = request.find('\t', start)) != std::string::npos; start = tab + 1) {
+        fields.push_back(request.substr(start, tab - start));
+    }
+    fields.push_back(request.substr(start));
+
+    const std::string directory = fields[0];
+    fields[0] = "ray";
+    std::vector<char *> argv;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        argv.push_back(&fields[i][0]);
+    }
+    argv.push_back(NULL);
+
+    // Parse errors go to the server's stderr; the client just hears that it failed
+    if (!ParseOptions(int(fields.size()), argv.data(), options)) {
+        error = "bad arguments";
+        return false;
+    }
+
+    if (options.progressive || !options.checkpoint.empty() || !options.trace.empty() || options.perf_counters ||
+        !options.coordinate.empty() || (options.workers > 0) || !options.work.empty() || !options.merge.empty() || !options.serve.empty() ||
+        options.animation) {
+        error = "jobs can't use progressive rendering, checkpoints, tracing, counters, distribution, animation, --merge or --serve";
+        return false;
+    }
+
+    for (size_t i = 0; i < options.outputs.size(); ++i) {
+        options.outputs[i] = Resolve(directory, options.outputs[i]);
+    }
+    options.partial = Resolve(directory, options.partial);
+    options.heatmap = Resolve(directory, options.heatmap);
+    if (IsMeshFile(options.scene.c_str())) {
+        options.scene = Resolve(directory, options.scene);
+    }
+    return true;
+}
+
+// Render one job, reporting to its client. Scenes are built on first use
+// and kept; a job's material edits change the kept scene only until it ends.
+// A job whose client has left is skipped, or cancelled once it notices
+static void RunJob(Job & job, std::map<std::string, Hittable *> & scenes) {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    const Options & options = job.options;
+    if (ClientGone(job.fd)) {
+        fprintf(stderr, "Job %u: client left, skipped\n", job.id);
+        return;
+    }
+    SendLine(job.fd, "started %u", job.id);
+
+    const std::string key = SceneKey(options);
+    std::map<std::string, Hittable *>::iterator scene = scenes.find(key);
+    if (scene == scenes.end()) {
+        Hittable * world = BuildWorld(options);
+        if (world == NULL) {
+            SendLine(job.fd, "failed %u cannot load scene %s", job.id, options.scene.c_str());
+            return;
+        }
+        scene = scenes.insert(std::make_pair(key, world)).first;
+        fprintf(stderr, "Job %u: built %s in %.2f s\n", job.id, options.scene.c_str(), std::chrono::duration<float>(Clock::now() - start).count());
+    }
+
+    Camera * camera = BuildCamera(options);
+    std::vector<MaterialUndo> undo;
+    std::string error;
+    if (!ApplyMaterialEdits(options.material_edits, *scene->second, *camera, options.width, options.height, &undo, error)) {
+        SendLine(job.fd, "failed %u %s", job.id, error.c_str());
+        delete camera;
+        return;
+    }
+
+    Renderer renderer(*camera, scene->second);
+    renderer.first_sample = options.first_sample;
+
+    CostMap * costs = NULL;
+    if (!options.heatmap.empty()) {
+        costs = new CostMap(options.crop_width, options.crop_height);
+        renderer.costs = costs;
+    }
+
+    Framebuffer framebuffer(options.crop_width, options.crop_height, options.crop_left, options.crop_top, options.width, options.height);
+    OutputPipeline output;
+    bool ok = output.begin_frame(&framebuffer, options.outputs, options.tonemap);
+    bool complete = false;
+
+    if (ok) {
+        // Progress goes out from the render threads, once per whole percent
+        std::mutex sending;
+        std::vector<uint8_t> finished(framebuffer.height, 0);
+        uint32_t rows = 0;
+        uint32_t reported = 0;
+        complete = renderer.render(framebuffer, options.num_samples, [&](const uint32_t y) {
+            finished[y] = 1;
+            output.row_done(y);
+            if (ClientGone(job.fd)) {
+                renderer.cancel();
+            }
+
+            std::lock_guard<std::mutex> lock(sending);
+            const uint32_t percent = (++rows * 100) / framebuffer.height;
+            if (percent > reported) {
+                reported = percent;
+                if (!SendLine(job.fd, "progress %u %u", job.id, percent)) {
+                    renderer.cancel();
+                }
+            }
+        });
+
+        // Rows a cancelled render didn't reach still have to be written
+        if (!complete) {
+            for (uint32_t y = 0; y < framebuffer.height; ++y) {
+                if (!finished[y]) {
+                    output.row_done(y);
+                }
+            }
+        }
+    }
+
+    ok = output.finish() && ok && complete;
+    if (ok && !options.partial.empty()) {
+        ok = SaveCheckpoint(options.partial.c_str(), framebuffer, renderer.seed, renderer.first_sample);
+    }
+    if (ok && (costs != NULL)) {
+        ok = WriteHeatmaps(options.heatmap, *costs);
+    }
+    delete costs;
+    delete camera;
+    UndoMaterialEdits(undo);
+
+    const float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+    if (ok) {
+        SendLine(job.fd, "done %u %.3f", job.id, seconds);
+    } else {
+        SendLine(job.fd, "failed %u %s", job.id, complete ? "cannot write the outputs" : "cancelled");
+    }
+    fprintf(stderr, "Job %u: %s in %.2f s\n", job.id, ok ? "done" : "failed", seconds);
+}
+
+// The render thread: jobs in order, until the process exits
+static void RunJobs(JobQueue & queue) {
+    std::map<std::string, Hittable *> scenes;
+    for (;;) {
+        Job * job;
+        {
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.added.wait(lock, [&]() { return !queue.jobs.empty(); });
+            job = queue.jobs.front();
+        }
+
+        RunJob(*job, scenes);
+        close(job->fd);
+
+        // Dequeued only now, so "jobs ahead" counts the one rendering
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.pop_front();
+        }
+        delete job;
+    }
+}
+
+// Read a client's request and queue its job, on a thread of its own so a
+// slow client only holds up itself
+static void ReceiveJob(Job * job, JobQueue & queue) {
+    // getopt keeps its state in globals, so requests are parsed one at a time
+    static std::mutex parsing;
+
+    // One request per connection, and a client only gets so long to send it
+    struct timeval timeout = { REQUEST_TIMEOUT_S, 0 };
+    setsockopt(job->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string buffer;
+    std::string request;
+    std::string error;
+    bool parsed = false;
+    if (!ReceiveLine(job->fd, buffer, request, MAX_REQUEST_BYTES)) {
+        SendLine(job->fd, "failed %u no request", job->id);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(parsing);
+            parsed = ParseJob(request, job->options, error);
+        }
+        if (!parsed) {
+            SendLine(job->fd, "failed %u %s", job->id, error.c_str());
+        }
+    }
+
+    if (!parsed) {
+        close(job->fd);
+        delete job;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    SendLine(job->fd, "queued %u %zu", job->id, queue.jobs.size());
+    queue.jobs.push_back(job);
+    queue.added.notify_one();
+}
+
+bool Serve(const Options & options) {
+    std::string error;
+    const int listener = OpenSocket(options.serve, true, error);
+    if (listener < 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", options.serve.c_str(), error.c_str());
+        return false;
+    }
+    fprintf(stderr, "Serving on %s\n", options.serve.c_str());
+
+    JobQueue queue;
+    std::thread renderer(RunJobs, std::ref(queue));
+    renderer.detach();
+
+    for (uint32_t id = 1; ; ) {
+        const int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if ((errno == EINTR) || (errno == ECONNABORTED)) {
+                continue;
+            }
+            fprintf(stderr, "accept: %s\n", strerror(errno));
+            close(listener);
+            return false;
+        }
+
+        Job * job = new Job();
+        job->id = id++;
+        job->fd = fd;
+        StartHelperThread([job, &queue]() { ReceiveJob(job, queue); }).detach();
+    }
+}
+
+bool Submit(const Options & options, int argc, char ** argv) {
+    std::string error;
+    const int fd = OpenSocket(options.submit, false, error);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot connect to %s: %s\n", options.submit.c_str(), error.c_str());
+        return false;
+    }
+
+    char directory[PATH_MAX];
+    std::string request = (getcwd(directory, sizeof(directory)) != NULL) ? directory : "";
+    for (int i = 1; i < argc; ++i) {
+        request += "\t";
+        request += argv[i];
+    }
+    request += "\n";
+
+    if (!SendText(fd, request)) {
+        fprintf(stderr, "%s: %s\n", options.submit.c_str(), strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    // A terminal gets a counter updated in place, a log every tenth
+    const bool terminal = isatty(STDERR_FILENO);
+    std::string buffer;
+    std::string line;
+    bool ok = false;
+    bool progress = false;
+    while (ReceiveLine(fd, buffer, line, MAX_REQUEST_BYTES)) {
+        uint32_t id = 0;
+        uint32_t value = 0;
+        float seconds = 0.0;
+        char reason[256];
+        if (sscanf(line.c_str(), "progress %u %u", &id, &value) == 2) {
+            if (terminal) {
+                fprintf(stderr, "\rJob %u: %3u%%", id, value);
+                progress = true;
+            } else if ((value % 10) == 0) {
+                fprintf(stderr, "Job %u: %u%%\n", id, value);
+            }
+            continue;
+        }
+
+        if (progress) {
+            fprintf(stderr, "\n");
+            progress = false;
+        }
+
+        if (sscanf(line.c_str(), "queued %u %u", &id, &value) == 2) {
+            fprintf(stderr, "Job %u queued, %u ahead\n", id, value);
+        } else if (sscanf(line.c_str(), "done %u %f", &id, &seconds) == 2) {
+            fprintf(stderr, "Job %u done in %.2f s\n", id, seconds);
+            ok = true;
+        } else if (sscanf(line.c_str(), "failed %u %255[^\n]", &id, reason) == 2) {
+            fprintf(stderr, "Job %u failed: %s\n", id, reason);
+        }
+    }
+
+    if (progress) {
+        fprintf(stderr, "\n");
+    }
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: server.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Render server
+///
+/// @detail A long-running process that keeps every scene it has built, BVH
+///         and all, so a batch of renders of one scene (different cameras,
+///         sample counts, sizes) only pays for loading it once. Jobs are
+///         queued and rendered one at a time in the order they arrived,
+///         each with all of the server's threads.
+///
+///         A client connects, sends one line of tab-separated fields (its
+///         working directory, then the job's command-line arguments) and
+///         reads lines back until the server closes the connection:
+///
+///             queued <id> <jobs ahead>
+///             started <id>
+///             progress <id> <percent>
+///             done <id> <seconds>     or     failed <id> <reason>
+///
+///         Relative paths in the job are taken from the client's directory.
+///         A client that disconnects cancels its job.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SERVER_H
+#define SERVER_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "options.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Serve jobs on options.serve until the process is killed. False if the
+// address can't be listened on
+bool Serve(const Options & options);
+
+// Send argv as a job to the server at options.submit and print its
+// progress. False if the job failed or the server could not be reached
+bool Submit(const Options & options, int argc, char ** argv);
+
+#endif//SERVER_H
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: simd.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  4-wide float vector header
+///
+/// @detail Header-only 4-lane float vector used by the packet kernels. Uses
+///         SSE2 where available (always on x86-64) and plain arrays elsewhere,
+///         so kernels are written once against float4.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMD_H
+#define SIMD_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+#if defined(SIMD_SSE2)
+
+struct float4 {
+    float4() {}
+    float4(const __m128 x) : v(x) {}
+    explicit float4(const float x) : v(_mm_set1_ps(x)) {}
+
+    static inline float4 load(const float * p) { return float4(_mm_loadu_ps(p)); }
+    inline void store(float * p) const { _mm_storeu_ps(p, v); }
+
+    // Widen four unsigned bytes to floats
+    static inline float4 from_bytes(const uint8_t * p) {
+        int32_t bits;
+        memcpy(&bits, p, sizeof(bits));
+        __m128i zero = _mm_setzero_si128();
+        __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero);
+        return float4(_mm_cvtepi32_ps(_mm_unpacklo_epi16(b, zero)));
+    }
+
+    __m128 v;   ///< Lanes
+};
+
+inline float4 operator+(const float4 & a, const float4 & b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator-(const float4 & a, const float4 & b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator*(const float4 & a, const float4 & b) { return _mm_mul_ps(a.v, b.v); }
+inline float4 operator/(const float4 & a, const float4 & b) { return _mm_div_ps(a.v, b.v); }
+
+// min/max return the second operand when the first is NaN, so put the value
+// that may be NaN first to have it ignored
+inline float4 min(const float4 & a, const float4 & b) { return _mm_min_ps(a.v, b.v); }
+inline float4 max(const float4 & a, const float4 & b) { return _mm_max_ps(a.v, b.v); }
+
+// Comparisons return all-ones / all-zeros lane masks
+inline float4 operator<(const float4 & a, const float4 & b) { return _mm_cmplt_ps(a.v, b.v); }
+inline float4 operator>(const float4 & a, const float4 & b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline float4 operator<=(const float4 & a, const float4 & b) { return _mm_cmple_ps(a.v, b.v); }
+inline float4 operator==(const float4 & a, const float4 & b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline float4 operator!=(const float4 & a, const float4 & b) { return _mm_cmpneq_ps(a.v, b.v); }
+inline float4 operator&(const float4 & a, const float4 & b) { return _mm_and_ps(a.v, b.v); }
+inline float4 operator|(const float4 & a, const float4 & b) { return _mm_or_ps(a.v, b.v); }
+
+// Bit i set if lane i of the mask is set
+inline int32_t movemask(const float4 & m) { return _mm_movemask_ps(m.v); }
+
+// Lane-wise m ? a : b
+inline float4 select(const float4 & m, const float4 & a, const float4 & b) {
+    return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+}
+
+#else
+
+struct float4 {
+    float4() {}
+    explicit float4(const float x) { for (int32_t i = 0; i < 4; ++i) v[i] = x; }
+
+    static inline float4 load(const float * p) { float4 r; for (int32_t i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    inline void store(float * p) const { for (int32_t i = 0; i < 4; ++i) p[i] = v[i]; }
+    static inline float4 from_bytes(const uint8_t * p) { float4 r; for (int32_t i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+
+    float v[4];     ///< Lanes
+};
+
+// Masks are stored as 1.0 / 0.0 in the portable implementation
+#define SIMD_LANEWISE(expr) float4 r; for (int32_t i = 0; i < 4; ++i) { r.v[i] = (expr); } return r;
+
+inline float4 operator+(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] + b.v[i]) }
+inline float4 operator-(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] - b.v[i]) }
+inline float4 operator*(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] * b.v[i]) }
+inline float4 operator/(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] / b.v[i]) }
+inline float4 min(const float4 & a, const float4 & b) { SIMD_LANEWISE((a.v[i] < b.v[i]) ? a.v[i] : b.v[i]) }
+inline float4 max(const float4 & a, const float4 & b) { SIMD_LANEWISE((a.v[i] > b.v[i]) ? a.v[i] : b.v[i]) }
+inline float4 operator<(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] < b.v[i]) }
+inline float4 operator>(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] > b.v[i]) }
+inline float4 operator<=(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] <= b.v[i]) }
+inline float4 operator==(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] == b.v[i]) }
+inline float4 operator!=(const float4 & a, const float4 & b) { SIMD_LANEWISE(a.v[i] != b.v[i]) }
+inline float4 operator&(const float4 & a, const float4 & b) { SIMD_LANEWISE((a.v[i] != 0.0F) && (b.v[i] != 0.0F)) }
+inline float4 operator|(const float4 & a, const float4 & b) { SIMD_LANEWISE((a.v[i] != 0.0F) || (b.v[i] != 0.0F)) }
+
+inline int32_t movemask(const float4 & m) {
+    int32_t bits = 0;
+    for (int32_t i = 0; i < 4; ++i) {
+        bits |= (m.v[i] != 0.0F) << i;
+    }
+    return bits;
+}
+
+inline float4 select(const float4 & m, const float4 & a, const float4 & b) { SIMD_LANEWISE((m.v[i] != 0.0F) ? a.v[i] : b.v[i]) }
+
+#undef SIMD_LANEWISE
+
+#endif
+
+#endif//SIMD_H
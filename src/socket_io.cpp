@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: socket_io.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Socket helpers
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_io.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+bool ParseAddress(const std::string & address, bool & local, std::string & host, std::string & port) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        local = true;
+        host = address.substr(5);
+        return !host.empty() && (host.size() < sizeof(((struct sockaddr_un *) NULL)->sun_path));
+    }
+
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+
+    local = false;
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+    if ((host.size() >= 2) && (host[0] == '[') && (host[host.size() - 1] == ']')) {
+        host = host.substr(1, host.size() - 2);
+    }
+    return !port.empty();
+}
+
+int OpenSocket(const std::string & address, const bool listening, std::string & error) {
+    bool local = false;
+    std::string host;
+    std::string port;
+    if (!ParseAddress(address, local, host, port)) {
+        error = "not unix:<path> or <host>:<port>";
+        return -1;
+    }
+
+    if (local) {
+        struct sockaddr_un name;
+        memset(&name, 0, sizeof(name));
+        name.sun_family = AF_UNIX;
+        strncpy(name.sun_path, host.c_str(), sizeof(name.sun_path) - 1);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            error = strerror(errno);
+            return -1;
+        }
+
+        if (listening) {
+            unlink(host.c_str());
+        }
+
+        const bool ok = listening ?
+            ((bind(fd, (struct sockaddr *) &name, sizeof(name)) == 0) && (listen(fd, SOMAXCONN) == 0)) :
+            (connect(fd, (struct sockaddr *) &name, sizeof(name)) == 0);
+        if (!ok) {
+            error = strerror(errno);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    struct addrinfo * results = NULL;
+    const int status = getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &results);
+    if (status != 0) {
+        error = gai_strerror(status);
+        return -1;
+    }
+
+    // The first of the host's addresses that works
+    int fd = -1;
+    error = "no usable address";
+    for (struct addrinfo * ai = results; (ai != NULL) && (fd < 0); ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            error = strerror(errno);
+            continue;
+        }
+
+        const int on = 1;
+        bool ok;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            ok = (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) && (listen(fd, SOMAXCONN) == 0);
+        } else {
+            ok = (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        if (!ok) {
+            error = strerror(errno);
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(results);
+    return fd;
+}
+
+bool SendAll(const int fd, const void * data, size_t size) {
+    const uint8_t * bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        // A peer that has gone away is an error here, not a SIGPIPE
+        const ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool ReceiveAll(const int fd, void * data, size_t size) {
+    uint8_t * bytes = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t n = recv(fd, bytes, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            return false;
+        }
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool ReceiveLine(const int fd, std::string & buffer, std::string & line, const size_t max_length) {
+    size_t newline;
+    while ((newline = buffer.find('\n')) == std::string::npos) {
+        if (buffer.size() > max_length) {
+            return false;
+        }
+
+        char chunk[4096];
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            return false;
+        }
+        buffer.append(chunk, n);
+    }
+
+    // Tolerate CRLF from interactive clients
+    line = buffer.substr(0, ((newline > 0) && (buffer[newline - 1] == '\r')) ? newline - 1 : newline);
+    buffer.erase(0, newline + 1);
+    return line.size() <= max_length;
+}
+
+bool SendText(const int fd, const std::string & text) {
+    return SendAll(fd, text.data(), text.size());
+}
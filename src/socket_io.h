@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: socket_io.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Socket helpers
+///
+/// @detail Addresses are "unix:/path" for a Unix domain socket or
+///         "host:port" for TCP; the host may be empty to listen on every
+///         interface, or an IPv6 address in brackets. Sends never raise
+///         SIGPIPE: a peer that has gone away is an ordinary failure.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Split an address; host is the path of a Unix socket. False if malformed
+bool ParseAddress(const std::string & address, bool & local, std::string & host, std::string & port);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Open a socket listening on, or connected to, an address
+///
+/// @param  address - "unix:/path" or "host:port"
+/// @param  listening - Listen rather than connect; an existing Unix socket
+///                     file is replaced
+/// @param  error - Set to the reason on failure
+///
+/// @return The socket, or -1
+///////////////////////////////////////////////////////////////////////////////
+int OpenSocket(const std::string & address, const bool listening, std::string & error);
+
+// Blocking; false if the connection failed or, receiving, was closed early
+bool SendAll(const int fd, const void * data, size_t size);
+bool ReceiveAll(const int fd, void * data, size_t size);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Receive a line of text, without its newline
+///
+/// @param  fd - Socket
+/// @param  buffer - Bytes received past the previous line; keep it between
+///                  calls on the same socket
+/// @param  line - Set to the line
+/// @param  max_length - Longer lines are an error
+///
+/// @return False on a closed connection, an error or an over-long line
+///////////////////////////////////////////////////////////////////////////////
+bool ReceiveLine(const int fd, std::string & buffer, std::string & line, const size_t max_length);
+
+// Send text as is; add the newline yourself
+bool SendText(const int fd, const std::string & text);
+
+#endif//SOCKET_IO_H
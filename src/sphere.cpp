@@ -15,11 +15,13 @@
 // INCLUDES
 ///////////////////////////////////////////////////////////////////////////////
 #include "sphere.h"
+#include "stats.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // METHODS
 ///////////////////////////////////////////////////////////////////////////////
 bool Sphere::hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const {
+    CountStat(STAT_PRIMITIVE_TESTS);
     vec3 oc = ray.origin() - centre;
 
     // Vector equation of a sphere
@@ -57,3 +59,10 @@ bool Sphere::hit(const Ray & ray, const float t_min, const float t_max, HitRecor
     // Not hit if the desciminant is zero or negative
     return false;
 }
+
+bool Sphere::bounding_box(AABB & box) const {
+    // Negative radii are used for hollow glass, so bound by the magnitude
+    vec3 r(fabsf(radius), fabsf(radius), fabsf(radius));
+    box = AABB(centre - r, centre + r);
+    return true;
+}
@@ -28,6 +28,7 @@ public:
     Sphere() {}
     Sphere(vec3 c, const float r, Material * m): centre(c), radius(r), material(m) {};
     virtual bool hit(const Ray & ray, const float t_min, const float t_max, HitRecord & record) const;
+    virtual bool bounding_box(AABB & box) const;
 
     vec3 centre;            ///< Circle centre point
     float radius;           ///< Circle radius
@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: stats.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Ray statistics and phase timing
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+
+#include "stats.h"
+#include "numa.h"
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINES
+///////////////////////////////////////////////////////////////////////////////
+#define STATS_POLL_MS 100       ///< How often the reporter checks the time
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+static const char * const stat_names[NUM_RAY_STATS] = { "Camera rays", "Bounce rays", "Primitive tests", "BVH node visits" };
+static const char * const phase_names[NUM_PHASES] = { "scene", "render", "encode", "checkpoint" };
+
+static std::atomic<int64_t> phase_nanoseconds[NUM_PHASES];     ///< Summed phase times
+static std::atomic<uint64_t> phase_counters[NUM_PHASES][NUM_PERF_COUNTERS];   ///< Summed hardware counts
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Blocks of the live threads, and the totals of the exited ones. Never
+// destroyed, so threads exiting during shutdown can still retire
+struct StatsRegistry {
+    std::mutex mutex;                       ///< Guards everything below
+    std::vector<ThreadStats *> live;        ///< Registered blocks
+    uint64_t retired[NUM_RAY_STATS];        ///< Totals of unregistered blocks
+};
+
+static StatsRegistry & Registry() {
+    static StatsRegistry * registry = new StatsRegistry();
+    return *registry;
+}
+
+ThreadStats::ThreadStats() {
+    for (int32_t i = 0; i < NUM_RAY_STATS; ++i) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+
+    StatsRegistry & registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.live.push_back(this);
+}
+
+ThreadStats::~ThreadStats() {
+    StatsRegistry & registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (int32_t i = 0; i < NUM_RAY_STATS; ++i) {
+        registry.retired[i] += counts[i].load(std::memory_order_relaxed);
+    }
+    registry.live.erase(std::find(registry.live.begin(), registry.live.end(), this));
+}
+
+ScopedPhase::~ScopedPhase() {
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    AddPhaseTime(phase, end - start);
+
+    if (trace_enabled.load(std::memory_order_relaxed)) {
+        RecordSpan(phase_names[phase], "phase", start, end, -1);
+    }
+}
+
+PhaseCounters::~PhaseCounters() {
+    PerfSample end;
+    if (counting && ReadPerfCounters(end)) {
+        uint64_t counts[NUM_PERF_COUNTERS];
+        PerfCountsBetween(start, end, counts);
+        for (int32_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            phase_counters[phase][i] += counts[i];
+        }
+    }
+}
+
+void AddPhaseTime(const Phase phase, const std::chrono::steady_clock::duration elapsed) {
+    phase_nanoseconds[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+StatsTotals GatherStats() {
+    StatsTotals totals;
+    StatsRegistry & registry = Registry();
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (int32_t i = 0; i < NUM_RAY_STATS; ++i) {
+            totals.counts[i] = registry.retired[i];
+            for (size_t t = 0; t < registry.live.size(); ++t) {
+                totals.counts[i] += registry.live[t]->counts[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < NUM_PHASES; ++i) {
+        totals.seconds[i] = phase_nanoseconds[i].load() * 1e-9;
+        for (int32_t k = 0; k < NUM_PERF_COUNTERS; ++k) {
+            totals.counters[i][k] = phase_counters[i][k].load();
+        }
+    }
+    return totals;
+}
+
+void PrintStats(const StatsTotals & totals) {
+    const double render = totals.seconds[PHASE_RENDER];
+    const uint64_t rays = totals.counts[STAT_CAMERA_RAYS] + totals.counts[STAT_BOUNCE_RAYS];
+
+    fprintf(stderr, "Statistics:\n");
+    for (int32_t i = 0; i < NUM_RAY_STATS; ++i) {
+        fprintf(stderr, "  %-18s %14llu\n", stat_names[i], (unsigned long long) totals.counts[i]);
+    }
+
+    if (rays > 0) {
+        fprintf(stderr, "  %-18s %14.2f\n", "Tests per ray", double(totals.counts[STAT_PRIMITIVE_TESTS]) / rays);
+        fprintf(stderr, "  %-18s %14.2f\n", "Nodes per ray", double(totals.counts[STAT_NODE_VISITS]) / rays);
+    }
+
+    if (render > 0.0) {
+        fprintf(stderr, "  %-18s %14.3f\n", "Mrays/s", (rays / render) * 1e-6);
+        fprintf(stderr, "  %-18s %14.3f\n", "Msamples/s", (totals.counts[STAT_CAMERA_RAYS] / render) * 1e-6);
+    }
+
+    fprintf(stderr, "  Phases (s):");
+    for (int32_t i = 0; i < NUM_PHASES; ++i) {
+        fprintf(stderr, " %s %.3f", phase_names[i], totals.seconds[i]);
+    }
+    fprintf(stderr, "\n");
+
+    if (!perf_enabled) {
+        return;
+    }
+
+    // Per phase, over every thread that worked in it
+    fprintf(stderr, "  %-12s %16s %8s %12s %12s %14s\n", "Counters", "Instructions", "IPC", "LLC MPKI", "Branch miss", "Instr per ray");
+    for (int32_t i = 0; i < NUM_PHASES; ++i) {
+        const uint64_t * c = totals.counters[i];
+        if (c[PERF_INSTRUCTIONS] == 0) {
+            continue;
+        }
+
+        fprintf(stderr, "  %-12s %16llu %8.2f %12.2f %11.2f%%", phase_names[i], (unsigned long long) c[PERF_INSTRUCTIONS],
+            (c[PERF_CYCLES] > 0) ? double(c[PERF_INSTRUCTIONS]) / c[PERF_CYCLES] : 0.0,
+            (1000.0 * c[PERF_CACHE_MISSES]) / c[PERF_INSTRUCTIONS],
+            (c[PERF_BRANCHES] > 0) ? (100.0 * c[PERF_BRANCH_MISSES]) / c[PERF_BRANCHES] : 0.0);
+        if ((i == PHASE_RENDER) && (rays > 0)) {
+            fprintf(stderr, " %14.0f", double(c[PERF_INSTRUCTIONS]) / rays);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+StatsReporter::StatsReporter(const float i) : interval(i), stopping(false) {
+    thread = StartHelperThread([this]() { run(); });
+}
+
+StatsReporter::~StatsReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void StatsReporter::run() {
+    SetTraceThreadName("stats");
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    StatsTotals previous = GatherStats();
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::milliseconds(STATS_POLL_MS));
+
+        const Clock::time_point now = Clock::now();
+        const double seconds = std::chrono::duration<double>(now - last).count();
+        if (stopping || (seconds < interval)) {
+            continue;
+        }
+
+        // Rates over the last interval, so stalls show up
+        StatsTotals totals = GatherStats();
+        const uint64_t camera = totals.counts[STAT_CAMERA_RAYS] - previous.counts[STAT_CAMERA_RAYS];
+        const uint64_t bounce = totals.counts[STAT_BOUNCE_RAYS] - previous.counts[STAT_BOUNCE_RAYS];
+        fprintf(stderr, "[%.1f s] %.3f Mrays/s, %.3f Msamples/s\n", std::chrono::duration<double>(now - start).count(),
+            ((camera + bounce) / seconds) * 1e-6, (camera / seconds) * 1e-6);
+
+        previous = totals;
+        last = now;
+    }
+}
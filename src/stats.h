@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: stats.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Ray statistics and phase timing
+///
+/// @detail Every thread counts into its own block, so counting is a plain
+///         add with no shared cache lines or locked instructions. Blocks
+///         register themselves on a thread's first count and fold into a
+///         retired total when the thread exits; GatherStats() sums them
+///         while the counting carries on.
+///
+///         Phase times are wall-clock seconds summed over every call, so
+///         phases on background threads (encoding, checkpoints) can add up
+///         to more than the run itself. With hardware counters on, each
+///         thread's counter deltas over a phase are summed the same way.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef STATS_H
+#define STATS_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+#include "perf_counters.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// ENUMERATIONS
+///////////////////////////////////////////////////////////////////////////////
+enum RayStat {
+    STAT_CAMERA_RAYS,           ///< Rays from the camera, one per sample
+    STAT_BOUNCE_RAYS,           ///< Rays scattered off a surface
+    STAT_PRIMITIVE_TESTS,       ///< Sphere and triangle intersection tests
+    STAT_NODE_VISITS,           ///< BVH nodes whose children were tested
+    NUM_RAY_STATS
+};
+
+enum Phase {
+    PHASE_SCENE,                ///< Building the scene and its hierarchy
+    PHASE_RENDER,               ///< Inside Renderer::render()
+    PHASE_ENCODE,               ///< Writing image rows, on the encoder thread
+    PHASE_CHECKPOINT,           ///< Writing checkpoints
+    NUM_PHASES
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// One thread's counters. Only the owning thread writes them, so an add is a
+// relaxed load and store rather than a read-modify-write
+class ThreadStats {
+public:
+    ThreadStats();
+    ~ThreadStats();
+
+    inline void add(const RayStat stat, const uint64_t n) {
+        counts[stat].store(counts[stat].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts[NUM_RAY_STATS];    ///< Counts so far
+};
+
+// Totals over every thread
+struct StatsTotals {
+    uint64_t counts[NUM_RAY_STATS];                         ///< Ray statistics
+    double seconds[NUM_PHASES];                             ///< Phase times
+    uint64_t counters[NUM_PHASES][NUM_PERF_COUNTERS];       ///< Hardware counters, if on
+};
+
+// Adds the calling thread's hardware counts from construction to
+// destruction to a phase, if counting is on. For threads working inside a
+// phase timed by another
+class PhaseCounters {
+public:
+    explicit PhaseCounters(const Phase p) : phase(p) { counting = ReadPerfCounters(start); }
+    ~PhaseCounters();
+
+private:
+    Phase phase;                ///< Phase counted
+    PerfSample start;           ///< Counts at construction
+    bool counting;              ///< Start counts were read
+};
+
+// Adds the time from construction to destruction to a phase, and the
+// calling thread's hardware counts
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const Phase p) : phase(p), start(std::chrono::steady_clock::now()), counters(p) {}
+    ~ScopedPhase();
+
+private:
+    Phase phase;                                    ///< Phase timed
+    std::chrono::steady_clock::time_point start;    ///< Construction time
+    PhaseCounters counters;                         ///< Hardware counts
+};
+
+// Prints a line of throughput since the last one every few seconds
+class StatsReporter {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// @brief  StatsReporter constructor; starts the background thread
+    ///
+    /// @param  i - Seconds between reports
+    ///////////////////////////////////////////////////////////////////////////
+    explicit StatsReporter(const float i);
+    ~StatsReporter();
+
+private:
+    void run();
+
+    float interval;                         ///< Seconds between reports
+    std::thread thread;                     ///< Background thread
+    std::mutex mutex;                       ///< Guards stopping
+    std::condition_variable wake;           ///< Signalled to stop
+    bool stopping;                          ///< Background thread should exit
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// The calling thread's counters
+inline ThreadStats & LocalStats() {
+    static thread_local ThreadStats stats;
+    return stats;
+}
+
+// Count n events on the calling thread
+inline void CountStat(const RayStat stat, const uint64_t n = 1) {
+    LocalStats().add(stat, n);
+}
+
+// Add wall-clock time to a phase. Thread-safe
+void AddPhaseTime(const Phase phase, const std::chrono::steady_clock::duration elapsed);
+
+// Sum the counters of every thread, live or exited, and the phase times
+StatsTotals GatherStats();
+
+// Print the totals, with rates over the render phase
+void PrintStats(const StatsTotals & totals);
+
+#endif//STATS_H
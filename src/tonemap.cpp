@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: tonemap.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Tone mapping
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "tonemap.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static inline float ToneCurve(const TonemapOperator op, const float c) {
+    switch (op) {
+    case TonemapOperator::Reinhard:
+        return c / (1.0F + c);
+
+    case TonemapOperator::ACES:
+        return (c * ((2.51F * c) + 0.03F)) / ((c * ((2.43F * c) + 0.59F)) + 0.14F);
+
+    default:
+        return c;
+    }
+}
+
+void Tonemap(const Framebuffer & framebuffer, const TonemapOptions & options, const uint32_t begin, const uint32_t end, uint8_t * rgb) {
+    const float scale = exp2f(options.exposure);
+    const float inv_gamma = 1.0 / options.gamma;
+
+    for (uint32_t y = begin; y < end; ++y) {
+        for (uint32_t x = 0; x < framebuffer.width; ++x) {
+            vec3 colour = framebuffer.pixel(x, y);
+            uint8_t * out = &rgb[3 * ((size_t(y - begin) * framebuffer.width) + x)];
+
+            for (int32_t k = 0; k < 3; ++k) {
+                float c = ToneCurve(options.op, colour[k] * scale);
+                c = pow(fmaxf(c, 0.0F), inv_gamma);
+                c = fminf(c, 1.0F);
+                out[k] = uint8_t(int32_t(255.99 * c));
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: tonemap.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Tone mapping
+///
+/// @detail Turns the linear framebuffer into 8-bit display values as a
+///         separate pass, so the float data written to HDR formats is never
+///         touched by exposure, tone curves or gamma.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "framebuffer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+enum class TonemapOperator {
+    Clamp,      ///< Clip to [0, 1]
+    Reinhard,   ///< c / (1 + c)
+    ACES        ///< Narkowicz's fit of the ACES filmic curve
+};
+
+struct TonemapOptions {
+    TonemapOptions() : op(TonemapOperator::Clamp), exposure(0.0), gamma(2.0) {}
+
+    TonemapOperator op;     ///< Tone curve
+    float exposure;         ///< Exposure adjustment in stops, applied before the curve
+    float gamma;            ///< Display gamma, applied after the curve
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Tone map rows of a framebuffer to 8-bit RGB
+///
+/// @param  framebuffer - Linear framebuffer
+/// @param  options - Tone mapping options
+/// @param  begin - First row
+/// @param  end - One past the last row
+/// @param  rgb - Output interleaved RGB bytes, (end - begin) rows
+///////////////////////////////////////////////////////////////////////////////
+void Tonemap(const Framebuffer & framebuffer, const TonemapOptions & options, const uint32_t begin, const uint32_t end, uint8_t * rgb);
+
+#endif//TONEMAP_H
@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: trace.cpp
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Timeline tracing
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+std::atomic<bool> trace_enabled(false);
+
+static std::chrono::steady_clock::time_point trace_start;      ///< Time zero of the timeline
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+struct TraceEvent {
+    const char * name;          ///< Span name
+    const char * category;      ///< Span category
+    double start;               ///< Microseconds since StartTrace()
+    double duration;            ///< Microseconds
+    uint32_t thread;            ///< Thread id in the timeline
+    int64_t arg;                ///< Index argument, negative for none
+};
+
+class TraceBuffer;
+
+// Live buffers and the events of finished threads. Never destroyed, so
+// threads exiting during shutdown can still hand theirs over
+struct TraceRegistry {
+    std::mutex mutex;                           ///< Guards everything below
+    std::vector<TraceBuffer *> live;            ///< Buffers of running threads
+    std::vector<TraceEvent> retired;            ///< Events of exited threads
+    std::vector<std::string> thread_names;      ///< Name of each thread id
+};
+
+static TraceRegistry & Registry() {
+    static TraceRegistry * registry = new TraceRegistry();
+    return *registry;
+}
+
+// One thread's events. Only the owner appends; the lock is only ever
+// contended while WriteTrace() copies the events out
+class TraceBuffer {
+public:
+    TraceBuffer() {
+        TraceRegistry & registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        thread = registry.thread_names.size();
+        registry.thread_names.push_back("thread " + std::to_string(thread));
+        registry.live.push_back(this);
+    }
+
+    ~TraceBuffer() {
+        TraceRegistry & registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.retired.insert(registry.retired.end(), events.begin(), events.end());
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), this));
+    }
+
+    std::mutex mutex;                   ///< Uncontended except while writing the trace
+    std::vector<TraceEvent> events;     ///< Recorded spans
+    uint32_t thread;                    ///< Thread id in the timeline
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+static TraceBuffer & LocalBuffer() {
+    static thread_local TraceBuffer buffer;
+    return buffer;
+}
+
+void StartTrace() {
+    trace_start = std::chrono::steady_clock::now();
+    trace_enabled = true;
+}
+
+void SetTraceThreadName(const std::string & name) {
+    if (!trace_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    TraceBuffer & buffer = LocalBuffer();
+    TraceRegistry & registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Helper threads come and go (an encoder per output pipeline, a
+    // checkpointer per render, one per server request); put a thread on the
+    // track of an exited one with the same name, rather than a new track
+    for (uint32_t t = 0; t < registry.thread_names.size(); ++t) {
+        if ((registry.thread_names[t] == name) && (t != buffer.thread)) {
+            bool in_use = false;
+            for (size_t i = 0; i < registry.live.size(); ++i) {
+                in_use = in_use || (registry.live[i]->thread == t);
+            }
+
+            if (!in_use) {
+                std::lock_guard<std::mutex> buffer_lock(buffer.mutex);
+                for (size_t i = 0; i < buffer.events.size(); ++i) {
+                    buffer.events[i].thread = t;
+                }
+                buffer.thread = t;
+                return;
+            }
+        }
+    }
+    registry.thread_names[buffer.thread] = name;
+}
+
+void RecordSpan(const char * name, const char * category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int64_t arg) {
+    typedef std::chrono::duration<double, std::micro> Microseconds;
+
+    TraceBuffer & buffer = LocalBuffer();
+    TraceEvent event = { name, category, Microseconds(start - trace_start).count(), Microseconds(end - start).count(), buffer.thread, arg };
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back(event);
+}
+
+bool WriteTrace(const char * path) {
+    TraceRegistry & registry = Registry();
+    std::vector<TraceEvent> events;
+    std::vector<std::string> names;
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        events = registry.retired;
+        for (size_t i = 0; i < registry.live.size(); ++i) {
+            std::lock_guard<std::mutex> buffer_lock(registry.live[i]->mutex);
+            events.insert(events.end(), registry.live[i]->events.begin(), registry.live[i]->events.end());
+        }
+        names = registry.thread_names;
+    }
+
+    FILE * file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot write trace '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+
+    // Names of the tracks with spans first, then the spans
+    std::vector<bool> used(names.size(), false);
+    for (size_t i = 0; i < events.size(); ++i) {
+        used[events[i].thread] = true;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    const char * separator = "\n";
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!used[i]) {
+            continue;
+        }
+
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, \"args\": {\"name\": \"%s\"}}", separator, i, names[i].c_str());
+        fprintf(file, ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, \"args\": {\"sort_index\": %zu}}", i, i);
+        separator = ",\n";
+    }
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent & e = events[i];
+        fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+            separator, e.name, e.category, e.thread, e.start, e.duration);
+        if (e.arg >= 0) {
+            fprintf(file, ", \"args\": {\"index\": %lld}", (long long) e.arg);
+        }
+        fprintf(file, "}");
+        separator = ",\n";
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    if ((fclose(file) != 0) || !ok) {
+        fprintf(stderr, "Cannot write trace '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
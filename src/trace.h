@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: trace.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Timeline tracing
+///
+/// @detail Records spans (scene load, BVH builds, each rendered tile per
+///         thread, encoding, checkpoints) and writes them in the Chrome
+///         trace event format, which chrome://tracing and ui.perfetto.dev
+///         open directly.
+///
+///         Each thread appends to its own buffer, under a lock that only
+///         WriteTrace() ever contends; buffers are handed over when their
+///         thread exits. When tracing is off a span costs one relaxed load.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRACE_H
+#define TRACE_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// VARIABLES
+///////////////////////////////////////////////////////////////////////////////
+extern std::atomic<bool> trace_enabled;     ///< Set by StartTrace()
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Start recording; spans before this are not kept
+void StartTrace();
+
+// Name the calling thread in the timeline
+void SetTraceThreadName(const std::string & name);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief  Record a finished span on the calling thread
+///
+/// @param  name - Span name; must outlive the trace (a string literal)
+/// @param  category - Span category; must outlive the trace
+/// @param  start - Start time
+/// @param  end - End time
+/// @param  arg - Shown as the span's "index" argument if not negative
+///////////////////////////////////////////////////////////////////////////////
+void RecordSpan(const char * name, const char * category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int64_t arg);
+
+// Write every span recorded so far. False after printing the reason to stderr
+bool WriteTrace(const char * path);
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+
+// Records a span from construction to destruction, if tracing is on
+class TraceSpan {
+public:
+    TraceSpan(const char * n, const char * c, const int64_t a = -1) : name(NULL), category(c), arg(a) {
+        if (trace_enabled.load(std::memory_order_relaxed)) {
+            name = n;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceSpan() {
+        if (name != NULL) {
+            RecordSpan(name, category, start, std::chrono::steady_clock::now(), arg);
+        }
+    }
+
+private:
+    const char * name;                              ///< Span name, NULL if not tracing
+    const char * category;                          ///< Span category
+    int64_t arg;                                    ///< Index argument
+    std::chrono::steady_clock::time_point start;    ///< Construction time
+};
+
+#endif//TRACE_H
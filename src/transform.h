@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE: transform.h
+//
+// AUTHORS:
+// Joseph Gibson / <joseph.gibson@nasa.gov>
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+/// @file
+///
+/// @brief  Affine transform header
+///
+/// @detail Header-only 3x4 affine transform that carries its own inverse, so
+///         world-to-object and object-to-world mappings are both free
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+///////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+///////////////////////////////////////////////////////////////////////////////
+#include "vec3.h"
+#include "ray.h"
+#include "aabb.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CLASSES
+///////////////////////////////////////////////////////////////////////////////
+class Transform {
+public:
+    // Identity
+    Transform() {
+        for (int32_t r = 0; r < 3; ++r) {
+            for (int32_t c = 0; c < 4; ++c) {
+                m[r][c] = (r == c) ? 1.0F : 0.0F;
+                inv[r][c] = m[r][c];
+            }
+        }
+    }
+
+    static Transform Translate(const vec3 & t) {
+        Transform x;
+        for (int32_t r = 0; r < 3; ++r) {
+            x.m[r][3] = t[r];
+            x.inv[r][3] = -t[r];
+        }
+        return x;
+    }
+
+    static Transform Scale(const vec3 & s) {
+        Transform x;
+        for (int32_t r = 0; r < 3; ++r) {
+            x.m[r][r] = s[r];
+            x.inv[r][r] = 1.0F / s[r];
+        }
+        return x;
+    }
+
+    static Transform Scale(const float s) { return Scale(vec3(s, s, s)); }
+
+    // Rotation about the Y (up) axis, in degrees
+    static Transform RotateY(const float degrees) {
+        Transform x;
+        float theta = degrees * M_PI / 180.0;
+        float s = sin(theta);
+        float c = cos(theta);
+
+        x.m[0][0] = c;      x.m[0][2] = s;
+        x.m[2][0] = -s;     x.m[2][2] = c;
+
+        // Rotations are orthonormal, so the inverse is the transpose
+        x.inv[0][0] = c;    x.inv[0][2] = -s;
+        x.inv[2][0] = s;    x.inv[2][2] = c;
+        return x;
+    }
+
+    inline vec3 point(const vec3 & p) const { return Apply(m, p, 1.0F); }
+    inline vec3 vector(const vec3 & v) const { return Apply(m, v, 0.0F); }
+    inline vec3 inverse_point(const vec3 & p) const { return Apply(inv, p, 1.0F); }
+    inline vec3 inverse_vector(const vec3 & v) const { return Apply(inv, v, 0.0F); }
+
+    // Normals transform by the inverse transpose
+    inline vec3 normal(const vec3 & n) const {
+        return vec3(
+            (inv[0][0] * n.x()) + (inv[1][0] * n.y()) + (inv[2][0] * n.z()),
+            (inv[0][1] * n.x()) + (inv[1][1] * n.y()) + (inv[2][1] * n.z()),
+            (inv[0][2] * n.x()) + (inv[1][2] * n.y()) + (inv[2][2] * n.z())
+        );
+    }
+
+    // Directions are not renormalized, so ray parameters are the same in both spaces
+    inline Ray inverse_ray(const Ray & r) const {
+        return Ray(inverse_point(r.origin()), inverse_vector(r.direction()), r.time());
+    }
+
+    // Box enclosing the transformed corners of a box
+    inline AABB box(const AABB & b) const {
+        AABB result;
+        for (int32_t i = 0; i < 8; ++i) {
+            vec3 corner((i & 1) ? b.maximum.x() : b.minimum.x(),
+                        (i & 2) ? b.maximum.y() : b.minimum.y(),
+                        (i & 4) ? b.maximum.z() : b.minimum.z());
+            result.expand(point(corner));
+        }
+        return result;
+    }
+
+    float m[3][4];      ///< Object-to-world matrix (last row implicitly 0 0 0 1)
+    float inv[3][4];    ///< World-to-object matrix
+
+private:
+    static inline vec3 Apply(const float a[3][4], const vec3 & v, const float w) {
+        return vec3(
+            (a[0][0] * v.x()) + (a[0][1] * v.y()) + (a[0][2] * v.z()) + (a[0][3] * w),
+            (a[1][0] * v.x()) + (a[1][1] * v.y()) + (a[1][2] * v.z()) + (a[1][3] * w),
+            (a[2][0] * v.x()) + (a[2][1] * v.y()) + (a[2][2] * v.z()) + (a[2][3] * w)
+        );
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// METHODS
+///////////////////////////////////////////////////////////////////////////////
+
+// Multiply two 3x4 affine matrices as if they were 4x4 with a 0 0 0 1 last row
+static inline void MultiplyAffine(const float a[3][4], const float b[3][4], float out[3][4]) {
+    for (int32_t r = 0; r < 3; ++r) {
+        for (int32_t c = 0; c < 4; ++c) {
+            out[r][c] = (a[r][0] * b[0][c]) + (a[r][1] * b[1][c]) + (a[r][2] * b[2][c]);
+        }
+        out[r][3] += a[r][3];
+    }
+}
+
+///< Composition (form: a * b applies b first, then a)
+inline Transform operator*(const Transform & a, const Transform & b) {
+    Transform x;
+    MultiplyAffine(a.m, b.m, x.m);
+    MultiplyAffine(b.inv, a.inv, x.inv);
+    return x;
+}
+
+#endif//TRANSFORM_H
@@ -16,6 +16,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "utilities.h"
 #include "material.h"
+#include "stats.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // METHODS
@@ -25,7 +26,7 @@ vec3 RandomInUnitSphere() {
     vec3 p(1, 1, 1);
 
     do {
-        p = 2.0 * vec3(drand48(), drand48(), drand48()) - vec3(1, 1, 1);
+        p = 2.0 * vec3(RandomFloat(), RandomFloat(), RandomFloat()) - vec3(1, 1, 1);
     } while (p.squared_length() >= 1.0);
 
     return p;
@@ -36,7 +37,7 @@ vec3 RandomInUnitDisk() {
     vec3 p(1, 1, 1);
 
     do {
-        p = 2.0 * vec3(drand48(), drand48(), 0.0) - vec3(1, 1, 0);
+        p = 2.0 * vec3(RandomFloat(), RandomFloat(), 0.0) - vec3(1, 1, 0);
     } while (dot(p, p) >= 1.0);
 
     return p;
@@ -54,6 +55,7 @@ vec3 Colour(const Ray & ray, Hittable * world, int32_t depth) {
         vec3 attenuation;
 
         if ((depth < 50) && record.material->scatter(ray, record, attenuation, scattered)) {
+            CountStat(STAT_BOUNCE_RAYS);
             return attenuation * Colour(scattered, world, depth + 1);
         } else {
             return vec3(0, 0, 0);
@@ -20,6 +20,7 @@
 #include "vec3.h"
 #include "ray.h"
 #include "hittable.h"
+#include "random.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // METHODS